@@ -23,687 +23,5047 @@
 #include "c-utils.h"
 
 
-void bump_allocator_init(BumpAllocator *allocator, uint64 buffer_size)
-{
-    if (allocator == NULL)
-        return;
+#if defined(__x86_64__) && defined(__GNUC__)
+    #define C_UTILS_X64_KERNELS
+#endif
 
-    allocator->end_index = 0;
-    allocator->buffer_size = buffer_size;
-}
+#if defined(C_UTILS_X64_KERNELS) && defined(__linux__)
+    #define C_UTILS_LINUX_SYSCALLS
+#endif
 
-inline void bump_allocator_reset(BumpAllocator *allocator)
-{
-    if (allocator == NULL)
-        return;
-    allocator->end_index = 0;
-}
+// Loads and stores through these types may be unaligned and may alias any other type.
+typedef uint64 unaligned_uint64 __attribute__((aligned(1), may_alias));
+typedef uint32 unaligned_uint32 __attribute__((aligned(1), may_alias));
+typedef uint16 unaligned_uint16 __attribute__((aligned(1), may_alias));
+typedef float unaligned_float32 __attribute__((aligned(1), may_alias));
+typedef double unaligned_float64 __attribute__((aligned(1), may_alias));
 
+#define BYTE_BROADCAST_MULTIPLIER 0x0101010101010101UL
 
-void* bump_allocator_memory_allocate(BumpAllocator *allocator, uint64 size)
-{
-    if (allocator == NULL)
-        return NULL;
+// Blocks shorter than this are handled inline by the word kernels
+// without going through the selected kernel.
+#define MEMORY_KERNEL_SHORT_LENGTH 32
 
-    if (size + allocator->end_index > allocator->buffer_size)
-        return NULL;
 
-    void *memory = allocator->buffer + allocator->end_index;
-    allocator->end_index += size;
-    return memory;
+// Handles the last 0-7 bytes of the word kernels
+// without a byte loop the compiler could turn into a libc call.
+static inline void memory_copy_tail(uint8 *src, uint8 *target, uint64 length)
+{
+    if (length & 4)
+    {
+        *(unaligned_uint32*)target = *(unaligned_uint32*)src;
+        src += 4;
+        target += 4;
+    }
+    if (length & 2)
+    {
+        *(unaligned_uint16*)target = *(unaligned_uint16*)src;
+        src += 2;
+        target += 2;
+    }
+    if (length & 1)
+        *target = *src;
 }
 
 
-void arena_allocator_init(ArenaAllocator *allocator, void* (*get_memory)(uint64), uint64 arena_size, uint32 max_arenas)
+static inline void memory_set_tail(uint8 *memory, uint64 pattern, uint64 length)
 {
-    if (allocator == NULL || get_memory == NULL)
-        return;
+    if (length & 4)
+    {
+        *(unaligned_uint32*)memory = (uint32)pattern;
+        memory += 4;
+    }
+    if (length & 2)
+    {
+        *(unaligned_uint16*)memory = (uint16)pattern;
+        memory += 2;
+    }
+    if (length & 1)
+        *memory = (uint8)pattern;
+}
 
-    if (arena_size == 0 || max_arenas == 0)
-        return;
 
-    allocator->get_memory = get_memory;
-    allocator->arena_size = arena_size;
-    allocator->max_arenas = max_arenas;
-    allocator->num_arenas = 0;
+static inline int memory_are_equal_tail(uint8 *src, uint8 *cmp, uint64 length)
+{
+    uint32 difference = 0;
+    if (length & 4)
+    {
+        difference |= *(unaligned_uint32*)src ^ *(unaligned_uint32*)cmp;
+        src += 4;
+        cmp += 4;
+    }
+    if (length & 2)
+    {
+        difference |= *(unaligned_uint16*)src ^ *(unaligned_uint16*)cmp;
+        src += 2;
+        cmp += 2;
+    }
+    if (length & 1)
+        difference |= *src ^ *cmp;
+    return difference == 0;
+}
 
-    for (uint32 i = 0; i < max_arenas; i++)
-        allocator->arenas[i] = NULL;
 
-    BumpAllocator *arena = get_memory(bump_allocator_size(arena_size));
-    if (arena == NULL)
-        return;
+static inline void memory_set_word(uint8 *memory, uint8 value, uint64 length)
+{
+    const uint64 pattern = value * BYTE_BROADCAST_MULTIPLIER;
+    uint64 i = 0;
 
-    allocator->arenas[0] = arena;
-    allocator->num_arenas = 1;
-    bump_allocator_init(arena, arena_size);
+    for (; i + 32 <= length; i += 32)
+    {
+        *(unaligned_uint64*)(memory + i) = pattern;
+        *(unaligned_uint64*)(memory + i + 8) = pattern;
+        *(unaligned_uint64*)(memory + i + 16) = pattern;
+        *(unaligned_uint64*)(memory + i + 24) = pattern;
+    }
+    for (; i + 8 <= length; i += 8)
+        *(unaligned_uint64*)(memory + i) = pattern;
+
+    memory_set_tail(memory + i, pattern, length - i);
 }
 
 
-void* arena_allocator_memory_allocate(ArenaAllocator *allocator, uint64 size)
+static inline void memory_copy_word(uint8 *src, uint8 *target, uint64 length)
 {
-    if (allocator == NULL)
-        return NULL;
-
-    if (size > allocator->arena_size)
-        return NULL;
+    uint64 a, b, c, d;
+    uint64 i = 0;
 
-    void *memory;
-    BumpAllocator *arena;
-
-    for (uint32 i = 0; i < allocator->num_arenas; i++)
+    // All loads of a block are done before its stores,
+    // this keeps copying to a lower overlapping address valid.
+    for (; i + 32 <= length; i += 32)
     {
-        arena = allocator->arenas[i];
-        memory = bump_allocator_memory_allocate(arena, size);
-        if (memory != NULL)
-            return memory;
+        a = *(unaligned_uint64*)(src + i);
+        b = *(unaligned_uint64*)(src + i + 8);
+        c = *(unaligned_uint64*)(src + i + 16);
+        d = *(unaligned_uint64*)(src + i + 24);
+        *(unaligned_uint64*)(target + i) = a;
+        *(unaligned_uint64*)(target + i + 8) = b;
+        *(unaligned_uint64*)(target + i + 16) = c;
+        *(unaligned_uint64*)(target + i + 24) = d;
     }
+    for (; i + 8 <= length; i += 8)
+        *(unaligned_uint64*)(target + i) = *(unaligned_uint64*)(src + i);
 
-    if (allocator->num_arenas >= allocator->max_arenas)
-        return NULL;
+    memory_copy_tail(src + i, target + i, length - i);
+}
 
-    arena = allocator->get_memory(bump_allocator_size(allocator->arena_size));
-    if (arena == NULL)
-        return NULL;
 
-    allocator->arenas[allocator->num_arenas] = arena;
-    allocator->num_arenas++;
-    bump_allocator_init(arena, allocator->arena_size);
-    return bump_allocator_memory_allocate(arena, size);
+// Copies the first 0-7 bytes of a backward copy. Every load
+// is done before the first store since the blocks may overlap.
+static inline void memory_copy_head_backward(uint8 *src, uint8 *target, uint64 length)
+{
+    uint32 four = 0;
+    uint16 two = 0;
+    uint8 one = 0;
+
+    if (length & 4)
+        four = *(unaligned_uint32*)(src + (length & 3));
+    if (length & 2)
+        two = *(unaligned_uint16*)(src + (length & 1));
+    if (length & 1)
+        one = *src;
+
+    if (length & 4)
+        *(unaligned_uint32*)(target + (length & 3)) = four;
+    if (length & 2)
+        *(unaligned_uint16*)(target + (length & 1)) = two;
+    if (length & 1)
+        *target = one;
 }
 
-inline void arena_allocator_reset(ArenaAllocator *allocator)
+
+// Copy from the highest address down, valid when target > src.
+static inline void memory_copy_backward_word(uint8 *src, uint8 *target, uint64 length)
 {
-    if (allocator == NULL)
-        return;
+    uint64 a, b, c, d;
+    uint64 i = length;
 
-    BumpAllocator *bump_allocator;
-    for (uint32 i = 0; i < allocator->num_arenas; i++)
+    for (; i >= 32; i -= 32)
     {
-        bump_allocator = allocator->arenas[i];
-        bump_allocator_reset(bump_allocator);
+        a = *(unaligned_uint64*)(src + i - 8);
+        b = *(unaligned_uint64*)(src + i - 16);
+        c = *(unaligned_uint64*)(src + i - 24);
+        d = *(unaligned_uint64*)(src + i - 32);
+        *(unaligned_uint64*)(target + i - 8) = a;
+        *(unaligned_uint64*)(target + i - 16) = b;
+        *(unaligned_uint64*)(target + i - 24) = c;
+        *(unaligned_uint64*)(target + i - 32) = d;
+    }
+    for (; i >= 8; i -= 8)
+    {
+        a = *(unaligned_uint64*)(src + i - 8);
+        *(unaligned_uint64*)(target + i - 8) = a;
     }
+
+    memory_copy_head_backward(src, target, i);
 }
 
 
-void arena_allocator_destroy(ArenaAllocator *allocator, void (*free_memory)(void*, uint64))
+static inline int memory_are_equal_word(uint8 *src, uint8 *cmp, uint64 length)
 {
-    if (allocator == NULL || free_memory == NULL)
-        return;
+    uint64 i = 0;
 
-    for (uint32 i = 0; i < allocator->num_arenas; i++)
-        free_memory(allocator->arenas[i], allocator->arena_size);
-    free_memory(allocator, arena_allocator_size(allocator->max_arenas));
+    for (; i + 32 <= length; i += 32)
+    {
+        uint64 difference =
+            (*(unaligned_uint64*)(src + i) ^ *(unaligned_uint64*)(cmp + i)) |
+            (*(unaligned_uint64*)(src + i + 8) ^ *(unaligned_uint64*)(cmp + i + 8)) |
+            (*(unaligned_uint64*)(src + i + 16) ^ *(unaligned_uint64*)(cmp + i + 16)) |
+            (*(unaligned_uint64*)(src + i + 24) ^ *(unaligned_uint64*)(cmp + i + 24));
+        if (difference != 0)
+            return 0;
+    }
+    for (; i + 8 <= length; i += 8)
+    {
+        if (*(unaligned_uint64*)(src + i) != *(unaligned_uint64*)(cmp + i))
+            return 0;
+    }
+    return memory_are_equal_tail(src + i, cmp + i, length - i);
 }
 
 
-inline Array* array_new(AllocatorInterface* allocator, uint32 member_count,  uint32 member_size)
+static void memory_set_word_kernel(uint8 *memory, uint8 value, uint64 length)
 {
-    Array *array = array_new_no_init(allocator, member_count, member_size);
-    if (array == NULL)
-        return NULL;
+    memory_set_word(memory, value, length);
+}
 
-    for (uint64 i = 0; i < member_count * member_size; i++)
-        array->data[i] = 0x00;
 
-    return array;
+static void memory_copy_word_kernel(uint8 *src, uint8 *target, uint64 length)
+{
+    memory_copy_word(src, target, length);
 }
 
 
-Array* array_new_no_init(AllocatorInterface* allocator, uint32 member_count,  uint32 member_size)
+static int memory_are_equal_word_kernel(uint8 *src, uint8 *cmp, uint64 length)
 {
-    if (allocator == NULL)
-        return NULL;
-
-    if (member_count == 0 || member_size == 0)
-        return NULL;
+    return memory_are_equal_word(src, cmp, length);
+}
 
-    void *memory = allocator->memory_allocate(ARRAY_DATA_OFFSET + (member_count * member_size));
-    if (memory == NULL)
-        return NULL;
 
-    Array *array = (Array*) memory;
-    array->member_count = member_count;
-    array->member_size = member_size;
-    return array;
+static void memory_copy_backward_word_kernel(uint8 *src, uint8 *target, uint64 length)
+{
+    memory_copy_backward_word(src, target, length);
 }
 
 
-void array_get(Array *array, uint32 index, uint8 *memory)
+// Reverse the byte order of 'count' members of 2, 4, 8 or 16 bytes.
+static inline void memory_byteswap_word(uint8 *data, uint64 count, uint32 width)
 {
-    if (array == NULL || memory == NULL)
-        return;
+    uint64 i;
+    uint64 high, low;
 
-    if (index >= array->member_count)
-        return;
+    switch (width)
+    {
+        case 2:
+            for (i = 0; i < count; i++)
+                ((unaligned_uint16*)data)[i] = __builtin_bswap16(((unaligned_uint16*)data)[i]);
+            break;
+
+        case 4:
+            for (i = 0; i < count; i++)
+                ((unaligned_uint32*)data)[i] = __builtin_bswap32(((unaligned_uint32*)data)[i]);
+            break;
+
+        case 8:
+            for (i = 0; i < count; i++)
+                ((unaligned_uint64*)data)[i] = __builtin_bswap64(((unaligned_uint64*)data)[i]);
+            break;
 
-    uint32 offset = array->member_size * index;
-    for (uint32 i = 0; i < array->member_size; i++)
-        memory[i] = array->data[offset + i];
+        case 16:
+            for (i = 0; i < count; i++)
+            {
+                low = ((unaligned_uint64*)data)[2 * i];
+                high = ((unaligned_uint64*)data)[2 * i + 1];
+                ((unaligned_uint64*)data)[2 * i] = __builtin_bswap64(high);
+                ((unaligned_uint64*)data)[2 * i + 1] = __builtin_bswap64(low);
+            }
+            break;
+    }
 }
 
 
-void array_set(Array *array, uint32 index, uint8 *memory)
+static void memory_byteswap_word_kernel(uint8 *data, uint64 count, uint32 width)
 {
-    if (array == NULL || memory == NULL)
-        return;
+    memory_byteswap_word(data, count, width);
+}
 
-    if (index >= array->member_count)
-        return;
 
-    uint32 offset = array->member_size * index;
-    for (uint32 i = 0; i < array->member_size; i++)
-        array->data[offset + i] = memory[i];
-}
+#ifdef C_UTILS_X64_KERNELS
 
+typedef uint8 vec16 __attribute__((vector_size(16), aligned(1), may_alias));
+typedef uint8 vec32 __attribute__((vector_size(32), aligned(1), may_alias));
+typedef char vec16_mask __attribute__((vector_size(16)));
+typedef char vec32_mask __attribute__((vector_size(32)));
 
-void array_copy_memory(Array *array, uint8 *memory, uint64 max_length)
+
+static void memory_set_sse2(uint8 *memory, uint8 value, uint64 length)
 {
-    if (array == NULL || memory == NULL)
-        return;
+    vec16 pattern = { 0 };
+    pattern += value;
+    uint64 i = 0;
 
-    for (uint64 i = 0; i < array->member_count * array->member_size; i++)
+    for (; i + 64 <= length; i += 64)
     {
-        if (i >= max_length)
-            break;
-
-        array->data[i] = memory[i];
+        *(vec16*)(memory + i) = pattern;
+        *(vec16*)(memory + i + 16) = pattern;
+        *(vec16*)(memory + i + 32) = pattern;
+        *(vec16*)(memory + i + 48) = pattern;
     }
+    for (; i + 16 <= length; i += 16)
+        *(vec16*)(memory + i) = pattern;
+
+    memory_set_word(memory + i, value, length - i);
 }
 
 
-Array* array_create_slice(Array *src_array, AllocatorInterface *allocator, uint32 start, uint32 end)
+static void memory_copy_sse2(uint8 *src, uint8 *target, uint64 length)
 {
-    if (src_array == NULL || allocator == NULL)
-        return NULL;
+    vec16 a, b, c, d;
+    uint64 i = 0;
 
-    if (start >= src_array->member_count)
-        return NULL;
+    for (; i + 64 <= length; i += 64)
+    {
+        a = *(vec16*)(src + i);
+        b = *(vec16*)(src + i + 16);
+        c = *(vec16*)(src + i + 32);
+        d = *(vec16*)(src + i + 48);
+        *(vec16*)(target + i) = a;
+        *(vec16*)(target + i + 16) = b;
+        *(vec16*)(target + i + 32) = c;
+        *(vec16*)(target + i + 48) = d;
+    }
+    for (; i + 16 <= length; i += 16)
+        *(vec16*)(target + i) = *(vec16*)(src + i);
 
-    if (end >= src_array->member_count)
-        return NULL;
+    memory_copy_word(src + i, target + i, length - i);
+}
 
-    if (end-start <= 0)
-        return NULL;
 
-    Array *slice_array = array_new(allocator, end-start, src_array->member_size);
-    if (slice_array == NULL)
-        return NULL;
+static void memory_copy_backward_sse2(uint8 *src, uint8 *target, uint64 length)
+{
+    vec16 a, b, c, d;
+    uint64 i = length;
 
-    uint32 offset = start * src_array->member_size;
-    uint32 i_last = (end-start) * src_array->member_size;
-    for (uint64 i = 0; i < i_last; i++)
-        slice_array->data[i] = src_array->data[offset+i];
+    for (; i >= 64; i -= 64)
+    {
+        a = *(vec16*)(src + i - 16);
+        b = *(vec16*)(src + i - 32);
+        c = *(vec16*)(src + i - 48);
+        d = *(vec16*)(src + i - 64);
+        *(vec16*)(target + i - 16) = a;
+        *(vec16*)(target + i - 32) = b;
+        *(vec16*)(target + i - 48) = c;
+        *(vec16*)(target + i - 64) = d;
+    }
+    for (; i >= 16; i -= 16)
+    {
+        a = *(vec16*)(src + i - 16);
+        *(vec16*)(target + i - 16) = a;
+    }
 
-    return slice_array;
+    memory_copy_backward_word(src, target, i);
 }
 
 
-void array_foreach(Array *array, void (*func)(uint8*))
+static int memory_are_equal_sse2(uint8 *src, uint8 *cmp, uint64 length)
 {
-    if (array == NULL || func == NULL)
-        return;
+    uint64 i = 0;
 
-    for (uint64 i = 0; i < array->member_count * array->member_size; i += array->member_size)
-        func(&array->data[i]);
+    for (; i + 64 <= length; i += 64)
+    {
+        vec16_mask equal =
+            (vec16_mask)(*(vec16*)(src + i) == *(vec16*)(cmp + i)) &
+            (vec16_mask)(*(vec16*)(src + i + 16) == *(vec16*)(cmp + i + 16)) &
+            (vec16_mask)(*(vec16*)(src + i + 32) == *(vec16*)(cmp + i + 32)) &
+            (vec16_mask)(*(vec16*)(src + i + 48) == *(vec16*)(cmp + i + 48));
+        if (__builtin_ia32_pmovmskb128(equal) != 0xFFFF)
+            return 0;
+    }
+    for (; i + 16 <= length; i += 16)
+    {
+        vec16_mask equal = (vec16_mask)(*(vec16*)(src + i) == *(vec16*)(cmp + i));
+        if (__builtin_ia32_pmovmskb128(equal) != 0xFFFF)
+            return 0;
+    }
+    return memory_are_equal_word(src + i, cmp + i, length - i);
 }
 
 
-static void swap(Array *array, uint32 index_a, uint32 index_b)
-{
-    if (array == NULL)
-        return;
-
-    if (index_a >= array->member_count || index_b >= array->member_count)
-        return;
+// pshufb control masks reversing every member of 2, 4, 8 and 16 bytes in a 16 byte lane.
+static const vec16_mask BYTESWAP_MASK_2 = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };
+static const vec16_mask BYTESWAP_MASK_4 = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+static const vec16_mask BYTESWAP_MASK_8 = { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 };
+static const vec16_mask BYTESWAP_MASK_16 = { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
 
-    uint8 temp;
-    const uint32 member_size = array->member_size;
-    const uint32 offset_a = member_size * index_a;
-    const uint32 offset_b = member_size * index_b;
 
-    for (uint32 i = 0; i < member_size; i++)
+static inline vec16_mask byteswap_mask(uint32 width)
+{
+    switch (width)
     {
-        temp = array->data[offset_a + i];
-        array->data[offset_a + i] = array->data[offset_b + i];
-        array->data[offset_b + i] = temp;
+        case 2: return BYTESWAP_MASK_2;
+        case 4: return BYTESWAP_MASK_4;
+        case 8: return BYTESWAP_MASK_8;
+        default: return BYTESWAP_MASK_16;
     }
 }
 
 
-static int64 partition(Array *array, int64 start, int64 end, enum ComparisonResult (*compare)(uint8*, uint8*))
+__attribute__((target("ssse3")))
+static void memory_byteswap_ssse3(uint8 *data, uint64 count, uint32 width)
 {
-    uint32 member_size = array->member_size;
+    const vec16_mask mask = byteswap_mask(width);
+    const uint64 length = count * width;
+    uint64 i = 0;
 
-    uint8 *pivot = &array->data[member_size * end];
-    uint8 *comparison;
-    int64 index = start - 1;
-
-    for (uint32 i = start; i < end; i++)
+    for (; i + 64 <= length; i += 64)
     {
-        comparison = &array->data[member_size * i];
-        if (compare(comparison, pivot) == COMPARISON_RESULT_FIRST_IS_SMALLER)
-            swap(array, ++index, i);
+        *(vec16*)(data + i) = (vec16)__builtin_ia32_pshufb128((vec16_mask)*(vec16*)(data + i), mask);
+        *(vec16*)(data + i + 16) = (vec16)__builtin_ia32_pshufb128((vec16_mask)*(vec16*)(data + i + 16), mask);
+        *(vec16*)(data + i + 32) = (vec16)__builtin_ia32_pshufb128((vec16_mask)*(vec16*)(data + i + 32), mask);
+        *(vec16*)(data + i + 48) = (vec16)__builtin_ia32_pshufb128((vec16_mask)*(vec16*)(data + i + 48), mask);
     }
+    for (; i + 16 <= length; i += 16)
+        *(vec16*)(data + i) = (vec16)__builtin_ia32_pshufb128((vec16_mask)*(vec16*)(data + i), mask);
 
-    swap(array, ++index, end);
-    return index;
+    memory_byteswap_word(data + i, (length - i) / width, width);
 }
 
 
-void quicksort(Array *array, int64 start, int64 end, enum ComparisonResult (*compare)(uint8*, uint8*))
+__attribute__((target("avx2")))
+static void memory_byteswap_avx2(uint8 *data, uint64 count, uint32 width)
 {
-    if (start >= end || start < 0 || end < 0)
-        return;
+    // vpshufb shuffles within each 128-bit lane, so the same mask is used for both lanes.
+    const vec16_mask lane_mask = byteswap_mask(width);
+    vec32_mask mask;
+    for (uint32 j = 0; j < 32; j++)
+        mask[j] = lane_mask[j & 15];
+
+    const uint64 length = count * width;
+    uint64 i = 0;
 
-    int64 pivot_index = partition(array, start, end, compare);
+    for (; i + 128 <= length; i += 128)
+    {
+        *(vec32*)(data + i) = (vec32)__builtin_ia32_pshufb256((vec32_mask)*(vec32*)(data + i), mask);
+        *(vec32*)(data + i + 32) = (vec32)__builtin_ia32_pshufb256((vec32_mask)*(vec32*)(data + i + 32), mask);
+        *(vec32*)(data + i + 64) = (vec32)__builtin_ia32_pshufb256((vec32_mask)*(vec32*)(data + i + 64), mask);
+        *(vec32*)(data + i + 96) = (vec32)__builtin_ia32_pshufb256((vec32_mask)*(vec32*)(data + i + 96), mask);
+    }
+    for (; i + 32 <= length; i += 32)
+        *(vec32*)(data + i) = (vec32)__builtin_ia32_pshufb256((vec32_mask)*(vec32*)(data + i), mask);
 
-    quicksort(array, start, pivot_index - 1, compare);
-    quicksort(array, pivot_index + 1, end, compare);
+    memory_byteswap_word(data + i, (length - i) / width, width);
 }
 
 
-inline void array_sort(Array *array, enum ComparisonResult (*compare)(uint8*, uint8*))
+__attribute__((target("avx2")))
+static void memory_set_avx2(uint8 *memory, uint8 value, uint64 length)
 {
-    if (array == NULL || compare == NULL)
-        return;
+    vec32 pattern = { 0 };
+    pattern += value;
+    uint64 i = 0;
 
-    quicksort(array, 0, ((int64)array->member_count) - 1, compare);
+    for (; i + 128 <= length; i += 128)
+    {
+        *(vec32*)(memory + i) = pattern;
+        *(vec32*)(memory + i + 32) = pattern;
+        *(vec32*)(memory + i + 64) = pattern;
+        *(vec32*)(memory + i + 96) = pattern;
+    }
+    for (; i + 32 <= length; i += 32)
+        *(vec32*)(memory + i) = pattern;
+
+    memory_set_word(memory + i, value, length - i);
 }
 
 
-Array* array_map(Array *array, AllocatorInterface *allocator, void (*func)(uint8*))
+__attribute__((target("avx2")))
+static void memory_copy_avx2(uint8 *src, uint8 *target, uint64 length)
 {
-    if (array == NULL || allocator == NULL || func == NULL)
-        return NULL;
+    vec32 a, b, c, d;
+    uint64 i = 0;
 
-    Array *new_array = array_new(allocator, array->member_count, array->member_size);
-    if (new_array == NULL)
-        return NULL;
+    for (; i + 128 <= length; i += 128)
+    {
+        a = *(vec32*)(src + i);
+        b = *(vec32*)(src + i + 32);
+        c = *(vec32*)(src + i + 64);
+        d = *(vec32*)(src + i + 96);
+        *(vec32*)(target + i) = a;
+        *(vec32*)(target + i + 32) = b;
+        *(vec32*)(target + i + 64) = c;
+        *(vec32*)(target + i + 96) = d;
+    }
+    for (; i + 32 <= length; i += 32)
+        *(vec32*)(target + i) = *(vec32*)(src + i);
 
-    array_foreach(new_array, func);
-    return new_array;
+    memory_copy_word(src + i, target + i, length - i);
 }
 
 
-Array* array_filter(Array *array, AllocatorInterface *allocator, int (*func)(uint8*))
+__attribute__((target("avx2")))
+static void memory_copy_backward_avx2(uint8 *src, uint8 *target, uint64 length)
 {
-    if (array == NULL || allocator == NULL || func == NULL)
-        return NULL;
-
-    uint64 src_offset;
-    uint64 dest_offset;
-    uint32 passed_items = 0;
-    uint32 index = 0;
+    vec32 a, b, c, d;
+    uint64 i = length;
 
-    for (uint32 i = 0; i < array->member_count; i++)
+    for (; i >= 128; i -= 128)
     {
-        src_offset = i * array->member_size;
-        if (func((uint8*)&array->data[src_offset]))
-            passed_items++;
+        a = *(vec32*)(src + i - 32);
+        b = *(vec32*)(src + i - 64);
+        c = *(vec32*)(src + i - 96);
+        d = *(vec32*)(src + i - 128);
+        *(vec32*)(target + i - 32) = a;
+        *(vec32*)(target + i - 64) = b;
+        *(vec32*)(target + i - 96) = c;
+        *(vec32*)(target + i - 128) = d;
     }
-
-    Array *new_array = array_new(allocator, passed_items, array->member_size);
-    if (new_array == NULL)
-        return NULL;
-
-    for (uint32 i = 0; i < array->member_count; i++)
+    for (; i >= 32; i -= 32)
     {
-        src_offset = i * array->member_size;
-        if (func((uint8*)&array->data[src_offset]))
-        {
-            dest_offset = index++ * array->member_size;
-            for (uint32 j = 0; j < array->member_size; j++)
-                new_array->data[dest_offset + j] = array->data[src_offset + j];
-        }
+        a = *(vec32*)(src + i - 32);
+        *(vec32*)(target + i - 32) = a;
     }
-    return new_array;
+
+    memory_copy_backward_word(src, target, i);
 }
 
 
-Array* array_reverse(Array *array, AllocatorInterface *allocator)
+__attribute__((target("avx2")))
+static int memory_are_equal_avx2(uint8 *src, uint8 *cmp, uint64 length)
 {
-    if (array == NULL || allocator == NULL)
-        return NULL;
-
-    Array *new_array = array_new(allocator, array->member_count, array->member_size);
-    if (new_array == NULL)
-        return NULL;
+    uint64 i = 0;
 
-    uint32 start_offset, end_offset;
-    for (int64 i = array->member_count - 1; i > -1; i--)
+    for (; i + 128 <= length; i += 128)
     {
-        start_offset = (array->member_count - i - 1) * array->member_size;
-        end_offset = i * array->member_size;
-        for (uint32 j = 0; j < array->member_size; j++)
-            new_array->data[start_offset + j] = array->data[end_offset + j];
+        vec32_mask equal =
+            (vec32_mask)(*(vec32*)(src + i) == *(vec32*)(cmp + i)) &
+            (vec32_mask)(*(vec32*)(src + i + 32) == *(vec32*)(cmp + i + 32)) &
+            (vec32_mask)(*(vec32*)(src + i + 64) == *(vec32*)(cmp + i + 64)) &
+            (vec32_mask)(*(vec32*)(src + i + 96) == *(vec32*)(cmp + i + 96));
+        if ((uint32)__builtin_ia32_pmovmskb256(equal) != 0xFFFFFFFF)
+            return 0;
     }
-    return new_array;
+    for (; i + 32 <= length; i += 32)
+    {
+        vec32_mask equal = (vec32_mask)(*(vec32*)(src + i) == *(vec32*)(cmp + i));
+        if ((uint32)__builtin_ia32_pmovmskb256(equal) != 0xFFFFFFFF)
+            return 0;
+    }
+    return memory_are_equal_word(src + i, cmp + i, length - i);
 }
 
 
-int64 array_find_index(Array *array, uint32 start_index, int (*func)(uint8*))
+static inline void cpuid(uint32 leaf, uint32 subleaf, uint32 registers[4])
 {
-    if (array == NULL || func == NULL)
-        return -2;
+    __asm__ volatile (
+        "cpuid"
+        : "=a"(registers[0]), "=b"(registers[1]), "=c"(registers[2]), "=d"(registers[3])
+        : "a"(leaf), "c"(subleaf)
+    );
+}
 
-    if (start_index >= array->member_count)
-        return -3;
 
-    uint64 offset;
-    for (uint32 index = start_index; index < array->member_count; index++)
-    {
-        offset = index * array->member_size;
-        if (func((uint8*)&array->data[offset]))
-            return index;
-    }
-    return -1;
+static inline uint64 xgetbv(uint32 index)
+{
+    uint32 low, high;
+    __asm__ volatile ("xgetbv" : "=a"(low), "=d"(high) : "c"(index));
+    return ((uint64)high << 32) | low;
 }
 
+#endif
 
-void array_find_item(Array *array, uint32 start_index, int (*func)(uint8*), uint8 *memory)
+
+enum SimdLevel platform_simd_level()
 {
-    if (array == NULL || func == NULL || memory == NULL)
+#ifdef C_UTILS_X64_KERNELS
+    const uint32 SSSE3_BIT = 1 << 9;
+    const uint32 OSXSAVE_BIT = 1 << 27;
+    const uint32 AVX_BIT = 1 << 28;
+    const uint32 AVX2_BIT = 1 << 5;
+    // The OS must save both the XMM and YMM registers on context switch.
+    const uint64 XCR0_SSE_AVX_STATE = 0x06;
+
+    uint32 registers[4];
+    cpuid(0, 0, registers);
+    const uint32 max_leaf = registers[0];
+
+    cpuid(1, 0, registers);
+    if ((registers[2] & SSSE3_BIT) == 0)
+        return SIMD_LEVEL_SSE2;
+
+    if (max_leaf < 7)
+        return SIMD_LEVEL_SSSE3;
+
+    if ((registers[2] & OSXSAVE_BIT) == 0 || (registers[2] & AVX_BIT) == 0)
+        return SIMD_LEVEL_SSSE3;
+
+    if ((xgetbv(0) & XCR0_SSE_AVX_STATE) != XCR0_SSE_AVX_STATE)
+        return SIMD_LEVEL_SSSE3;
+
+    cpuid(7, 0, registers);
+    if (registers[1] & AVX2_BIT)
+        return SIMD_LEVEL_AVX2;
+    return SIMD_LEVEL_SSSE3;
+#else
+    return SIMD_LEVEL_WORD;
+#endif
+}
+
+
+#ifdef C_UTILS_LINUX_SYSCALLS
+
+#define SYSCALL_MMAP 9
+#define SYSCALL_MUNMAP 11
+#define SYSCALL_MADVISE 28
+
+#define MMAP_PROT_READ_WRITE 0x03
+#define MMAP_PRIVATE_ANONYMOUS 0x22
+#define MMAP_NORESERVE 0x4000
+
+#define MADVISE_DONTNEED 4
+#define MADVISE_HUGEPAGE 14
+
+static inline int64 syscall6(int64 number, int64 a, int64 b, int64 c, int64 d, int64 e, int64 f)
+{
+    int64 result;
+    register int64 r10 __asm__("r10") = d;
+    register int64 r8 __asm__("r8") = e;
+    register int64 r9 __asm__("r9") = f;
+    __asm__ volatile ("syscall"
+        : "=a"(result)
+        : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9)
+        : "rcx", "r11", "memory");
+    return result;
+}
+
+
+static inline uint8* system_mmap(uint64 size)
+{
+    int64 result = syscall6(SYSCALL_MMAP, 0, size, MMAP_PROT_READ_WRITE, MMAP_PRIVATE_ANONYMOUS | MMAP_NORESERVE, -1, 0);
+    // Errors are returned as negative errno values.
+    if (result < 0 && result > -PLATFORM_PAGE_SIZE)
+        return NULL;
+    return (uint8*)result;
+}
+
+#endif
+
+
+static inline uint64 round_up(uint64 value, uint64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+
+void* platform_memory_map(uint64 size)
+{
+#ifdef C_UTILS_LINUX_SYSCALLS
+    if (size == 0)
+        return NULL;
+
+    size = round_up(size, PLATFORM_PAGE_SIZE);
+    if (size < PLATFORM_HUGE_PAGE_SIZE)
+        return system_mmap(size);
+
+    // Reserve an extra huge page and unmap the misaligned head and tail.
+    uint8 *reserved = system_mmap(size + PLATFORM_HUGE_PAGE_SIZE);
+    if (reserved == NULL)
+        return NULL;
+
+    uint8 *memory = (uint8*)round_up((uint64)reserved, PLATFORM_HUGE_PAGE_SIZE);
+    uint64 head = memory - reserved;
+    if (head > 0)
+        syscall6(SYSCALL_MUNMAP, (int64)reserved, head, 0, 0, 0, 0);
+    syscall6(SYSCALL_MUNMAP, (int64)(memory + size), PLATFORM_HUGE_PAGE_SIZE - head, 0, 0, 0, 0);
+
+    syscall6(SYSCALL_MADVISE, (int64)memory, size, MADVISE_HUGEPAGE, 0, 0, 0);
+    return memory;
+#else
+    (void)size;
+    return NULL;
+#endif
+}
+
+
+void platform_memory_unmap(void *memory, uint64 size)
+{
+#ifdef C_UTILS_LINUX_SYSCALLS
+    if (memory == NULL || size == 0)
         return;
 
-    if (start_index >= array->member_count)
+    syscall6(SYSCALL_MUNMAP, (int64)memory, round_up(size, PLATFORM_PAGE_SIZE), 0, 0, 0, 0);
+#else
+    (void)memory;
+    (void)size;
+#endif
+}
+
+
+void platform_memory_release(void *memory, uint64 size)
+{
+#ifdef C_UTILS_LINUX_SYSCALLS
+    if (memory == NULL)
         return;
 
-    uint64 offset;
-    for (uint32 index = start_index; index < array->member_count; index++)
+    uint64 start = round_up((uint64)memory, PLATFORM_PAGE_SIZE);
+    uint64 end = ((uint64)memory + size) & ~(uint64)(PLATFORM_PAGE_SIZE - 1);
+    if (end > start)
+        syscall6(SYSCALL_MADVISE, (int64)start, end - start, MADVISE_DONTNEED, 0, 0, 0);
+#else
+    (void)memory;
+    (void)size;
+#endif
+}
+
+
+static void memory_set_resolve(uint8*, uint8, uint64);
+static void memory_copy_resolve(uint8*, uint8*, uint64);
+static int memory_are_equal_resolve(uint8*, uint8*, uint64);
+static void memory_copy_backward_resolve(uint8*, uint8*, uint64);
+static void memory_byteswap_resolve(uint8*, uint64, uint32);
+
+// The kernels resolve themselves on first call. Concurrent first calls
+// are harmless, every thread stores the same function pointers.
+static void (*memory_set_kernel)(uint8*, uint8, uint64) = memory_set_resolve;
+static void (*memory_copy_kernel)(uint8*, uint8*, uint64) = memory_copy_resolve;
+static int (*memory_are_equal_kernel)(uint8*, uint8*, uint64) = memory_are_equal_resolve;
+static void (*memory_copy_backward_kernel)(uint8*, uint8*, uint64) = memory_copy_backward_resolve;
+static void (*memory_byteswap_kernel)(uint8*, uint64, uint32) = memory_byteswap_resolve;
+
+
+void memory_kernels_select(enum SimdLevel level)
+{
+    enum SimdLevel supported_level = platform_simd_level();
+    if (level > supported_level)
+        level = supported_level;
+
+    switch (level)
     {
-        offset = index * array->member_size;
-        if (func((uint8*)&array->data[offset]))
-        {
-            for (uint32 i = 0; i < array->member_size; i++)
-                memory[i] = array->data[offset + i];
-            return;
-        }
+#ifdef C_UTILS_X64_KERNELS
+        case SIMD_LEVEL_AVX2:
+            memory_set_kernel = memory_set_avx2;
+            memory_copy_kernel = memory_copy_avx2;
+            memory_are_equal_kernel = memory_are_equal_avx2;
+            memory_copy_backward_kernel = memory_copy_backward_avx2;
+            memory_byteswap_kernel = memory_byteswap_avx2;
+            break;
+
+        case SIMD_LEVEL_SSSE3:
+            memory_set_kernel = memory_set_sse2;
+            memory_copy_kernel = memory_copy_sse2;
+            memory_are_equal_kernel = memory_are_equal_sse2;
+            memory_copy_backward_kernel = memory_copy_backward_sse2;
+            memory_byteswap_kernel = memory_byteswap_ssse3;
+            break;
+
+        case SIMD_LEVEL_SSE2:
+            memory_set_kernel = memory_set_sse2;
+            memory_copy_kernel = memory_copy_sse2;
+            memory_are_equal_kernel = memory_are_equal_sse2;
+            memory_copy_backward_kernel = memory_copy_backward_sse2;
+            memory_byteswap_kernel = memory_byteswap_word_kernel;
+            break;
+#endif
+        default:
+            memory_set_kernel = memory_set_word_kernel;
+            memory_copy_kernel = memory_copy_word_kernel;
+            memory_are_equal_kernel = memory_are_equal_word_kernel;
+            memory_copy_backward_kernel = memory_copy_backward_word_kernel;
+            memory_byteswap_kernel = memory_byteswap_word_kernel;
+            break;
     }
 }
 
 
-void array_reduce(Array *array, void (*func)(uint8*, uint8*, uint8*), uint8 *result)
+static void memory_set_resolve(uint8 *memory, uint8 value, uint64 length)
 {
-    if (array == NULL || func == NULL || result == NULL)
+    memory_kernels_select(platform_simd_level());
+    memory_set_kernel(memory, value, length);
+}
+
+
+static void memory_copy_resolve(uint8 *src, uint8 *target, uint64 length)
+{
+    memory_kernels_select(platform_simd_level());
+    memory_copy_kernel(src, target, length);
+}
+
+
+static int memory_are_equal_resolve(uint8 *src, uint8 *cmp, uint64 length)
+{
+    memory_kernels_select(platform_simd_level());
+    return memory_are_equal_kernel(src, cmp, length);
+}
+
+
+static void memory_copy_backward_resolve(uint8 *src, uint8 *target, uint64 length)
+{
+    memory_kernels_select(platform_simd_level());
+    memory_copy_backward_kernel(src, target, length);
+}
+
+
+static void memory_byteswap_resolve(uint8 *data, uint64 count, uint32 width)
+{
+    memory_kernels_select(platform_simd_level());
+    memory_byteswap_kernel(data, count, width);
+}
+
+
+void memory_set(uint8 *memory, uint8 value, uint64 length)
+{
+    if (length < MEMORY_KERNEL_SHORT_LENGTH)
+        memory_set_word(memory, value, length);
+    else
+        memory_set_kernel(memory, value, length);
+}
+
+
+void memory_copy(uint8 *src, uint8 *target, uint64 length)
+{
+    if (length < MEMORY_KERNEL_SHORT_LENGTH)
+        memory_copy_word(src, target, length);
+    else
+        memory_copy_kernel(src, target, length);
+}
+
+
+int memory_are_equal(uint8 *src, uint8 *cmp, uint64 length)
+{
+    if (length < MEMORY_KERNEL_SHORT_LENGTH)
+        return memory_are_equal_word(src, cmp, length);
+    return memory_are_equal_kernel(src, cmp, length);
+}
+
+
+void memory_move(uint8 *src, uint8 *target, uint64 length)
+{
+    // Forward copy is safe unless target is inside the source block.
+    if (target <= src || target >= src + length)
+        memory_copy(src, target, length);
+    else if (length < MEMORY_KERNEL_SHORT_LENGTH)
+        memory_copy_backward_word(src, target, length);
+    else
+        memory_copy_backward_kernel(src, target, length);
+}
+
+
+#ifdef C_UTILS_ALLOCATOR_STATS
+    #define ALLOCATOR_STATS_INIT(counters) memory_set((uint8*)(counters), 0x00, sizeof(AllocatorCounters))
+    #define ALLOCATOR_STATS_RESET(counters) \
+        ((counters)->bytes_requested = 0, (counters)->bytes_used = 0, (counters)->peak_bytes_used = 0, (counters)->allocations = 0)
+    #define ALLOCATOR_STATS_ALLOCATED(counters, size) ((counters)->bytes_requested += (size), (counters)->allocations++)
+    #define ALLOCATOR_STATS_FAILED(counters) ((counters)->failed_allocations++)
+    #define ALLOCATOR_STATS_PEAK(counters, used) ((counters)->peak_bytes_used = max((counters)->peak_bytes_used, (used)))
+    #define ALLOCATOR_STATS_USED(counters, size) ((counters)->bytes_used += (size), ALLOCATOR_STATS_PEAK(counters, (counters)->bytes_used))
+    #define ALLOCATOR_STATS_UNUSED(counters, size) ((counters)->bytes_used -= (size))
+    #define ALLOCATOR_STATS_RESERVED(counters, size) ((counters)->bytes_reserved += (size))
+    #define ALLOCATOR_STATS_CONCURRENT_ALLOCATED(counters, size) ( \
+        __atomic_fetch_add(&(counters)->bytes_requested, (size), __ATOMIC_RELAXED), \
+        __atomic_fetch_add(&(counters)->allocations, 1, __ATOMIC_RELAXED))
+    #define ALLOCATOR_STATS_CONCURRENT_FAILED(counters) __atomic_fetch_add(&(counters)->failed_allocations, 1, __ATOMIC_RELAXED)
+#else
+    #define ALLOCATOR_STATS_INIT(counters) ((void)0)
+    #define ALLOCATOR_STATS_RESET(counters) ((void)0)
+    #define ALLOCATOR_STATS_ALLOCATED(counters, size) ((void)0)
+    #define ALLOCATOR_STATS_FAILED(counters) ((void)0)
+    #define ALLOCATOR_STATS_PEAK(counters, used) ((void)0)
+    #define ALLOCATOR_STATS_USED(counters, size) ((void)0)
+    #define ALLOCATOR_STATS_UNUSED(counters, size) ((void)0)
+    #define ALLOCATOR_STATS_RESERVED(counters, size) ((void)0)
+    #define ALLOCATOR_STATS_CONCURRENT_ALLOCATED(counters, size) ((void)0)
+    #define ALLOCATOR_STATS_CONCURRENT_FAILED(counters) ((void)0)
+#endif
+
+
+void bump_allocator_init(BumpAllocator *allocator, uint64 buffer_size)
+{
+    if (allocator == NULL)
         return;
 
-    uint8 *current_value = NULL;
-    uint8 *previous_value = NULL;
-    uint64 offset;
+    allocator->end_index = 0;
+    allocator->buffer_size = buffer_size;
+    ALLOCATOR_STATS_INIT(&allocator->counters);
+}
 
-    for (uint32 index = 0; index < array->member_count; index++)
+inline void bump_allocator_reset(BumpAllocator *allocator)
+{
+    if (allocator == NULL)
+        return;
+    allocator->end_index = 0;
+    ALLOCATOR_STATS_RESET(&allocator->counters);
+}
+
+
+void* bump_allocator_memory_allocate(BumpAllocator *allocator, uint64 size)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (size + allocator->end_index > allocator->buffer_size)
     {
-        offset = index * array->member_size;
-        current_value = (uint8*)&array->data[offset];
+        ALLOCATOR_STATS_FAILED(&allocator->counters);
+        return NULL;
+    }
 
-        if (previous_value == NULL)
-            previous_value = result;
+    void *memory = allocator->buffer + allocator->end_index;
+    allocator->end_index += size;
+    ALLOCATOR_STATS_ALLOCATED(&allocator->counters, size);
+    return memory;
+}
 
-        func(previous_value, current_value, result);
-        previous_value = current_value;
+
+static inline int alignment_is_valid(uint64 alignment)
+{
+    return alignment != 0 && alignment <= PLATFORM_PAGE_SIZE && (alignment & (alignment - 1)) == 0;
+}
+
+
+void* bump_allocator_memory_allocate_aligned(BumpAllocator *allocator, uint64 size, uint64 alignment)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (!alignment_is_valid(alignment))
+        return NULL;
+
+    uint64 address = (uint64)(allocator->buffer + allocator->end_index);
+    uint64 padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+    uint64 start = allocator->end_index + padding;
+
+    if (start > allocator->buffer_size || size > allocator->buffer_size - start)
+    {
+        ALLOCATOR_STATS_FAILED(&allocator->counters);
+        return NULL;
+    }
+
+    allocator->end_index = start + size;
+    ALLOCATOR_STATS_ALLOCATED(&allocator->counters, size);
+    return allocator->buffer + start;
+}
+
+
+void* bump_allocator_memory_allocate_concurrent(BumpAllocator *allocator, uint64 size, uint64 alignment)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (!alignment_is_valid(alignment))
+        return NULL;
+
+    uint64 start;
+    if (alignment == 1)
+    {
+        // A size past the buffer could wrap end_index below memory handed out already.
+        if (size > allocator->buffer_size)
+        {
+            ALLOCATOR_STATS_CONCURRENT_FAILED(&allocator->counters);
+            return NULL;
+        }
+
+        start = __atomic_fetch_add(&allocator->end_index, size, __ATOMIC_RELAXED);
+        if (start <= allocator->buffer_size && size <= allocator->buffer_size - start)
+        {
+            ALLOCATOR_STATS_CONCURRENT_ALLOCATED(&allocator->counters, size);
+            return allocator->buffer + start;
+        }
+
+        // Give the space back unless another thread has claimed space after us.
+        uint64 expected = start + size;
+        __atomic_compare_exchange_n(&allocator->end_index, &expected, start, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        ALLOCATOR_STATS_CONCURRENT_FAILED(&allocator->counters);
+        return NULL;
+    }
+
+    uint64 end_index = __atomic_load_n(&allocator->end_index, __ATOMIC_RELAXED);
+    do
+    {
+        uint64 address = (uint64)(allocator->buffer + end_index);
+        uint64 padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+        start = end_index + padding;
+
+        if (start > allocator->buffer_size || size > allocator->buffer_size - start)
+        {
+            ALLOCATOR_STATS_CONCURRENT_FAILED(&allocator->counters);
+            return NULL;
+        }
+    }
+    while (!__atomic_compare_exchange_n(&allocator->end_index, &end_index, start + size, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    ALLOCATOR_STATS_CONCURRENT_ALLOCATED(&allocator->counters, size);
+    return allocator->buffer + start;
+}
+
+
+// Return 1 if the block ends where the next allocation would start.
+static inline int bump_allocator_is_newest(BumpAllocator *allocator, uint8 *memory, uint64 size)
+{
+    return memory + size == allocator->buffer + allocator->end_index;
+}
+
+
+// Try to give the newest allocation a new size without moving it.
+static inline int bump_allocator_resize_in_place(BumpAllocator *allocator, uint8 *memory, uint64 old_size, uint64 new_size)
+{
+    if (!bump_allocator_is_newest(allocator, memory, old_size))
+        return 0;
+
+    uint64 start = (uint64)(memory - allocator->buffer);
+    if (new_size > allocator->buffer_size - start)
+        return 0;
+
+    ALLOCATOR_STATS_PEAK(&allocator->counters, allocator->end_index);
+    allocator->end_index = start + new_size;
+    return 1;
+}
+
+
+void* bump_allocator_memory_resize(BumpAllocator *allocator, void *memory, uint64 old_size, uint64 new_size)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (memory == NULL)
+        return bump_allocator_memory_allocate_aligned(allocator, new_size, ALLOCATOR_DEFAULT_ALIGNMENT);
+
+    if (bump_allocator_resize_in_place(allocator, memory, old_size, new_size))
+        return memory;
+
+    if (new_size <= old_size)
+        return memory;
+
+    void *new_memory = bump_allocator_memory_allocate_aligned(allocator, new_size, ALLOCATOR_DEFAULT_ALIGNMENT);
+    if (new_memory != NULL)
+        memory_copy(memory, new_memory, old_size);
+    return new_memory;
+}
+
+
+static void* bump_allocator_interface_allocate(void *context, uint64 size)
+{
+    return bump_allocator_memory_allocate_aligned(context, size, ALLOCATOR_DEFAULT_ALIGNMENT);
+}
+
+
+static void* bump_allocator_interface_resize(void *context, void *memory, uint64 old_size, uint64 new_size)
+{
+    return bump_allocator_memory_resize(context, memory, old_size, new_size);
+}
+
+
+static void bump_allocator_interface_free(void *context, void *memory, uint64 size)
+{
+    BumpAllocator *allocator = context;
+    if (memory != NULL && bump_allocator_is_newest(allocator, memory, size))
+    {
+        ALLOCATOR_STATS_PEAK(&allocator->counters, allocator->end_index);
+        allocator->end_index -= size;
     }
 }
 
 
-void array_destroy(Array *array, AllocatorInterface *allocator)
+void bump_allocator_interface(AllocatorInterface *interface, BumpAllocator *allocator)
+{
+    if (interface == NULL)
+        return;
+
+    interface->memory_allocate = NULL;
+    interface->memory_resize = NULL;
+    interface->memory_free = NULL;
+    interface->context = allocator;
+    interface->context_memory_allocate = bump_allocator_interface_allocate;
+    interface->context_memory_resize = bump_allocator_interface_resize;
+    interface->context_memory_free = bump_allocator_interface_free;
+}
+
+
+#ifdef C_UTILS_ALLOCATOR_STATS
+
+void bump_allocator_stats(BumpAllocator *allocator, AllocatorStats *stats)
+{
+    if (allocator == NULL || stats == NULL)
+        return;
+
+    stats->bytes_requested = allocator->counters.bytes_requested;
+    stats->bytes_used = allocator->end_index;
+    stats->bytes_reserved = allocator->buffer_size;
+    stats->peak_bytes_used = max(allocator->counters.peak_bytes_used, allocator->end_index);
+    stats->fragmented_bytes = 0;
+    stats->allocations = allocator->counters.allocations;
+    stats->failed_allocations = allocator->counters.failed_allocations;
+    stats->num_arenas = 1;
+}
+
+#endif
+
+
+void arena_allocator_init_with_flags(ArenaAllocator *allocator, void* (*get_memory)(uint64), uint64 arena_size, uint32 max_arenas, uint32 flags)
+{
+    if (allocator == NULL || get_memory == NULL)
+        return;
+
+    if (arena_size == 0 || max_arenas == 0)
+        return;
+
+    allocator->get_memory = get_memory;
+    allocator->arena_size = arena_size;
+    allocator->max_arenas = max_arenas;
+    allocator->num_arenas = 0;
+    allocator->current_arena = 0;
+    allocator->flags = flags;
+    allocator->lock = 0;
+    allocator->used_arenas = 1;
+    allocator->resident_arenas = 1;
+    allocator->generation = 0;
+    allocator->chunks = NULL;
+    allocator->free_chunks = NULL;
+    allocator->released_chunks = NULL;
+    ALLOCATOR_STATS_INIT(&allocator->counters);
+
+    memory_set((uint8*)allocator->free_index, 0x00, sizeof(allocator->free_index));
+    memory_set((uint8*)allocator->arenas, 0x00, (uint64)max_arenas * PLATFORM_POINTER_LENGTH);
+
+    BumpAllocator *arena = get_memory(bump_allocator_size(arena_size));
+    if (arena == NULL)
+        return;
+
+    allocator->arenas[0] = arena;
+    allocator->num_arenas = 1;
+    bump_allocator_init(arena, arena_size);
+}
+
+
+inline void arena_allocator_init(ArenaAllocator *allocator, void* (*get_memory)(uint64), uint64 arena_size, uint32 max_arenas)
+{
+    arena_allocator_init_with_flags(allocator, get_memory, arena_size, max_arenas, 0);
+}
+
+
+inline void arena_allocator_init_growing(ArenaAllocator *allocator, void* (*get_memory)(uint64), uint64 arena_size, uint32 max_arenas)
+{
+    arena_allocator_init_with_flags(allocator, get_memory, arena_size, max_arenas, ARENA_ALLOCATOR_FLAG_GROWING);
+}
+
+
+static inline int arena_allocator_is_growing(ArenaAllocator *allocator)
+{
+    return (allocator->flags & ARENA_ALLOCATOR_FLAG_GROWING) != 0;
+}
+
+
+// Size of the buffer of the arena created after the existing ones.
+static inline uint64 arena_allocator_next_arena_size(ArenaAllocator *allocator)
+{
+    if (!arena_allocator_is_growing(allocator))
+        return allocator->arena_size;
+
+    uint32 shift = min(allocator->num_arenas, ARENA_ALLOCATOR_MAX_GROWTH_SHIFT);
+    return allocator->arena_size << shift;
+}
+
+
+// Count the change in the fill of an arena whose end index was end_index
+// into the bytes_used of the ArenaAllocator.
+static inline void arena_allocator_track_used(ArenaAllocator *allocator, BumpAllocator *arena, uint64 end_index)
+{
+#ifdef C_UTILS_ALLOCATOR_STATS
+    if (arena->end_index >= end_index)
+        ALLOCATOR_STATS_USED(&allocator->counters, arena->end_index - end_index);
+    else
+        ALLOCATOR_STATS_UNUSED(&allocator->counters, end_index - arena->end_index);
+#else
+    (void)allocator;
+    (void)arena;
+    (void)end_index;
+#endif
+}
+
+
+static inline void* arena_bump_allocate(ArenaAllocator *allocator, BumpAllocator *arena, uint64 size, uint64 alignment)
+{
+    if (arena == NULL)
+        return NULL;
+
+    void *memory;
+    uint64 end_index = arena->end_index;
+    if (alignment == 1)
+        memory = bump_allocator_memory_allocate(arena, size);
+    else
+        memory = bump_allocator_memory_allocate_aligned(arena, size, alignment);
+
+    if (memory != NULL)
+        arena_allocator_track_used(allocator, arena, end_index);
+    return memory;
+}
+
+
+static inline uint64 bump_allocator_free_space(BumpAllocator *allocator)
+{
+    return allocator->buffer_size - allocator->end_index;
+}
+
+
+// Record the space left in the given arena if it is larger
+// than the smallest entry in the free index.
+static void arena_allocator_index_free_space(ArenaAllocator *allocator, uint32 arena_index)
+{
+    uint64 free_space = bump_allocator_free_space(allocator->arenas[arena_index]);
+    ArenaFreeSpace *smallest = &allocator->free_index[0];
+
+    for (uint32 i = 0; i < ARENA_ALLOCATOR_FREE_INDEX_SIZE; i++)
+    {
+        // Arenas are indexed again after a reset or a rewind.
+        if (allocator->free_index[i].free_space > 0 && allocator->free_index[i].arena_index == arena_index)
+        {
+            allocator->free_index[i].free_space = free_space;
+            return;
+        }
+        if (allocator->free_index[i].free_space < smallest->free_space)
+            smallest = &allocator->free_index[i];
+    }
+
+    if (free_space > smallest->free_space)
+    {
+        smallest->free_space = free_space;
+        smallest->arena_index = arena_index;
+    }
+}
+
+
+// Memory taken by an ArenaCache for a refill of its parent. The parent lock
+// is not held while calling get_memory, so an allocation that needs more memory
+// fails with the size in needed, and is retried with a block of that size.
+typedef struct ArenaReserve
+{
+    void *memory;
+    uint64 size;
+    uint64 needed;
+} ArenaReserve;
+
+
+// Take a block of at least *size bytes from get_memory, or from the reserve
+// if one is given. *size is updated to the size of the block.
+static void* arena_allocator_get_memory(ArenaAllocator *allocator, uint64 *size, ArenaReserve *reserve)
+{
+    if (reserve == NULL)
+        return allocator->get_memory(*size);
+
+    if (reserve->memory == NULL || reserve->size < *size)
+    {
+        reserve->needed = *size;
+        return NULL;
+    }
+
+    void *memory = reserve->memory;
+    *size = reserve->size;
+    reserve->memory = NULL;
+    return memory;
+}
+
+
+static inline uint64 arena_chunk_padding(ArenaChunk *chunk, uint64 alignment)
+{
+    uint64 address = (uint64)chunk->memory;
+    return (alignment - (address & (alignment - 1))) & (alignment - 1);
+}
+
+
+// Give the request its own chunk, reusing the smallest chunk recycled by a reset
+// that fits it. Recycled chunks more than twice the request are left for larger
+// requests, so a small request does not keep a large chunk in use.
+static void* arena_allocator_allocate_chunk(ArenaAllocator *allocator, uint64 size, uint64 alignment, ArenaReserve *reserve)
+{
+    ArenaChunk *chunk;
+    ArenaChunk **best = NULL;
+    ArenaChunk **lists[2] = { &allocator->free_chunks, &allocator->released_chunks };
+    for (uint32 i = 0; i < 2; i++)
+    {
+        for (ArenaChunk **link = lists[i]; *link != NULL; link = &(*link)->next)
+        {
+            chunk = *link;
+            uint64 required_size = size + arena_chunk_padding(chunk, alignment);
+            if (chunk->size < required_size || chunk->size / 2 > required_size)
+                continue;
+
+            if (best == NULL || chunk->size < (*best)->size)
+                best = link;
+        }
+    }
+
+    if (best != NULL)
+    {
+        chunk = *best;
+        *best = chunk->next;
+    }
+    else
+    {
+        // The alignment of the memory from get_memory is not known,
+        // so a new chunk has room for the worst case padding.
+        uint64 block_size = ARENA_CHUNK_MEMORY_OFFSET + size + alignment - 1;
+        chunk = arena_allocator_get_memory(allocator, &block_size, reserve);
+        if (chunk == NULL)
+            return NULL;
+        chunk->size = block_size - ARENA_CHUNK_MEMORY_OFFSET;
+    }
+
+    chunk->next = allocator->chunks;
+    allocator->chunks = chunk;
+    ALLOCATOR_STATS_USED(&allocator->counters, chunk->size);
+    return chunk->memory + arena_chunk_padding(chunk, alignment);
+}
+
+
+// Return 1 if the arena after the current one holds allocations.
+static inline int arena_allocator_has_spill(ArenaAllocator *allocator)
+{
+    return allocator->used_arenas == allocator->current_arena + 2;
+}
+
+
+static void* arena_allocator_memory_allocate_slow(ArenaAllocator *allocator, uint64 size, uint64 alignment, ArenaReserve *reserve)
+{
+    void *memory;
+    BumpAllocator *arena;
+    ArenaFreeSpace *entry;
+
+    const int growing = arena_allocator_is_growing(allocator);
+    if (growing && size > arena_allocator_next_arena_size(allocator) / 2)
+        return arena_allocator_allocate_chunk(allocator, size, alignment, reserve);
+
+    // The arena taken into use last stays open after the current one, so the
+    // space left at the end of the current arena is still used by smaller requests.
+    const int has_spill = arena_allocator_has_spill(allocator);
+    if (has_spill)
+    {
+        memory = arena_bump_allocate(allocator, allocator->arenas[allocator->current_arena + 1], size, alignment);
+        if (memory != NULL)
+            return memory;
+    }
+
+    for (uint32 i = 0; i < ARENA_ALLOCATOR_FREE_INDEX_SIZE; i++)
+    {
+        entry = &allocator->free_index[i];
+        if (entry->free_space == 0 || entry->free_space < size)
+            continue;
+
+        // The alignment padding may still make the request fail,
+        // the entry is refreshed from the arena in either case.
+        arena = allocator->arenas[entry->arena_index];
+        memory = arena_bump_allocate(allocator, arena, size, alignment);
+        entry->free_space = bump_allocator_free_space(arena);
+        if (memory != NULL)
+            return memory;
+    }
+
+    if (has_spill)
+    {
+        // Both open arenas missed, the spill arena becomes current.
+        arena_allocator_index_free_space(allocator, allocator->current_arena);
+        allocator->current_arena++;
+    }
+
+    arena = NULL;
+    if (allocator->used_arenas < allocator->num_arenas)
+    {
+        // Arenas after the used ones are empty after a reset.
+        arena = allocator->arenas[allocator->used_arenas];
+    }
+    else if (allocator->num_arenas < allocator->max_arenas)
+    {
+        uint64 block_size = bump_allocator_size(arena_allocator_next_arena_size(allocator));
+        arena = arena_allocator_get_memory(allocator, &block_size, reserve);
+        if (arena == NULL)
+            return NULL;
+
+        bump_allocator_init(arena, block_size - BUMP_ALLOCATOR_BUFFER_OFFSET);
+        allocator->arenas[allocator->num_arenas] = arena;
+        allocator->num_arenas++;
+    }
+
+    if (arena != NULL)
+    {
+        // The new arena opens as the spill arena.
+        allocator->used_arenas++;
+        memory = arena_bump_allocate(allocator, arena, size, alignment);
+        if (memory != NULL)
+            return memory;
+    }
+
+    if (growing)
+        return arena_allocator_allocate_chunk(allocator, size, alignment, reserve);
+
+    // A fixed allocator only fails once no arena has room, the free index
+    // may have missed some. The scan only runs when the request would fail.
+    for (uint32 i = 0; i < allocator->num_arenas; i++)
+    {
+        memory = arena_bump_allocate(allocator, allocator->arenas[i], size, alignment);
+        if (memory != NULL)
+            return memory;
+    }
+    return NULL;
+}
+
+
+static void* arena_allocator_allocate_reserved(ArenaAllocator *allocator, uint64 size, uint64 alignment, ArenaReserve *reserve)
+{
+    if (size > allocator->arena_size && !arena_allocator_is_growing(allocator))
+    {
+        ALLOCATOR_STATS_FAILED(&allocator->counters);
+        return NULL;
+    }
+
+    void *memory = arena_bump_allocate(allocator, allocator->arenas[allocator->current_arena], size, alignment);
+    if (memory == NULL)
+        memory = arena_allocator_memory_allocate_slow(allocator, size, alignment, reserve);
+
+    if (memory != NULL)
+        ALLOCATOR_STATS_ALLOCATED(&allocator->counters, size);
+    else if (reserve == NULL || reserve->needed == 0)
+        ALLOCATOR_STATS_FAILED(&allocator->counters);
+    return memory;
+}
+
+
+void* arena_allocator_memory_allocate_aligned(ArenaAllocator *allocator, uint64 size, uint64 alignment)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (!alignment_is_valid(alignment))
+        return NULL;
+
+    return arena_allocator_allocate_reserved(allocator, size, alignment, NULL);
+}
+
+
+void* arena_allocator_memory_resize(ArenaAllocator *allocator, void *memory, uint64 old_size, uint64 new_size)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (memory == NULL)
+        return arena_allocator_memory_allocate_aligned(allocator, new_size, ALLOCATOR_DEFAULT_ALIGNMENT);
+
+    BumpAllocator *current = allocator->arenas[allocator->current_arena];
+    uint64 end_index = current != NULL ? current->end_index : 0;
+    if (current != NULL && bump_allocator_resize_in_place(current, memory, old_size, new_size))
+    {
+        arena_allocator_track_used(allocator, current, end_index);
+        return memory;
+    }
+
+    // The newest allocation of the spill arena grows in place there as well.
+    if (arena_allocator_has_spill(allocator))
+    {
+        BumpAllocator *spill = allocator->arenas[allocator->current_arena + 1];
+        end_index = spill->end_index;
+        if (bump_allocator_resize_in_place(spill, memory, old_size, new_size))
+        {
+            arena_allocator_track_used(allocator, spill, end_index);
+            return memory;
+        }
+    }
+
+    // Growing the newest oversized allocation within its chunk.
+    ArenaChunk *chunk = allocator->chunks;
+    if (chunk != NULL && (uint8*)memory >= chunk->memory && (uint8*)memory < chunk->memory + chunk->size)
+    {
+        if (new_size <= (uint64)(chunk->memory + chunk->size - (uint8*)memory))
+            return memory;
+    }
+
+    if (new_size <= old_size)
+        return memory;
+
+    void *new_memory = arena_allocator_memory_allocate_aligned(allocator, new_size, ALLOCATOR_DEFAULT_ALIGNMENT);
+    if (new_memory != NULL)
+        memory_copy(memory, new_memory, old_size);
+    return new_memory;
+}
+
+
+inline void* arena_allocator_memory_allocate(ArenaAllocator *allocator, uint64 size)
+{
+    return arena_allocator_memory_allocate_aligned(allocator, size, 1);
+}
+
+
+inline void arena_allocator_reset(ArenaAllocator *allocator)
+{
+    if (allocator == NULL)
+        return;
+
+    // Memory left unused by the batch since the last reset is returned to
+    // the kernel. Memory it used is likely needed again by the next batch,
+    // releasing it would only fault the same pages back in.
+    const int release = (allocator->flags & ARENA_ALLOCATOR_FLAG_RELEASE) != 0;
+
+    BumpAllocator *bump_allocator;
+    for (uint32 i = 0; i < allocator->num_arenas; i++)
+    {
+        bump_allocator = allocator->arenas[i];
+        if (release && i >= allocator->used_arenas && i < allocator->resident_arenas)
+            platform_memory_release(bump_allocator->buffer, bump_allocator->buffer_size);
+        bump_allocator_reset(bump_allocator);
+    }
+
+    allocator->resident_arenas = allocator->used_arenas;
+    allocator->used_arenas = 1;
+    allocator->current_arena = 0;
+    memory_set((uint8*)allocator->free_index, 0x00, sizeof(allocator->free_index));
+    ALLOCATOR_STATS_RESET(&allocator->counters);
+    __atomic_store_n(&allocator->generation, allocator->generation + 1, __ATOMIC_RELAXED);
+
+    ArenaChunk *chunk;
+    while (release && allocator->free_chunks != NULL)
+    {
+        chunk = allocator->free_chunks;
+        allocator->free_chunks = chunk->next;
+        platform_memory_release(chunk->memory, chunk->size);
+        chunk->next = allocator->released_chunks;
+        allocator->released_chunks = chunk;
+    }
+
+    while (allocator->chunks != NULL)
+    {
+        chunk = allocator->chunks;
+        allocator->chunks = chunk->next;
+        chunk->next = allocator->free_chunks;
+        allocator->free_chunks = chunk;
+    }
+}
+
+
+void arena_allocator_mark(ArenaAllocator *allocator, ArenaAllocatorMark *mark)
+{
+    if (allocator == NULL || mark == NULL)
+        return;
+
+    BumpAllocator *current = allocator->arenas[allocator->current_arena];
+    mark->chunks = allocator->chunks;
+    mark->end_index = current != NULL ? current->end_index : 0;
+    mark->current_arena = allocator->current_arena;
+    mark->used_arenas = allocator->used_arenas;
+    mark->spill_end_index = arena_allocator_has_spill(allocator) ? allocator->arenas[allocator->current_arena + 1]->end_index : 0;
+
+    // Arenas in the free index can still receive allocations after the mark.
+    ArenaFreeSpace *entry;
+    for (uint32 i = 0; i < ARENA_ALLOCATOR_FREE_INDEX_SIZE; i++)
+    {
+        entry = &allocator->free_index[i];
+        mark->free_index[i] = *entry;
+        mark->free_index_end[i] = entry->free_space > 0 ? allocator->arenas[entry->arena_index]->end_index : 0;
+    }
+}
+
+
+void arena_allocator_rewind(ArenaAllocator *allocator, ArenaAllocatorMark *mark)
+{
+    if (allocator == NULL || mark == NULL)
+        return;
+
+    if (mark->current_arena > allocator->current_arena || mark->used_arenas > allocator->used_arenas || allocator->num_arenas == 0)
+        return;
+
+    BumpAllocator *arena;
+    uint64 end_index;
+    for (uint32 i = mark->used_arenas; i < allocator->used_arenas; i++)
+    {
+        arena = allocator->arenas[i];
+        end_index = arena->end_index;
+        bump_allocator_reset(arena);
+        arena_allocator_track_used(allocator, arena, end_index);
+    }
+
+    if (mark->used_arenas == mark->current_arena + 2)
+    {
+        arena = allocator->arenas[mark->current_arena + 1];
+        end_index = arena->end_index;
+        bump_allocator_rewind(arena, mark->spill_end_index);
+        arena_allocator_track_used(allocator, arena, end_index);
+    }
+
+    arena = allocator->arenas[mark->current_arena];
+    end_index = arena->end_index;
+    bump_allocator_rewind(arena, mark->end_index);
+    arena_allocator_track_used(allocator, arena, end_index);
+    allocator->current_arena = mark->current_arena;
+
+    // Arenas emptied by the rewind count as resident, for releasing them on reset.
+    allocator->resident_arenas = max(allocator->resident_arenas, allocator->used_arenas);
+    allocator->used_arenas = mark->used_arenas;
+
+    for (uint32 i = 0; i < ARENA_ALLOCATOR_FREE_INDEX_SIZE; i++)
+    {
+        allocator->free_index[i] = mark->free_index[i];
+        if (mark->free_index[i].free_space == 0)
+            continue;
+
+        arena = allocator->arenas[mark->free_index[i].arena_index];
+        end_index = arena->end_index;
+        bump_allocator_rewind(arena, mark->free_index_end[i]);
+        arena_allocator_track_used(allocator, arena, end_index);
+        allocator->free_index[i].free_space = bump_allocator_free_space(arena);
+    }
+
+    ArenaChunk *chunk;
+    while (allocator->chunks != mark->chunks && allocator->chunks != NULL)
+    {
+        chunk = allocator->chunks;
+        allocator->chunks = chunk->next;
+        ALLOCATOR_STATS_UNUSED(&allocator->counters, chunk->size);
+        chunk->next = allocator->free_chunks;
+        allocator->free_chunks = chunk;
+    }
+}
+
+
+static void arena_chunks_free(ArenaChunk *chunk, void (*free_memory)(void*, uint64))
+{
+    ArenaChunk *next;
+    while (chunk != NULL)
+    {
+        next = chunk->next;
+        free_memory(chunk, ARENA_CHUNK_MEMORY_OFFSET + chunk->size);
+        chunk = next;
+    }
+}
+
+
+void arena_allocator_destroy(ArenaAllocator *allocator, void (*free_memory)(void*, uint64))
+{
+    if (allocator == NULL || free_memory == NULL)
+        return;
+
+    BumpAllocator *arena;
+    for (uint32 i = 0; i < allocator->num_arenas; i++)
+    {
+        arena = allocator->arenas[i];
+        free_memory(arena, bump_allocator_size(arena->buffer_size));
+    }
+
+    arena_chunks_free(allocator->chunks, free_memory);
+    arena_chunks_free(allocator->free_chunks, free_memory);
+    arena_chunks_free(allocator->released_chunks, free_memory);
+    free_memory(allocator, arena_allocator_size(allocator->max_arenas));
+}
+
+
+static void* arena_allocator_interface_allocate(void *context, uint64 size)
+{
+    return arena_allocator_memory_allocate_aligned(context, size, ALLOCATOR_DEFAULT_ALIGNMENT);
+}
+
+
+static void* arena_allocator_interface_resize(void *context, void *memory, uint64 old_size, uint64 new_size)
+{
+    return arena_allocator_memory_resize(context, memory, old_size, new_size);
+}
+
+
+static void arena_allocator_interface_free(void *context, void *memory, uint64 size)
+{
+    ArenaAllocator *allocator = context;
+    BumpAllocator *current = allocator->arenas[allocator->current_arena];
+    if (memory == NULL || current == NULL)
+        return;
+
+    if (!bump_allocator_is_newest(current, memory, size) && arena_allocator_has_spill(allocator))
+        current = allocator->arenas[allocator->current_arena + 1];
+
+    if (bump_allocator_is_newest(current, memory, size))
+    {
+        current->end_index -= size;
+        ALLOCATOR_STATS_UNUSED(&allocator->counters, size);
+    }
+}
+
+
+void arena_allocator_interface(AllocatorInterface *interface, ArenaAllocator *allocator)
+{
+    if (interface == NULL)
+        return;
+
+    interface->memory_allocate = NULL;
+    interface->memory_resize = NULL;
+    interface->memory_free = NULL;
+    interface->context = allocator;
+    interface->context_memory_allocate = arena_allocator_interface_allocate;
+    interface->context_memory_resize = arena_allocator_interface_resize;
+    interface->context_memory_free = arena_allocator_interface_free;
+}
+
+
+#ifdef C_UTILS_ALLOCATOR_STATS
+
+void arena_allocator_stats(ArenaAllocator *allocator, AllocatorStats *stats)
+{
+    if (allocator == NULL || stats == NULL)
+        return;
+
+    uint64 bytes_reserved = 0;
+    uint64 free_space = 0;
+    uint64 largest_free_space = 0;
+    BumpAllocator *arena;
+    for (uint32 i = 0; i < allocator->num_arenas; i++)
+    {
+        arena = allocator->arenas[i];
+        bytes_reserved += arena->buffer_size;
+        free_space += bump_allocator_free_space(arena);
+        largest_free_space = max(largest_free_space, bump_allocator_free_space(arena));
+    }
+
+    for (ArenaChunk *chunk = allocator->chunks; chunk != NULL; chunk = chunk->next)
+        bytes_reserved += chunk->size;
+    for (ArenaChunk *chunk = allocator->free_chunks; chunk != NULL; chunk = chunk->next)
+        bytes_reserved += chunk->size;
+    for (ArenaChunk *chunk = allocator->released_chunks; chunk != NULL; chunk = chunk->next)
+        bytes_reserved += chunk->size;
+
+    stats->bytes_requested = allocator->counters.bytes_requested;
+    stats->bytes_used = allocator->counters.bytes_used;
+    stats->bytes_reserved = bytes_reserved;
+    stats->peak_bytes_used = max(allocator->counters.peak_bytes_used, stats->bytes_used);
+    stats->fragmented_bytes = free_space - largest_free_space;
+    stats->allocations = allocator->counters.allocations;
+    stats->failed_allocations = allocator->counters.failed_allocations;
+    stats->num_arenas = allocator->num_arenas;
+}
+
+#endif
+
+
+static inline void spin_lock(uint32 *lock)
+{
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0)
+    {
+        while (__atomic_load_n(lock, __ATOMIC_RELAXED) != 0)
+        {
+#ifdef C_UTILS_X64_KERNELS
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+}
+
+
+static inline void spin_unlock(uint32 *lock)
+{
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+
+void arena_cache_init(ArenaCache *cache, ArenaAllocator *parent, uint64 refill_size)
+{
+    if (cache == NULL || parent == NULL)
+        return;
+
+    cache->parent = parent;
+    cache->refill_size = (refill_size + PLATFORM_CACHE_LINE_SIZE - 1) & ~(uint64)(PLATFORM_CACHE_LINE_SIZE - 1);
+    cache->next = NULL;
+    cache->end = NULL;
+    cache->generation = __atomic_load_n(&parent->generation, __ATOMIC_RELAXED);
+}
+
+
+// Allocate from the parent while holding its lock. Memory the parent needs
+// is taken from get_memory after releasing the lock, so a slow get_memory
+// does not stall the refills of other threads.
+static void* arena_cache_allocate_from_parent(ArenaAllocator *parent, uint64 size, uint64 alignment)
+{
+    void *memory;
+    ArenaReserve reserve = { NULL, 0, 0 };
+
+    while (1)
+    {
+        spin_lock(&parent->lock);
+        reserve.needed = 0;
+        memory = arena_allocator_allocate_reserved(parent, size, alignment, &reserve);
+
+        // Another thread grew the parent in the meantime. The unused block
+        // is kept as a free chunk, and freed by arena_allocator_destroy.
+        if (reserve.memory != NULL)
+        {
+            ArenaChunk *chunk = reserve.memory;
+            chunk->size = reserve.size - ARENA_CHUNK_MEMORY_OFFSET;
+            chunk->next = parent->free_chunks;
+            parent->free_chunks = chunk;
+            reserve.memory = NULL;
+        }
+        spin_unlock(&parent->lock);
+
+        if (memory != NULL || reserve.needed == 0)
+            return memory;
+
+        reserve.size = reserve.needed;
+        reserve.memory = parent->get_memory(reserve.size);
+        if (reserve.memory == NULL)
+        {
+            spin_lock(&parent->lock);
+            ALLOCATOR_STATS_FAILED(&parent->counters);
+            spin_unlock(&parent->lock);
+            return NULL;
+        }
+    }
+}
+
+
+static void* arena_cache_memory_allocate_slow(ArenaCache *cache, uint64 size, uint64 alignment)
+{
+    if (size > cache->refill_size / 2 || alignment > PLATFORM_CACHE_LINE_SIZE)
+        return arena_cache_allocate_from_parent(cache->parent, size, alignment);
+
+    uint8 *slice = arena_cache_allocate_from_parent(cache->parent, cache->refill_size, PLATFORM_CACHE_LINE_SIZE);
+    if (slice == NULL)
+        return NULL;
+
+    // Slices are cache line aligned, so padding for any alignment
+    // up to a cache line leaves room for the request.
+    uint64 address = (uint64)slice;
+    uint64 padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+    if (padding + size > cache->refill_size)
+        return NULL;
+
+    cache->next = slice + padding + size;
+    cache->end = slice + cache->refill_size;
+    return slice + padding;
+}
+
+
+void* arena_cache_memory_allocate_aligned(ArenaCache *cache, uint64 size, uint64 alignment)
+{
+    if (cache == NULL)
+        return NULL;
+
+    if (!alignment_is_valid(alignment))
+        return NULL;
+
+    uint32 generation = __atomic_load_n(&cache->parent->generation, __ATOMIC_RELAXED);
+    if (generation != cache->generation)
+    {
+        cache->generation = generation;
+        cache->next = NULL;
+        cache->end = NULL;
+    }
+
+    uint64 address = (uint64)cache->next;
+    uint64 padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+    if (cache->next != NULL && padding <= (uint64)(cache->end - cache->next) && size <= (uint64)(cache->end - cache->next) - padding)
+    {
+        uint8 *memory = cache->next + padding;
+        cache->next = memory + size;
+        return memory;
+    }
+
+    return arena_cache_memory_allocate_slow(cache, size, alignment);
+}
+
+
+inline void* arena_cache_memory_allocate(ArenaCache *cache, uint64 size)
+{
+    return arena_cache_memory_allocate_aligned(cache, size, 1);
+}
+
+
+static void* arena_cache_interface_allocate(void *context, uint64 size)
+{
+    return arena_cache_memory_allocate_aligned(context, size, ALLOCATOR_DEFAULT_ALIGNMENT);
+}
+
+
+static void* arena_cache_interface_resize(void *context, void *memory, uint64 old_size, uint64 new_size)
+{
+    ArenaCache *cache = context;
+    if (memory == NULL)
+        return arena_cache_interface_allocate(context, new_size);
+
+    // The newest allocation of the slice can grow or shrink in place.
+    if ((uint8*)memory + old_size == cache->next && new_size <= (uint64)(cache->end - (uint8*)memory))
+    {
+        cache->next = (uint8*)memory + new_size;
+        return memory;
+    }
+
+    if (new_size <= old_size)
+        return memory;
+
+    void *new_memory = arena_cache_interface_allocate(context, new_size);
+    if (new_memory != NULL)
+        memory_copy(memory, new_memory, old_size);
+    return new_memory;
+}
+
+
+static void arena_cache_interface_free(void *context, void *memory, uint64 size)
+{
+    ArenaCache *cache = context;
+    if (memory != NULL && (uint8*)memory + size == cache->next)
+        cache->next = memory;
+}
+
+
+void arena_cache_interface(AllocatorInterface *interface, ArenaCache *cache)
+{
+    if (interface == NULL)
+        return;
+
+    interface->memory_allocate = NULL;
+    interface->memory_resize = NULL;
+    interface->memory_free = NULL;
+    interface->context = cache;
+    interface->context_memory_allocate = arena_cache_interface_allocate;
+    interface->context_memory_resize = arena_cache_interface_resize;
+    interface->context_memory_free = arena_cache_interface_free;
+}
+
+
+void pool_allocator_init_with_fallback(PoolAllocator *allocator, void* (*get_memory)(uint64), uint64 block_size, uint64 blocks_per_chunk, AllocatorInterface *fallback)
+{
+    if (allocator == NULL || get_memory == NULL)
+        return;
+
+    if (block_size == 0 || blocks_per_chunk == 0)
+        return;
+
+    const uint64 alignment = block_size > PLATFORM_POINTER_LENGTH ? ALLOCATOR_DEFAULT_ALIGNMENT : PLATFORM_POINTER_LENGTH;
+    allocator->get_memory = get_memory;
+    allocator->fallback = fallback;
+    allocator->block_size = (block_size + alignment - 1) & ~(alignment - 1);
+    allocator->blocks_per_chunk = blocks_per_chunk;
+    allocator->free_list = NULL;
+    allocator->next_block = NULL;
+    allocator->chunk_end = NULL;
+    allocator->chunks = NULL;
+    allocator->free_chunks = NULL;
+    ALLOCATOR_STATS_INIT(&allocator->counters);
+}
+
+
+inline void pool_allocator_init(PoolAllocator *allocator, void* (*get_memory)(uint64), uint64 block_size, uint64 blocks_per_chunk)
+{
+    pool_allocator_init_with_fallback(allocator, get_memory, block_size, blocks_per_chunk, NULL);
+}
+
+
+static void* pool_allocator_memory_allocate_slow(PoolAllocator *allocator)
+{
+    PoolChunk *chunk = allocator->free_chunks;
+    if (chunk != NULL)
+    {
+        allocator->free_chunks = chunk->next;
+    }
+    else
+    {
+        chunk = allocator->get_memory(POOL_CHUNK_MEMORY_OFFSET + allocator->block_size * allocator->blocks_per_chunk);
+        if (chunk == NULL)
+            return NULL;
+        ALLOCATOR_STATS_RESERVED(&allocator->counters, allocator->block_size * allocator->blocks_per_chunk);
+    }
+
+    chunk->next = allocator->chunks;
+    allocator->chunks = chunk;
+    allocator->next_block = chunk->memory + allocator->block_size;
+    allocator->chunk_end = chunk->memory + allocator->block_size * allocator->blocks_per_chunk;
+    return chunk->memory;
+}
+
+
+void* pool_allocator_memory_allocate(PoolAllocator *allocator)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    void *block = allocator->free_list;
+    if (block != NULL)
+    {
+        allocator->free_list = *(void**)block;
+    }
+    else if (allocator->next_block < allocator->chunk_end)
+    {
+        block = allocator->next_block;
+        allocator->next_block += allocator->block_size;
+    }
+    else
+    {
+        block = pool_allocator_memory_allocate_slow(allocator);
+        if (block == NULL)
+        {
+            ALLOCATOR_STATS_FAILED(&allocator->counters);
+            return NULL;
+        }
+    }
+
+    ALLOCATOR_STATS_ALLOCATED(&allocator->counters, allocator->block_size);
+    ALLOCATOR_STATS_USED(&allocator->counters, allocator->block_size);
+    return block;
+}
+
+
+void pool_allocator_memory_free(PoolAllocator *allocator, void *block)
+{
+    if (allocator == NULL || block == NULL)
+        return;
+
+    *(void**)block = allocator->free_list;
+    allocator->free_list = block;
+    ALLOCATOR_STATS_UNUSED(&allocator->counters, allocator->block_size);
+}
+
+
+void pool_allocator_reset(PoolAllocator *allocator)
+{
+    if (allocator == NULL)
+        return;
+
+    PoolChunk *chunk;
+    while (allocator->chunks != NULL)
+    {
+        chunk = allocator->chunks;
+        allocator->chunks = chunk->next;
+        chunk->next = allocator->free_chunks;
+        allocator->free_chunks = chunk;
+    }
+
+    allocator->free_list = NULL;
+    allocator->next_block = NULL;
+    allocator->chunk_end = NULL;
+    ALLOCATOR_STATS_RESET(&allocator->counters);
+}
+
+
+static void pool_chunks_free(PoolAllocator *allocator, PoolChunk *chunk, void (*free_memory)(void*, uint64))
+{
+    PoolChunk *next;
+    const uint64 chunk_size = POOL_CHUNK_MEMORY_OFFSET + allocator->block_size * allocator->blocks_per_chunk;
+    while (chunk != NULL)
+    {
+        next = chunk->next;
+        free_memory(chunk, chunk_size);
+        chunk = next;
+    }
+}
+
+
+void pool_allocator_destroy(PoolAllocator *allocator, void (*free_memory)(void*, uint64))
+{
+    if (allocator == NULL || free_memory == NULL)
+        return;
+
+    pool_chunks_free(allocator, allocator->chunks, free_memory);
+    pool_chunks_free(allocator, allocator->free_chunks, free_memory);
+    free_memory(allocator, sizeof(PoolAllocator));
+}
+
+
+static void* pool_allocator_interface_allocate(void *context, uint64 size)
+{
+    PoolAllocator *allocator = context;
+    if (size <= allocator->block_size)
+        return pool_allocator_memory_allocate(allocator);
+
+    if (allocator->fallback == NULL)
+        return NULL;
+    return allocator_memory_allocate(allocator->fallback, size);
+}
+
+
+static void* pool_allocator_interface_resize(void *context, void *memory, uint64 old_size, uint64 new_size)
+{
+    PoolAllocator *allocator = context;
+    const int old_is_block = old_size <= allocator->block_size;
+    const int new_is_block = new_size <= allocator->block_size;
+
+    if (old_is_block && new_is_block)
+        return memory;
+
+    if (!old_is_block && !new_is_block)
+        return allocator_memory_resize(allocator->fallback, memory, old_size, new_size);
+
+    // The memory moves between the pool and the fallback allocator.
+    void *new_memory = pool_allocator_interface_allocate(context, new_size);
+    if (new_memory == NULL)
+        return NULL;
+
+    memory_copy(memory, new_memory, min(old_size, new_size));
+    if (old_is_block)
+        pool_allocator_memory_free(allocator, memory);
+    else
+        allocator_memory_free(allocator->fallback, memory, old_size);
+    return new_memory;
+}
+
+
+static void pool_allocator_interface_free(void *context, void *memory, uint64 size)
+{
+    PoolAllocator *allocator = context;
+    if (size <= allocator->block_size)
+        pool_allocator_memory_free(allocator, memory);
+    else if (allocator->fallback != NULL)
+        allocator_memory_free(allocator->fallback, memory, size);
+}
+
+
+void pool_allocator_interface(AllocatorInterface *interface, PoolAllocator *allocator)
+{
+    if (interface == NULL || allocator == NULL)
+        return;
+
+    interface->memory_allocate = NULL;
+    interface->memory_resize = NULL;
+    interface->memory_free = NULL;
+    interface->context = allocator;
+    interface->context_memory_allocate = pool_allocator_interface_allocate;
+    interface->context_memory_resize = pool_allocator_interface_resize;
+    interface->context_memory_free = pool_allocator_interface_free;
+}
+
+
+#ifdef C_UTILS_ALLOCATOR_STATS
+
+void pool_allocator_stats(PoolAllocator *allocator, AllocatorStats *stats)
+{
+    if (allocator == NULL || stats == NULL)
+        return;
+
+    stats->bytes_requested = allocator->counters.bytes_requested;
+    stats->bytes_used = allocator->counters.bytes_used;
+    stats->bytes_reserved = allocator->counters.bytes_reserved;
+    stats->peak_bytes_used = allocator->counters.peak_bytes_used;
+    // Every free block fits every request.
+    stats->fragmented_bytes = 0;
+    stats->allocations = allocator->counters.allocations;
+    stats->failed_allocations = allocator->counters.failed_allocations;
+    stats->num_arenas = 0;
+}
+
+#endif
+
+
+#define TLSF_BLOCK_FREE 0x01
+#define TLSF_BLOCK_PREV_FREE 0x02
+#define TLSF_BLOCK_FLAGS 0x0F
+#define TLSF_BLOCK_MIN_SIZE 16
+#define TLSF_SMALL_BLOCK_SIZE (1 << TLSF_FL_INDEX_SHIFT)
+#define TLSF_MAX_BLOCK_SIZE ((uint64)1 << TLSF_FL_INDEX_MAX)
+
+static inline uint64 tlsf_block_size(TlsfBlock *block)
+{
+    return block->size & ~(uint64)TLSF_BLOCK_FLAGS;
+}
+
+
+static inline TlsfBlock* tlsf_block_next(TlsfBlock *block)
+{
+    return (TlsfBlock*)((uint8*)block + TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(block));
+}
+
+
+static inline TlsfBlock* tlsf_block_from_memory(void *memory)
+{
+    return (TlsfBlock*)((uint8*)memory - TLSF_BLOCK_HEADER_SIZE);
+}
+
+
+static inline uint32 tlsf_highest_bit(uint64 value)
+{
+    return 63 - __builtin_clzl(value);
+}
+
+
+static inline void tlsf_mapping_insert(uint64 size, uint32 *fl, uint32 *sl)
+{
+    if (size < TLSF_SMALL_BLOCK_SIZE)
+    {
+        *fl = 0;
+        *sl = size / (TLSF_SMALL_BLOCK_SIZE / TLSF_SL_INDEX_COUNT);
+        return;
+    }
+
+    uint32 bit = tlsf_highest_bit(size);
+    *sl = (uint32)(size >> (bit - TLSF_SL_INDEX_COUNT_LOG2)) ^ TLSF_SL_INDEX_COUNT;
+    *fl = bit - (TLSF_FL_INDEX_SHIFT - 1);
+}
+
+
+// Round the size up to the next list, so every block of that list is large enough.
+static inline void tlsf_mapping_search(uint64 size, uint32 *fl, uint32 *sl)
+{
+    if (size >= TLSF_SMALL_BLOCK_SIZE)
+        size += ((uint64)1 << (tlsf_highest_bit(size) - TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+    tlsf_mapping_insert(size, fl, sl);
+}
+
+
+static void tlsf_free_list_insert(TlsfAllocator *allocator, TlsfBlock *block)
+{
+    uint32 fl, sl;
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+
+    TlsfBlock *head = allocator->blocks[fl][sl];
+    block->next_free = head;
+    block->prev_free = NULL;
+    if (head != NULL)
+        head->prev_free = block;
+
+    allocator->blocks[fl][sl] = block;
+    allocator->fl_bitmap |= (uint64)1 << fl;
+    allocator->sl_bitmap[fl] |= 1U << sl;
+}
+
+
+static void tlsf_free_list_remove(TlsfAllocator *allocator, TlsfBlock *block)
+{
+    uint32 fl, sl;
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+
+    if (block->next_free != NULL)
+        block->next_free->prev_free = block->prev_free;
+    if (block->prev_free != NULL)
+    {
+        block->prev_free->next_free = block->next_free;
+        return;
+    }
+
+    allocator->blocks[fl][sl] = block->next_free;
+    if (block->next_free == NULL)
+    {
+        allocator->sl_bitmap[fl] &= ~(1U << sl);
+        if (allocator->sl_bitmap[fl] == 0)
+            allocator->fl_bitmap &= ~((uint64)1 << fl);
+    }
+}
+
+
+static TlsfBlock* tlsf_find_free_block(TlsfAllocator *allocator, uint64 size)
+{
+    uint32 fl, sl;
+    tlsf_mapping_search(size, &fl, &sl);
+    if (fl >= TLSF_FL_INDEX_COUNT)
+        return NULL;
+
+    uint32 sl_map = allocator->sl_bitmap[fl] & (~0U << sl);
+    if (sl_map == 0)
+    {
+        uint64 fl_map = allocator->fl_bitmap & (~(uint64)0 << (fl + 1));
+        if (fl_map == 0)
+            return NULL;
+
+        fl = __builtin_ctzl(fl_map);
+        sl_map = allocator->sl_bitmap[fl];
+    }
+
+    return allocator->blocks[fl][__builtin_ctz(sl_map)];
+}
+
+
+// Split the end of a used block that is not needed for 'size' bytes
+// into a free block, merging it with the next block if that is free.
+static void tlsf_block_trim(TlsfAllocator *allocator, TlsfBlock *block, uint64 size)
+{
+    uint64 block_size = tlsf_block_size(block);
+    if (block_size < size + TLSF_BLOCK_HEADER_SIZE + TLSF_BLOCK_MIN_SIZE)
+        return;
+
+    TlsfBlock *remainder = (TlsfBlock*)((uint8*)block + TLSF_BLOCK_HEADER_SIZE + size);
+    remainder->size = (block_size - size - TLSF_BLOCK_HEADER_SIZE) | TLSF_BLOCK_FREE;
+    block->size = size | (block->size & TLSF_BLOCK_FLAGS);
+
+    TlsfBlock *next = tlsf_block_next(remainder);
+    if (next->size & TLSF_BLOCK_FREE)
+    {
+        tlsf_free_list_remove(allocator, next);
+        remainder->size += TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(next);
+        next = tlsf_block_next(remainder);
+    }
+
+    next->prev_physical = remainder;
+    next->size |= TLSF_BLOCK_PREV_FREE;
+    tlsf_free_list_insert(allocator, remainder);
+}
+
+
+static inline uint64 tlsf_adjust_size(uint64 size)
+{
+    size = (size + ALLOCATOR_DEFAULT_ALIGNMENT - 1) & ~(uint64)(ALLOCATOR_DEFAULT_ALIGNMENT - 1);
+    return max(size, TLSF_BLOCK_MIN_SIZE);
+}
+
+
+void tlsf_allocator_init(TlsfAllocator *allocator, uint8 *memory, uint64 size)
+{
+    if (allocator == NULL)
+        return;
+
+    memory_set((uint8*)allocator, 0x00, sizeof(TlsfAllocator));
+    tlsf_allocator_add_region(allocator, memory, size);
+}
+
+
+void tlsf_allocator_add_region(TlsfAllocator *allocator, uint8 *memory, uint64 size)
+{
+    if (allocator == NULL || memory == NULL)
+        return;
+
+    uint64 start = ((uint64)memory + ALLOCATOR_DEFAULT_ALIGNMENT - 1) & ~(uint64)(ALLOCATOR_DEFAULT_ALIGNMENT - 1);
+    uint64 end = ((uint64)memory + size) & ~(uint64)(ALLOCATOR_DEFAULT_ALIGNMENT - 1);
+    if (end <= start || end - start < 4 * TLSF_BLOCK_HEADER_SIZE)
+        return;
+    end = min(end, start + TLSF_MAX_BLOCK_SIZE);
+
+    // The region ends in an empty used block, so merging never runs past it.
+    TlsfBlock *block = (TlsfBlock*)start;
+    block->prev_physical = NULL;
+    block->size = (end - start - 2 * TLSF_BLOCK_HEADER_SIZE) | TLSF_BLOCK_FREE;
+
+    TlsfBlock *sentinel = tlsf_block_next(block);
+    sentinel->prev_physical = block;
+    sentinel->size = TLSF_BLOCK_PREV_FREE;
+    tlsf_free_list_insert(allocator, block);
+    ALLOCATOR_STATS_RESERVED(&allocator->counters, end - start);
+}
+
+
+void* tlsf_allocator_memory_allocate(TlsfAllocator *allocator, uint64 size)
+{
+    if (allocator == NULL || size == 0)
+        return NULL;
+
+    TlsfBlock *block = NULL;
+    if (size <= TLSF_MAX_BLOCK_SIZE)
+        block = tlsf_find_free_block(allocator, tlsf_adjust_size(size));
+
+    if (block == NULL)
+    {
+        ALLOCATOR_STATS_FAILED(&allocator->counters);
+        return NULL;
+    }
+
+    tlsf_free_list_remove(allocator, block);
+    block->size &= ~(uint64)TLSF_BLOCK_FREE;
+    tlsf_block_next(block)->size &= ~(uint64)TLSF_BLOCK_PREV_FREE;
+    tlsf_block_trim(allocator, block, tlsf_adjust_size(size));
+
+    ALLOCATOR_STATS_ALLOCATED(&allocator->counters, size);
+    ALLOCATOR_STATS_USED(&allocator->counters, TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(block));
+    return (uint8*)block + TLSF_BLOCK_HEADER_SIZE;
+}
+
+
+void tlsf_allocator_memory_free(TlsfAllocator *allocator, void *memory)
+{
+    if (allocator == NULL || memory == NULL)
+        return;
+
+    TlsfBlock *block = tlsf_block_from_memory(memory);
+    block->size |= TLSF_BLOCK_FREE;
+    ALLOCATOR_STATS_UNUSED(&allocator->counters, TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(block));
+
+    if (block->size & TLSF_BLOCK_PREV_FREE)
+    {
+        TlsfBlock *prev = block->prev_physical;
+        tlsf_free_list_remove(allocator, prev);
+        prev->size += TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(block);
+        block = prev;
+    }
+
+    TlsfBlock *next = tlsf_block_next(block);
+    if (next->size & TLSF_BLOCK_FREE)
+    {
+        tlsf_free_list_remove(allocator, next);
+        block->size += TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(next);
+        next = tlsf_block_next(block);
+    }
+
+    next->prev_physical = block;
+    next->size |= TLSF_BLOCK_PREV_FREE;
+    tlsf_free_list_insert(allocator, block);
+}
+
+
+void* tlsf_allocator_memory_resize(TlsfAllocator *allocator, void *memory, uint64 old_size, uint64 new_size)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (memory == NULL)
+        return tlsf_allocator_memory_allocate(allocator, new_size);
+
+    if (new_size > TLSF_MAX_BLOCK_SIZE)
+        return NULL;
+
+    TlsfBlock *block = tlsf_block_from_memory(memory);
+    uint64 size = tlsf_adjust_size(new_size);
+    ALLOCATOR_STATS_UNUSED(&allocator->counters, tlsf_block_size(block));
+
+    if (size > tlsf_block_size(block))
+    {
+        TlsfBlock *next = tlsf_block_next(block);
+        if ((next->size & TLSF_BLOCK_FREE) == 0 || tlsf_block_size(block) + TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(next) < size)
+        {
+            ALLOCATOR_STATS_USED(&allocator->counters, tlsf_block_size(block));
+            void *new_memory = tlsf_allocator_memory_allocate(allocator, new_size);
+            if (new_memory == NULL)
+                return NULL;
+
+            memory_copy(memory, new_memory, min(old_size, new_size));
+            tlsf_allocator_memory_free(allocator, memory);
+            return new_memory;
+        }
+
+        tlsf_free_list_remove(allocator, next);
+        block->size += TLSF_BLOCK_HEADER_SIZE + tlsf_block_size(next);
+        tlsf_block_next(block)->size &= ~(uint64)TLSF_BLOCK_PREV_FREE;
+    }
+
+    tlsf_block_trim(allocator, block, size);
+    ALLOCATOR_STATS_USED(&allocator->counters, tlsf_block_size(block));
+    return memory;
+}
+
+
+static void* tlsf_allocator_interface_allocate(void *context, uint64 size)
+{
+    return tlsf_allocator_memory_allocate(context, size);
+}
+
+
+static void* tlsf_allocator_interface_resize(void *context, void *memory, uint64 old_size, uint64 new_size)
+{
+    return tlsf_allocator_memory_resize(context, memory, old_size, new_size);
+}
+
+
+static void tlsf_allocator_interface_free(void *context, void *memory, uint64 size)
+{
+    (void)size;
+    tlsf_allocator_memory_free(context, memory);
+}
+
+
+void tlsf_allocator_interface(AllocatorInterface *interface, TlsfAllocator *allocator)
+{
+    if (interface == NULL || allocator == NULL)
+        return;
+
+    interface->memory_allocate = NULL;
+    interface->memory_resize = NULL;
+    interface->memory_free = NULL;
+    interface->context = allocator;
+    interface->context_memory_allocate = tlsf_allocator_interface_allocate;
+    interface->context_memory_resize = tlsf_allocator_interface_resize;
+    interface->context_memory_free = tlsf_allocator_interface_free;
+}
+
+
+#ifdef C_UTILS_ALLOCATOR_STATS
+
+void tlsf_allocator_stats(TlsfAllocator *allocator, AllocatorStats *stats)
+{
+    if (allocator == NULL || stats == NULL)
+        return;
+
+    uint64 free_space = 0;
+    uint64 largest_free_space = 0;
+    for (uint32 fl = 0; fl < TLSF_FL_INDEX_COUNT; fl++)
+    {
+        for (uint32 sl = 0; sl < TLSF_SL_INDEX_COUNT; sl++)
+        {
+            for (TlsfBlock *block = allocator->blocks[fl][sl]; block != NULL; block = block->next_free)
+            {
+                free_space += tlsf_block_size(block);
+                largest_free_space = max(largest_free_space, tlsf_block_size(block));
+            }
+        }
+    }
+
+    stats->bytes_requested = allocator->counters.bytes_requested;
+    stats->bytes_used = allocator->counters.bytes_used;
+    stats->bytes_reserved = allocator->counters.bytes_reserved;
+    stats->peak_bytes_used = allocator->counters.peak_bytes_used;
+    stats->fragmented_bytes = free_space - largest_free_space;
+    stats->allocations = allocator->counters.allocations;
+    stats->failed_allocations = allocator->counters.failed_allocations;
+    stats->num_arenas = 0;
+}
+
+#endif
+
+
+#define ALLOCATOR_RECORDER_INITIAL_EVENTS 256
+#define ALLOCATOR_RECORDER_INITIAL_SLOTS 64
+
+void allocator_recorder_init(AllocatorRecorder *recorder, AllocatorInterface *target, AllocatorInterface *trace_allocator)
+{
+    if (recorder == NULL || target == NULL || trace_allocator == NULL)
+        return;
+
+    recorder->target = target;
+    recorder->trace_allocator = trace_allocator;
+    recorder->events = NULL;
+    recorder->event_count = 0;
+    recorder->event_capacity = 0;
+    recorder->slots = NULL;
+    recorder->slot_capacity = 0;
+    recorder->live_count = 0;
+    recorder->next_id = 0;
+    recorder->failed = 0;
+}
+
+
+static void allocator_recorder_add_event(AllocatorRecorder *recorder, uint32 operation, uint32 id, uint64 size)
+{
+    if (recorder->event_count == recorder->event_capacity)
+    {
+        uint64 capacity = max(recorder->event_capacity * 2, ALLOCATOR_RECORDER_INITIAL_EVENTS);
+        AllocatorTraceEvent *events = allocator_memory_resize(
+            recorder->trace_allocator,
+            recorder->events,
+            recorder->event_capacity * sizeof(AllocatorTraceEvent),
+            capacity * sizeof(AllocatorTraceEvent)
+        );
+        if (events == NULL)
+        {
+            recorder->failed = 1;
+            return;
+        }
+        recorder->events = events;
+        recorder->event_capacity = capacity;
+    }
+
+    AllocatorTraceEvent *event = &recorder->events[recorder->event_count++];
+    event->operation = operation;
+    event->id = id;
+    event->size = size;
+}
+
+
+static inline uint64 allocator_recorder_hash(uint64 address, uint64 capacity)
+{
+    return ((address >> 4) * 0x9E3779B97F4A7C15UL) & (capacity - 1);
+}
+
+
+// Return the slot holding the address, or the empty slot where it would be inserted.
+static AllocatorTraceSlot* allocator_recorder_find_slot(AllocatorTraceSlot *slots, uint64 capacity, uint64 address)
+{
+    uint64 index = allocator_recorder_hash(address, capacity);
+    while (slots[index].address != 0 && slots[index].address != address)
+        index = (index + 1) & (capacity - 1);
+    return &slots[index];
+}
+
+
+static int allocator_recorder_grow_slots(AllocatorRecorder *recorder)
+{
+    uint64 capacity = max(recorder->slot_capacity * 2, ALLOCATOR_RECORDER_INITIAL_SLOTS);
+    AllocatorTraceSlot *slots = allocator_memory_allocate(recorder->trace_allocator, capacity * sizeof(AllocatorTraceSlot));
+    if (slots == NULL)
+        return 0;
+
+    memory_set((uint8*)slots, 0x00, capacity * sizeof(AllocatorTraceSlot));
+    for (uint64 i = 0; i < recorder->slot_capacity; i++)
+    {
+        if (recorder->slots[i].address != 0)
+            *allocator_recorder_find_slot(slots, capacity, recorder->slots[i].address) = recorder->slots[i];
+    }
+
+    if (recorder->slots != NULL)
+        allocator_memory_free(recorder->trace_allocator, recorder->slots, recorder->slot_capacity * sizeof(AllocatorTraceSlot));
+    recorder->slots = slots;
+    recorder->slot_capacity = capacity;
+    return 1;
+}
+
+
+static void allocator_recorder_insert(AllocatorRecorder *recorder, void *memory, uint32 id)
+{
+    if (2 * (recorder->live_count + 1) > recorder->slot_capacity && !allocator_recorder_grow_slots(recorder))
+    {
+        recorder->failed = 1;
+        return;
+    }
+
+    AllocatorTraceSlot *slot = allocator_recorder_find_slot(recorder->slots, recorder->slot_capacity, (uint64)memory);
+    if (slot->address == 0)
+        recorder->live_count++;
+    slot->address = (uint64)memory;
+    slot->id = id;
+}
+
+
+// Remove the address from the table, returns 0 if it was not recorded.
+static int allocator_recorder_remove(AllocatorRecorder *recorder, void *memory, uint32 *id)
+{
+    if (recorder->slots == NULL)
+        return 0;
+
+    uint64 mask = recorder->slot_capacity - 1;
+    AllocatorTraceSlot *slot = allocator_recorder_find_slot(recorder->slots, recorder->slot_capacity, (uint64)memory);
+    if (slot->address == 0)
+        return 0;
+
+    *id = (uint32)slot->id;
+    recorder->live_count--;
+
+    // Shift the following entries back so that no probe sequence is broken.
+    uint64 hole = slot - recorder->slots;
+    uint64 index = (hole + 1) & mask;
+    while (recorder->slots[index].address != 0)
+    {
+        uint64 home = allocator_recorder_hash(recorder->slots[index].address, recorder->slot_capacity);
+        if (((index - home) & mask) >= ((index - hole) & mask))
+        {
+            recorder->slots[hole] = recorder->slots[index];
+            hole = index;
+        }
+        index = (index + 1) & mask;
+    }
+    recorder->slots[hole].address = 0;
+    return 1;
+}
+
+
+static void* allocator_recorder_interface_allocate(void *context, uint64 size)
+{
+    AllocatorRecorder *recorder = context;
+    uint32 id = recorder->next_id++;
+    void *memory = allocator_memory_allocate(recorder->target, size);
+
+    allocator_recorder_add_event(recorder, ALLOCATOR_TRACE_ALLOCATE, id, size);
+    if (memory != NULL)
+        allocator_recorder_insert(recorder, memory, id);
+    return memory;
+}
+
+
+static void* allocator_recorder_interface_resize(void *context, void *memory, uint64 old_size, uint64 new_size)
+{
+    AllocatorRecorder *recorder = context;
+    uint32 id;
+    if (memory == NULL || !allocator_recorder_remove(recorder, memory, &id))
+        return allocator_memory_resize(recorder->target, memory, old_size, new_size);
+
+    // A failed resize leaves the block as it was, so there is nothing to replay.
+    void *new_memory = allocator_memory_resize(recorder->target, memory, old_size, new_size);
+    if (new_memory != NULL)
+        allocator_recorder_add_event(recorder, ALLOCATOR_TRACE_RESIZE, id, new_size);
+    allocator_recorder_insert(recorder, new_memory != NULL ? new_memory : memory, id);
+    return new_memory;
+}
+
+
+static void allocator_recorder_interface_free(void *context, void *memory, uint64 size)
+{
+    AllocatorRecorder *recorder = context;
+    uint32 id;
+    if (memory != NULL && allocator_recorder_remove(recorder, memory, &id))
+        allocator_recorder_add_event(recorder, ALLOCATOR_TRACE_FREE, id, size);
+    allocator_memory_free(recorder->target, memory, size);
+}
+
+
+void allocator_recorder_interface(AllocatorInterface *interface, AllocatorRecorder *recorder)
+{
+    if (interface == NULL || recorder == NULL)
+        return;
+
+    interface->memory_allocate = NULL;
+    interface->memory_resize = NULL;
+    interface->memory_free = NULL;
+    interface->context = recorder;
+    interface->context_memory_allocate = allocator_recorder_interface_allocate;
+    interface->context_memory_resize = allocator_recorder_interface_resize;
+    interface->context_memory_free = allocator_recorder_interface_free;
+}
+
+
+void allocator_recorder_destroy(AllocatorRecorder *recorder)
+{
+    if (recorder == NULL)
+        return;
+
+    if (recorder->events != NULL)
+        allocator_memory_free(recorder->trace_allocator, recorder->events, recorder->event_capacity * sizeof(AllocatorTraceEvent));
+    if (recorder->slots != NULL)
+        allocator_memory_free(recorder->trace_allocator, recorder->slots, recorder->slot_capacity * sizeof(AllocatorTraceSlot));
+
+    recorder->events = NULL;
+    recorder->event_count = 0;
+    recorder->event_capacity = 0;
+    recorder->slots = NULL;
+    recorder->slot_capacity = 0;
+    recorder->live_count = 0;
+}
+
+
+uint64 allocator_trace_replay(AllocatorTraceEvent *events, uint64 count, AllocatorInterface *allocator, AllocatorInterface *scratch)
+{
+    if (events == NULL || allocator == NULL || scratch == NULL || count == 0)
+        return 0;
+
+    // Every id of a recorded trace belongs to one of its allocate events, so
+    // ids are below count. Traces loaded from files are checked before running.
+    uint64 num_ids = 0;
+    for (uint64 i = 0; i < count; i++)
+    {
+        if (events[i].operation < ALLOCATOR_TRACE_ALLOCATE || events[i].operation > ALLOCATOR_TRACE_FREE)
+            return count;
+        if (events[i].id >= count)
+            return count;
+        num_ids = max(num_ids, (uint64)events[i].id + 1);
+    }
+
+    // Address and current size of every block, indexed by id.
+    uint64 table_size = num_ids * 2 * sizeof(uint64);
+    uint64 *blocks = allocator_memory_allocate(scratch, table_size);
+    if (blocks == NULL)
+        return count;
+    memory_set((uint8*)blocks, 0x00, table_size);
+
+    uint64 failed = 0;
+    void *memory;
+    AllocatorTraceEvent *event;
+    for (uint64 i = 0; i < count; i++)
+    {
+        event = &events[i];
+        uint64 *block = &blocks[2 * event->id];
+        switch (event->operation)
+        {
+        case ALLOCATOR_TRACE_ALLOCATE:
+            memory = allocator_memory_allocate(allocator, event->size);
+            if (memory == NULL)
+                failed++;
+            block[0] = (uint64)memory;
+            block[1] = event->size;
+            break;
+
+        case ALLOCATOR_TRACE_RESIZE:
+            if (block[0] == 0)
+                break;
+            memory = allocator_memory_resize(allocator, (void*)block[0], block[1], event->size);
+            if (memory == NULL)
+            {
+                failed++;
+                break;
+            }
+            block[0] = (uint64)memory;
+            block[1] = event->size;
+            break;
+
+        case ALLOCATOR_TRACE_FREE:
+            if (block[0] == 0)
+                break;
+            allocator_memory_free(allocator, (void*)block[0], block[1]);
+            block[0] = 0;
+            break;
+        }
+    }
+
+    for (uint64 id = 0; id < num_ids; id++)
+    {
+        if (blocks[2 * id] != 0)
+            allocator_memory_free(allocator, (void*)blocks[2 * id], blocks[2 * id + 1]);
+    }
+
+    allocator_memory_free(scratch, blocks, table_size);
+    return failed;
+}
+
+
+inline Array* array_new(AllocatorInterface* allocator, uint32 member_count,  uint32 member_size)
+{
+    Array *array = array_new_no_init(allocator, member_count, member_size);
+    if (array == NULL)
+        return NULL;
+
+    memory_set(array->data, 0x00, (uint64)member_count * member_size);
+
+    return array;
+}
+
+
+Array* array_new_no_init(AllocatorInterface* allocator, uint32 member_count,  uint32 member_size)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (member_count == 0 || member_size == 0)
+        return NULL;
+
+    void *memory = allocator_memory_allocate(allocator, ARRAY_DATA_OFFSET + ((uint64)member_count * member_size));
+    if (memory == NULL)
+        return NULL;
+
+    Array *array = (Array*) memory;
+    array->member_count = member_count;
+    array->member_size = member_size;
+    return array;
+}
+
+
+void array_get(Array *array, uint32 index, uint8 *memory)
+{
+    if (array == NULL || memory == NULL)
+        return;
+
+    if (index >= array->member_count)
+        return;
+
+    uint64 offset = (uint64)array->member_size * index;
+    memory_copy(&array->data[offset], memory, array->member_size);
+}
+
+
+void array_set(Array *array, uint32 index, uint8 *memory)
+{
+    if (array == NULL || memory == NULL)
+        return;
+
+    if (index >= array->member_count)
+        return;
+
+    uint64 offset = (uint64)array->member_size * index;
+    memory_copy(memory, &array->data[offset], array->member_size);
+}
+
+
+void array_copy_memory(Array *array, uint8 *memory, uint64 max_length)
+{
+    if (array == NULL || memory == NULL)
+        return;
+
+    uint64 length = (uint64)array->member_count * array->member_size;
+    memory_copy(memory, array->data, min(length, max_length));
+}
+
+
+Array* array_create_slice(Array *src_array, AllocatorInterface *allocator, uint32 start, uint32 end)
+{
+    if (src_array == NULL || allocator == NULL)
+        return NULL;
+
+    if (start >= src_array->member_count)
+        return NULL;
+
+    if (end >= src_array->member_count)
+        return NULL;
+
+    if (end-start <= 0)
+        return NULL;
+
+    Array *slice_array = array_new(allocator, end-start, src_array->member_size);
+    if (slice_array == NULL)
+        return NULL;
+
+    uint64 offset = (uint64)start * src_array->member_size;
+    uint64 length = (uint64)(end-start) * src_array->member_size;
+    memory_copy(&src_array->data[offset], slice_array->data, length);
+
+    return slice_array;
+}
+
+
+void array_foreach(Array *array, void (*func)(uint8*))
+{
+    if (array == NULL || func == NULL)
+        return;
+
+    for (uint64 i = 0; i < array->member_count * array->member_size; i += array->member_size)
+        func(&array->data[i]);
+}
+
+
+#define COMPARE_VALUES(a, b) \
+    ((a) < (b) ? COMPARISON_RESULT_FIRST_IS_SMALLER : ((a) > (b) ? COMPARISON_RESULT_FIRST_IS_LARGER : COMPARISON_RESULT_ARE_EQUAL))
+
+enum ComparisonResult compare_int32(uint8 *a, uint8 *b)
+{
+    const int32 x = (int32)*(unaligned_uint32*)a;
+    const int32 y = (int32)*(unaligned_uint32*)b;
+    return COMPARE_VALUES(x, y);
+}
+
+
+enum ComparisonResult compare_uint32(uint8 *a, uint8 *b)
+{
+    const uint32 x = *(unaligned_uint32*)a;
+    const uint32 y = *(unaligned_uint32*)b;
+    return COMPARE_VALUES(x, y);
+}
+
+
+enum ComparisonResult compare_int64(uint8 *a, uint8 *b)
+{
+    const int64 x = (int64)*(unaligned_uint64*)a;
+    const int64 y = (int64)*(unaligned_uint64*)b;
+    return COMPARE_VALUES(x, y);
+}
+
+
+enum ComparisonResult compare_uint64(uint8 *a, uint8 *b)
+{
+    const uint64 x = *(unaligned_uint64*)a;
+    const uint64 y = *(unaligned_uint64*)b;
+    return COMPARE_VALUES(x, y);
+}
+
+
+enum ComparisonResult compare_float32(uint8 *a, uint8 *b)
+{
+    const float x = *(unaligned_float32*)a;
+    const float y = *(unaligned_float32*)b;
+    return COMPARE_VALUES(x, y);
+}
+
+
+enum ComparisonResult compare_float64(uint8 *a, uint8 *b)
+{
+    const double x = *(unaligned_float64*)a;
+    const double y = *(unaligned_float64*)b;
+    return COMPARE_VALUES(x, y);
+}
+
+
+// Ranges of at most this many members are finished with insertion sort.
+#define SORT_INSERTION_THRESHOLD 16
+// Ranges of at least this many members take the pivot from nine candidates.
+#define SORT_NINTHER_THRESHOLD 128
+// Insertion sort keeps members up to this size in a local copy instead of swapping.
+#define SORT_MAX_LOCAL_MEMBER_SIZE 16
+// Natural runs shorter than this are extended with insertion sort before merging.
+#define SORT_MIN_RUN 32
+
+// The sort helpers are always inlined into the kernels below, so a constant
+// member_size selects the word-wide moves and a constant built-in
+// comparator is inlined into the comparisons.
+#define SORT_INLINE static inline __attribute__((always_inline))
+
+SORT_INLINE void sort_swap(uint8 *a, uint8 *b, uint32 member_size)
+{
+    uint64 x, y;
+    uint32 i = 0;
+
+    switch (member_size)
+    {
+        case 4:
+            x = *(unaligned_uint32*)a;
+            *(unaligned_uint32*)a = *(unaligned_uint32*)b;
+            *(unaligned_uint32*)b = (uint32)x;
+            return;
+
+        case 8:
+            x = *(unaligned_uint64*)a;
+            *(unaligned_uint64*)a = *(unaligned_uint64*)b;
+            *(unaligned_uint64*)b = x;
+            return;
+
+        case 16:
+            x = ((unaligned_uint64*)a)[0];
+            y = ((unaligned_uint64*)a)[1];
+            ((unaligned_uint64*)a)[0] = ((unaligned_uint64*)b)[0];
+            ((unaligned_uint64*)a)[1] = ((unaligned_uint64*)b)[1];
+            ((unaligned_uint64*)b)[0] = x;
+            ((unaligned_uint64*)b)[1] = y;
+            return;
+    }
+
+    for (; i + 8 <= member_size; i += 8)
+    {
+        x = *(unaligned_uint64*)(a + i);
+        *(unaligned_uint64*)(a + i) = *(unaligned_uint64*)(b + i);
+        *(unaligned_uint64*)(b + i) = x;
+    }
+    for (; i < member_size; i++)
+    {
+        x = a[i];
+        a[i] = b[i];
+        b[i] = (uint8)x;
+    }
+}
+
+
+// Copy a member, as whole words when it is 4, 8 or 16 bytes.
+SORT_INLINE void sort_move(uint8 *target, uint8 *src, uint32 member_size)
+{
+    switch (member_size)
+    {
+        case 4:
+            *(unaligned_uint32*)target = *(unaligned_uint32*)src;
+            return;
+
+        case 8:
+            *(unaligned_uint64*)target = *(unaligned_uint64*)src;
+            return;
+
+        case 16:
+            ((unaligned_uint64*)target)[0] = ((unaligned_uint64*)src)[0];
+            ((unaligned_uint64*)target)[1] = ((unaligned_uint64*)src)[1];
+            return;
+    }
+    memory_copy_word(src, target, member_size);
+}
+
+
+SORT_INLINE void insertion_sort(uint8 *base, uint64 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    uint8 *member;
+    uint8 local[SORT_MAX_LOCAL_MEMBER_SIZE];
+
+    for (uint64 i = 1; i < count; i++)
+    {
+        member = base + i * member_size;
+        if (member_size > SORT_MAX_LOCAL_MEMBER_SIZE)
+        {
+            while (member > base && compare(member, member - member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER)
+            {
+                sort_swap(member, member - member_size, member_size);
+                member -= member_size;
+            }
+            continue;
+        }
+
+        // Shift the larger members up and drop the member into the gap.
+        if (compare(member, member - member_size) != COMPARISON_RESULT_FIRST_IS_SMALLER)
+            continue;
+
+        sort_move(local, member, member_size);
+        do
+        {
+            sort_move(member, member - member_size, member_size);
+            member -= member_size;
+        }
+        while (member > base && compare(local, member - member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER);
+        sort_move(member, local, member_size);
+    }
+}
+
+
+SORT_INLINE void heap_sift_down(uint8 *base, uint64 root, uint64 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    uint64 child;
+    while ((child = 2 * root + 1) < count)
+    {
+        if (child + 1 < count && compare(base + child * member_size, base + (child + 1) * member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER)
+            child++;
+
+        if (compare(base + root * member_size, base + child * member_size) != COMPARISON_RESULT_FIRST_IS_SMALLER)
+            return;
+
+        sort_swap(base + root * member_size, base + child * member_size, member_size);
+        root = child;
+    }
+}
+
+
+SORT_INLINE void heapsort(uint8 *base, uint64 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    for (uint64 i = count / 2; i > 0; i--)
+        heap_sift_down(base, i - 1, count, member_size, compare);
+
+    for (uint64 end = count - 1; end > 0; end--)
+    {
+        sort_swap(base, base + end * member_size, member_size);
+        heap_sift_down(base, 0, end, member_size, compare);
+    }
+}
+
+
+SORT_INLINE uint64 median_of_three(uint8 *base, uint64 a, uint64 b, uint64 c, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    const int a_less_b = compare(base + a * member_size, base + b * member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER;
+    const int b_less_c = compare(base + b * member_size, base + c * member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER;
+    if (a_less_b == b_less_c)
+        return b;
+
+    const int a_less_c = compare(base + a * member_size, base + c * member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER;
+    return a_less_c == b_less_c ? a : c;
+}
+
+
+// Move the pivot into the first member and partition the rest around it.
+// Returns the final index of the pivot, members before it are not larger
+// and members after it are not smaller. Members equal to the pivot are
+// spread on both sides, so runs of equal members split evenly.
+SORT_INLINE uint64 sort_partition(uint8 *base, uint64 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    const uint64 mid = count / 2;
+    const uint64 last = count - 1;
+    uint64 pivot;
+
+    if (count >= SORT_NINTHER_THRESHOLD)
+    {
+        const uint64 step = count / 8;
+        pivot = median_of_three(base,
+            median_of_three(base, 0, step, 2 * step, member_size, compare),
+            median_of_three(base, mid - step, mid, mid + step, member_size, compare),
+            median_of_three(base, last - 2 * step, last - step, last, member_size, compare),
+            member_size, compare);
+    }
+    else
+    {
+        pivot = median_of_three(base, 0, mid, last, member_size, compare);
+    }
+    sort_swap(base, base + pivot * member_size, member_size);
+
+    uint64 i = 0;
+    uint64 j = count;
+    for (;;)
+    {
+        do
+            i++;
+        while (i < count && compare(base + i * member_size, base) == COMPARISON_RESULT_FIRST_IS_SMALLER);
+
+        do
+            j--;
+        while (compare(base, base + j * member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER);
+
+        if (i >= j)
+            break;
+        sort_swap(base + i * member_size, base + j * member_size, member_size);
+    }
+
+    sort_swap(base, base + j * member_size, member_size);
+    return j;
+}
+
+
+// Quicksort that continues with the smaller partition and pushes the larger one,
+// so the stack never holds more than log2(count) ranges. Switches to heapsort
+// once a range has been partitioned 2 * log2(count) times, which bounds
+// the worst case to O(n log n).
+SORT_INLINE void introsort(uint8 *base, uint64 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    struct { uint8 *base; uint64 count; uint32 depth_limit; } stack[64];
+    uint32 top = 0;
+    uint32 depth_limit = 2 * (63 - __builtin_clzl(count));
+    uint64 pivot, left, right;
+
+    for (;;)
+    {
+        while (count > SORT_INSERTION_THRESHOLD)
+        {
+            if (depth_limit == 0)
+            {
+                heapsort(base, count, member_size, compare);
+                count = 0;
+                break;
+            }
+            depth_limit--;
+
+            pivot = sort_partition(base, count, member_size, compare);
+            left = pivot;
+            right = count - pivot - 1;
+            if (left < right)
+            {
+                stack[top].base = base + (pivot + 1) * member_size;
+                stack[top].count = right;
+                count = left;
+            }
+            else
+            {
+                stack[top].base = base;
+                stack[top].count = left;
+                base += (pivot + 1) * member_size;
+                count = right;
+            }
+            stack[top++].depth_limit = depth_limit;
+        }
+
+        insertion_sort(base, count, member_size, compare);
+        if (top == 0)
+            return;
+
+        top--;
+        base = stack[top].base;
+        count = stack[top].count;
+        depth_limit = stack[top].depth_limit;
+    }
+}
+
+
+static void introsort_int32(uint8 *base, uint64 count)
+{
+    introsort(base, count, 4, compare_int32);
+}
+
+
+static void introsort_uint32(uint8 *base, uint64 count)
+{
+    introsort(base, count, 4, compare_uint32);
+}
+
+
+static void introsort_float32(uint8 *base, uint64 count)
+{
+    introsort(base, count, 4, compare_float32);
+}
+
+
+static void introsort_int64(uint8 *base, uint64 count)
+{
+    introsort(base, count, 8, compare_int64);
+}
+
+
+static void introsort_uint64(uint8 *base, uint64 count)
+{
+    introsort(base, count, 8, compare_uint64);
+}
+
+
+static void introsort_float64(uint8 *base, uint64 count)
+{
+    introsort(base, count, 8, compare_float64);
+}
+
+
+static void introsort_size4(uint8 *base, uint64 count, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    introsort(base, count, 4, compare);
+}
+
+
+static void introsort_size8(uint8 *base, uint64 count, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    introsort(base, count, 8, compare);
+}
+
+
+static void introsort_size16(uint8 *base, uint64 count, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    introsort(base, count, 16, compare);
+}
+
+
+static void introsort_generic(uint8 *base, uint64 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    introsort(base, count, member_size, compare);
+}
+
+
+// Merge the sorted runs [base, base + left_count) and the right_count
+// members following it. Only the shorter run is copied into scratch,
+// so scratch must hold min(left_count, right_count) members.
+SORT_INLINE void merge_runs(uint8 *base, uint64 left_count, uint64 right_count, uint8 *scratch, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    uint8 *mid = base + left_count * member_size;
+    if (compare(mid - member_size, mid) != COMPARISON_RESULT_FIRST_IS_LARGER)
+        return;
+
+    if (left_count <= right_count)
+    {
+        memory_copy(base, scratch, left_count * member_size);
+        uint8 *left = scratch;
+        uint8 *right = mid;
+        uint8 *target = base;
+        uint64 right_end = right_count;
+
+        while (left_count > 0 && right_end > 0)
+        {
+            if (compare(right, left) == COMPARISON_RESULT_FIRST_IS_SMALLER)
+            {
+                sort_move(target, right, member_size);
+                right += member_size;
+                right_end--;
+            }
+            else
+            {
+                sort_move(target, left, member_size);
+                left += member_size;
+                left_count--;
+            }
+            target += member_size;
+        }
+        memory_copy(left, target, left_count * member_size);
+        return;
+    }
+
+    // Merge from the back so the left run can stay in place.
+    memory_copy(mid, scratch, right_count * member_size);
+    uint8 *left = mid - member_size;
+    uint8 *right = scratch + (right_count - 1) * member_size;
+    uint8 *target = mid + (right_count - 1) * member_size;
+
+    while (left_count > 0 && right_count > 0)
+    {
+        if (compare(right, left) == COMPARISON_RESULT_FIRST_IS_SMALLER)
+        {
+            sort_move(target, left, member_size);
+            left -= member_size;
+            left_count--;
+        }
+        else
+        {
+            sort_move(target, right, member_size);
+            right -= member_size;
+            right_count--;
+        }
+        target -= member_size;
+    }
+    memory_copy(scratch, base, right_count * member_size);
+}
+
+
+// Natural merge sort. Ascending runs are taken as they are, strictly
+// descending runs are reversed, and short runs are extended to SORT_MIN_RUN
+// members with insertion sort. Adjacent runs are then merged pairwise until
+// one is left, so sorted input costs a single scan. The runs array holds
+// count / SORT_MIN_RUN + 2 indices and is not used for smaller counts.
+SORT_INLINE void merge_sort(uint8 *base, uint32 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*), uint8 *scratch, uint32 *runs)
+{
+    uint32 run_count = 0;
+    uint32 start = 0;
+
+    while (start < count)
+    {
+        uint32 end = start + 1;
+        if (end < count && compare(base + (uint64)end * member_size, base + (uint64)start * member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER)
+        {
+            while (end < count && compare(base + (uint64)end * member_size, base + (uint64)(end - 1) * member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER)
+                end++;
+
+            for (uint32 a = start, b = end - 1; a < b; a++, b--)
+                sort_swap(base + (uint64)a * member_size, base + (uint64)b * member_size, member_size);
+        }
+        else
+        {
+            while (end < count && compare(base + (uint64)end * member_size, base + (uint64)(end - 1) * member_size) != COMPARISON_RESULT_FIRST_IS_SMALLER)
+                end++;
+        }
+
+        if (end - start < SORT_MIN_RUN && end < count)
+        {
+            end = min(start + SORT_MIN_RUN, count);
+            insertion_sort(base + (uint64)start * member_size, end - start, member_size, compare);
+        }
+
+        if (start == 0 && end == count)
+            return;
+
+        runs[run_count++] = start;
+        start = end;
+    }
+    runs[run_count] = count;
+
+    while (run_count > 1)
+    {
+        uint32 merged = 0;
+        uint32 i = 0;
+        for (; i + 1 < run_count; i += 2)
+        {
+            merge_runs(base + (uint64)runs[i] * member_size, runs[i + 1] - runs[i], runs[i + 2] - runs[i + 1], scratch, member_size, compare);
+            runs[merged++] = runs[i];
+        }
+        if (i < run_count)
+            runs[merged++] = runs[i];
+
+        runs[merged] = count;
+        run_count = merged;
+    }
+}
+
+
+static void merge_sort_size4(uint8 *base, uint32 count, enum ComparisonResult (*compare)(uint8*, uint8*), uint8 *scratch, uint32 *runs)
+{
+    merge_sort(base, count, 4, compare, scratch, runs);
+}
+
+
+static void merge_sort_size8(uint8 *base, uint32 count, enum ComparisonResult (*compare)(uint8*, uint8*), uint8 *scratch, uint32 *runs)
+{
+    merge_sort(base, count, 8, compare, scratch, runs);
+}
+
+
+static void merge_sort_size16(uint8 *base, uint32 count, enum ComparisonResult (*compare)(uint8*, uint8*), uint8 *scratch, uint32 *runs)
+{
+    merge_sort(base, count, 16, compare, scratch, runs);
+}
+
+
+static void merge_sort_generic(uint8 *base, uint32 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*), uint8 *scratch, uint32 *runs)
+{
+    merge_sort(base, count, member_size, compare, scratch, runs);
+}
+
+
+static void merge_sort_members(uint8 *base, uint32 count, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*), uint8 *scratch, uint32 *runs)
+{
+    switch (member_size)
+    {
+        case 4:
+            merge_sort_size4(base, count, compare, scratch, runs);
+            break;
+
+        case 8:
+            merge_sort_size8(base, count, compare, scratch, runs);
+            break;
+
+        case 16:
+            merge_sort_size16(base, count, compare, scratch, runs);
+            break;
+
+        default:
+            merge_sort_generic(base, count, member_size, compare, scratch, runs);
+            break;
+    }
+}
+
+
+// Write the members [first, last) of the stable merge of the sorted runs
+// left and right into the same positions of target. The starting point in
+// both runs is found with a binary search along the merge path, so separate
+// output ranges can be merged independently of each other.
+SORT_INLINE void merge_range(uint8 *left, uint64 left_count, uint8 *right, uint64 right_count, uint8 *target, uint64 first, uint64 last, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    uint64 low = first > right_count ? first - right_count : 0;
+    uint64 high = min(first, left_count);
+    uint64 i, j;
+
+    // Find the number of left members in the first 'first' outputs.
+    // Equal members are taken from the left run first.
+    while (low < high)
+    {
+        i = low + (high - low) / 2;
+        j = first - i;
+        if (compare(right + (j - 1) * member_size, left + i * member_size) != COMPARISON_RESULT_FIRST_IS_SMALLER)
+            low = i + 1;
+        else
+            high = i;
+    }
+
+    i = low;
+    j = first - low;
+    target += first * member_size;
+    for (uint64 k = first; k < last; k++)
+    {
+        if (j < right_count && (i == left_count || compare(right + j * member_size, left + i * member_size) == COMPARISON_RESULT_FIRST_IS_SMALLER))
+        {
+            sort_move(target, right + j * member_size, member_size);
+            j++;
+        }
+        else
+        {
+            sort_move(target, left + i * member_size, member_size);
+            i++;
+        }
+        target += member_size;
+    }
+}
+
+
+static void merge_range_members(uint8 *left, uint64 left_count, uint8 *right, uint64 right_count, uint8 *target, uint64 first, uint64 last, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    switch (member_size)
+    {
+        case 4:
+            merge_range(left, left_count, right, right_count, target, first, last, 4, compare);
+            break;
+
+        case 8:
+            merge_range(left, left_count, right, right_count, target, first, last, 8, compare);
+            break;
+
+        case 16:
+            merge_range(left, left_count, right, right_count, target, first, last, 16, compare);
+            break;
+
+        default:
+            merge_range(left, left_count, right, right_count, target, first, last, member_size, compare);
+            break;
+    }
+}
+
+
+void array_sort(Array *array, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    if (array == NULL || compare == NULL)
+        return;
+
+    if (array->member_count < 2 || array->member_size == 0)
+        return;
+
+    uint8 *base = array->data;
+    const uint64 count = array->member_count;
+    switch (array->member_size)
+    {
+        case 4:
+            if (compare == compare_int32)
+                introsort_int32(base, count);
+            else if (compare == compare_uint32)
+                introsort_uint32(base, count);
+            else if (compare == compare_float32)
+                introsort_float32(base, count);
+            else
+                introsort_size4(base, count, compare);
+            break;
+
+        case 8:
+            if (compare == compare_int64)
+                introsort_int64(base, count);
+            else if (compare == compare_uint64)
+                introsort_uint64(base, count);
+            else if (compare == compare_float64)
+                introsort_float64(base, count);
+            else
+                introsort_size8(base, count, compare);
+            break;
+
+        case 16:
+            introsort_size16(base, count, compare);
+            break;
+
+        default:
+            introsort_generic(base, count, array->member_size, compare);
+            break;
+    }
+}
+
+
+#define RADIX_BUCKETS 256
+
+
+// Digit of the member for one radix pass. Flip turns the top byte of signed
+// keys into unsigned order, and for floats the sign of the key selects
+// between flipping only the sign bit and flipping every bit.
+SORT_INLINE uint8 radix_digit(uint8 *member, uint32 index, uint8 flip, uint32 sign_index, uint8 float_mask)
+{
+    uint8 sign = (uint8)-(member[sign_index] >> 7);
+    return member[index] ^ (flip | (sign & float_mask));
+}
+
+
+SORT_INLINE void radix_scatter(uint8 *src, uint8 *dst, uint32 count, uint32 member_size, uint32 *offsets, uint32 index, uint8 flip, uint32 sign_index, uint8 float_mask)
+{
+    for (uint32 i = 0; i < count; i++)
+    {
+        uint8 *member = src + (uint64)i * member_size;
+        uint8 digit = radix_digit(member, index, flip, sign_index, float_mask);
+        sort_move(dst + (uint64)offsets[digit]++ * member_size, member, member_size);
+    }
+}
+
+
+static void radix_scatter_size4(uint8 *src, uint8 *dst, uint32 count, uint32 *offsets, uint32 index, uint8 flip, uint32 sign_index, uint8 float_mask)
+{
+    radix_scatter(src, dst, count, 4, offsets, index, flip, sign_index, float_mask);
+}
+
+
+static void radix_scatter_size8(uint8 *src, uint8 *dst, uint32 count, uint32 *offsets, uint32 index, uint8 flip, uint32 sign_index, uint8 float_mask)
+{
+    radix_scatter(src, dst, count, 8, offsets, index, flip, sign_index, float_mask);
+}
+
+
+static void radix_scatter_size16(uint8 *src, uint8 *dst, uint32 count, uint32 *offsets, uint32 index, uint8 flip, uint32 sign_index, uint8 float_mask)
+{
+    radix_scatter(src, dst, count, 16, offsets, index, flip, sign_index, float_mask);
+}
+
+
+static void radix_scatter_generic(uint8 *src, uint8 *dst, uint32 count, uint32 member_size, uint32 *offsets, uint32 index, uint8 flip, uint32 sign_index, uint8 float_mask)
+{
+    radix_scatter(src, dst, count, member_size, offsets, index, flip, sign_index, float_mask);
+}
+
+
+int array_sort_radix(Array *array, AllocatorInterface *allocator, RadixKey key)
+{
+    if (array == NULL || allocator == NULL || key.width == 0)
+        return 1;
+
+    const uint32 member_size = array->member_size;
+    if ((uint64)key.offset + key.width > member_size)
+        return 1;
+
+    switch (key.type)
+    {
+        case RADIX_KEY_UNSIGNED:
+        case RADIX_KEY_SIGNED:
+            if (key.width > 8)
+                return 1;
+            break;
+
+        case RADIX_KEY_FLOAT:
+            if (key.width != 4 && key.width != 8)
+                return 1;
+            break;
+
+        case RADIX_KEY_BYTES:
+            break;
+
+        default:
+            return 1;
+    }
+
+    const uint32 count = array->member_count;
+    if (count < 2)
+        return 0;
+
+    const uint64 data_size = (uint64)count * member_size;
+    const uint64 counts_size = (uint64)key.width * RADIX_BUCKETS * sizeof(uint32);
+    uint8 *scratch = allocator_memory_allocate(allocator, counts_size + data_size);
+    if (scratch == NULL)
+        return 1;
+
+    // Pass p sorts by the p:th least significant byte of the key.
+    // For integers and floats that is the byte at key.offset + p.
+    const int bytes = key.type == RADIX_KEY_BYTES;
+    const uint32 sign_index = key.offset + key.width - 1;
+    const uint8 float_mask = key.type == RADIX_KEY_FLOAT ? 0xFF : 0x00;
+    const uint8 top_flip = key.type == RADIX_KEY_SIGNED || key.type == RADIX_KEY_FLOAT ? 0x80 : 0x00;
+
+    uint32 *counts = (uint32*)scratch;
+    memory_set(scratch, 0, counts_size);
+    for (uint32 i = 0; i < count; i++)
+    {
+        uint8 *member = array->data + (uint64)i * member_size;
+        for (uint32 p = 0; p < key.width; p++)
+        {
+            uint32 index = bytes ? key.offset + key.width - 1 - p : key.offset + p;
+            uint8 flip = !bytes && p == key.width - 1 ? top_flip : 0;
+            counts[p * RADIX_BUCKETS + radix_digit(member, index, flip, sign_index, float_mask)]++;
+        }
+    }
+
+    uint8 *src = array->data;
+    uint8 *dst = scratch + counts_size;
+    for (uint32 p = 0; p < key.width; p++)
+    {
+        uint32 index = bytes ? key.offset + key.width - 1 - p : key.offset + p;
+        uint8 flip = !bytes && p == key.width - 1 ? top_flip : 0;
+        uint32 *offsets = counts + p * RADIX_BUCKETS;
+        if (offsets[radix_digit(src, index, flip, sign_index, float_mask)] == count)
+            continue;
+
+        uint32 offset = 0;
+        for (uint32 digit = 0; digit < RADIX_BUCKETS; digit++)
+        {
+            uint32 bucket = offsets[digit];
+            offsets[digit] = offset;
+            offset += bucket;
+        }
+
+        switch (member_size)
+        {
+            case 4:
+                radix_scatter_size4(src, dst, count, offsets, index, flip, sign_index, float_mask);
+                break;
+
+            case 8:
+                radix_scatter_size8(src, dst, count, offsets, index, flip, sign_index, float_mask);
+                break;
+
+            case 16:
+                radix_scatter_size16(src, dst, count, offsets, index, flip, sign_index, float_mask);
+                break;
+
+            default:
+                radix_scatter_generic(src, dst, count, member_size, offsets, index, flip, sign_index, float_mask);
+                break;
+        }
+
+        uint8 *sorted = dst;
+        dst = src;
+        src = sorted;
+    }
+
+    if (src != array->data)
+        memory_copy(src, array->data, data_size);
+
+    allocator_memory_free(allocator, scratch, counts_size + data_size);
+    return 0;
+}
+
+
+int array_sort_stable(Array *array, AllocatorInterface *allocator, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    if (array == NULL || allocator == NULL || compare == NULL)
+        return 1;
+
+    const uint32 count = array->member_count;
+    const uint32 member_size = array->member_size;
+    if (count < 2 || member_size == 0)
+        return 0;
+
+    // Small arrays are a single run and need no scratch memory.
+    uint8 *scratch = NULL;
+    uint32 *runs = NULL;
+    uint64 runs_size = 0;
+    uint64 scratch_size = 0;
+    if (count > SORT_MIN_RUN)
+    {
+        runs_size = ((uint64)count / SORT_MIN_RUN + 2) * sizeof(uint32);
+        scratch_size = runs_size + (uint64)(count / 2) * member_size;
+        runs = allocator_memory_allocate(allocator, scratch_size);
+        if (runs == NULL)
+            return 1;
+
+        scratch = (uint8*)runs + runs_size;
+    }
+
+    merge_sort_members(array->data, count, member_size, compare, scratch, runs);
+    if (runs != NULL)
+        allocator_memory_free(allocator, runs, scratch_size);
+    return 0;
+}
+
+
+// Every task of array_sort_parallel gets at least this many members.
+#define SORT_PARALLEL_MIN_TASK_SIZE 4096
+
+typedef struct ParallelSort
+{
+    uint8 *data;
+    uint8 *src;
+    uint8 *dst;
+    // Start of every run in the current round, runs[run_count] == count.
+    uint32 *runs;
+    uint32 *chunk_runs;
+    uint32 chunk_runs_size;
+    uint32 run_count;
+    uint32 count;
+    uint32 member_size;
+    uint32 task_count;
+    enum ComparisonResult (*compare)(uint8*, uint8*);
+} ParallelSort;
+
+
+// Sort one chunk in place. The matching part of the destination
+// buffer is free at this point and serves as merge scratch.
+static void parallel_sort_chunk(void *argument, uint32 index)
+{
+    ParallelSort *sort = argument;
+    uint32 start = sort->runs[index];
+    uint64 offset = (uint64)start * sort->member_size;
+
+    merge_sort_members(
+        sort->data + offset,
+        sort->runs[index + 1] - start,
+        sort->member_size,
+        sort->compare,
+        sort->dst + offset,
+        sort->chunk_runs + (uint64)index * sort->chunk_runs_size
+    );
+}
+
+
+// Merge every pair of runs that overlaps the task's share of the output.
+// A run without a pair is merged with an empty run, which copies it.
+static void parallel_sort_merge(void *argument, uint32 index)
+{
+    ParallelSort *sort = argument;
+    const uint32 member_size = sort->member_size;
+    const uint32 first = (uint64)sort->count * index / sort->task_count;
+    const uint32 last = (uint64)sort->count * (index + 1) / sort->task_count;
+
+    for (uint32 pair = 0; pair < sort->run_count; pair += 2)
+    {
+        uint32 start = sort->runs[pair];
+        uint32 mid = sort->runs[min(pair + 1, sort->run_count)];
+        uint32 end = sort->runs[min(pair + 2, sort->run_count)];
+        if (end <= first || start >= last)
+            continue;
+
+        merge_range_members(
+            sort->src + (uint64)start * member_size, mid - start,
+            sort->src + (uint64)mid * member_size, end - mid,
+            sort->dst + (uint64)start * member_size,
+            max(first, start) - start,
+            min(last, end) - start,
+            member_size,
+            sort->compare
+        );
+    }
+}
+
+
+static void parallel_sort_copy(void *argument, uint32 index)
+{
+    ParallelSort *sort = argument;
+    const uint64 first = (uint64)sort->count * index / sort->task_count * sort->member_size;
+    const uint64 last = (uint64)sort->count * (index + 1) / sort->task_count * sort->member_size;
+    memory_copy(sort->src + first, sort->data + first, last - first);
+}
+
+
+int array_sort_parallel(Array *array, AllocatorInterface *allocator, WorkerPool *pool, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    if (array == NULL || allocator == NULL || compare == NULL)
+        return 1;
+
+    const uint32 count = array->member_count;
+    const uint32 member_size = array->member_size;
+    if (count < 2 || member_size == 0)
+        return 0;
+
+    uint32 task_count = 1;
+    if (pool != NULL && pool->run != NULL)
+        task_count = min(pool->worker_count, count / SORT_PARALLEL_MIN_TASK_SIZE);
+
+    if (task_count < 2)
+        return array_sort_stable(array, allocator, compare);
+
+    ParallelSort sort;
+    sort.count = count;
+    sort.member_size = member_size;
+    sort.task_count = task_count;
+    sort.run_count = task_count;
+    sort.compare = compare;
+    sort.chunk_runs_size = (count / task_count + 1) / SORT_MIN_RUN + 2;
+
+    const uint64 runs_size = round_up(((uint64)task_count + 1 + (uint64)task_count * sort.chunk_runs_size) * sizeof(uint32), 16);
+    const uint64 scratch_size = runs_size + (uint64)count * member_size;
+    sort.runs = allocator_memory_allocate(allocator, scratch_size);
+    if (sort.runs == NULL)
+        return 1;
+
+    sort.chunk_runs = sort.runs + task_count + 1;
+    sort.data = array->data;
+    sort.src = array->data;
+    sort.dst = (uint8*)sort.runs + runs_size;
+    for (uint32 i = 0; i <= task_count; i++)
+        sort.runs[i] = (uint64)count * i / task_count;
+
+    pool->run(pool->context, parallel_sort_chunk, &sort, task_count);
+
+    while (sort.run_count > 1)
+    {
+        pool->run(pool->context, parallel_sort_merge, &sort, task_count);
+
+        uint32 merged = 0;
+        for (uint32 i = 0; i < sort.run_count; i += 2)
+            sort.runs[merged++] = sort.runs[i];
+
+        sort.runs[merged] = count;
+        sort.run_count = merged;
+
+        uint8 *sorted = sort.dst;
+        sort.dst = sort.src;
+        sort.src = sorted;
+    }
+
+    if (sort.src != array->data)
+        pool->run(pool->context, parallel_sort_copy, &sort, task_count);
+
+    allocator_memory_free(allocator, sort.runs, scratch_size);
+    return 0;
+}
+
+
+uint32 array_lower_bound(Array *array, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    if (array == NULL || key == NULL || compare == NULL)
+        return 0;
+
+    uint32 low = 0;
+    uint32 high = array->member_count;
+    while (low < high)
+    {
+        uint32 mid = low + (high - low) / 2;
+        if (compare(array->data + (uint64)mid * array->member_size, key) == COMPARISON_RESULT_FIRST_IS_SMALLER)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+
+uint32 array_upper_bound(Array *array, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    if (array == NULL || key == NULL || compare == NULL)
+        return 0;
+
+    uint32 low = 0;
+    uint32 high = array->member_count;
+    while (low < high)
+    {
+        uint32 mid = low + (high - low) / 2;
+        if (compare(array->data + (uint64)mid * array->member_size, key) != COMPARISON_RESULT_FIRST_IS_LARGER)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+
+// Lower bound without a data dependent branch: the range is halved on every
+// step and the comparison only selects which half to keep, which compiles to
+// a conditional move once the comparator is inlined. Both possible next
+// midpoints are prefetched while the current one is compared.
+SORT_INLINE uint64 lower_bound_branchless(uint8 *base, uint64 count, uint8 *key, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    uint8 *first = base;
+    while (count > 1)
+    {
+        uint64 half = count / 2;
+        __builtin_prefetch(first + (half / 2) * member_size);
+        __builtin_prefetch(first + (half + half / 2) * member_size);
+        first = compare(first + half * member_size, key) == COMPARISON_RESULT_FIRST_IS_SMALLER ? first + half * member_size : first;
+        count -= half;
+    }
+    return (uint64)(first - base) / member_size + (compare(first, key) == COMPARISON_RESULT_FIRST_IS_SMALLER);
+}
+
+
+// The 16 descendants of node k four levels down are stored next to each
+// other from index 16 * k - 1, prefetching them hides the memory latency of
+// the next iterations. At most 4 cache lines are prefetched per step.
+#define EYTZINGER_PREFETCH_DISTANCE 16
+#define EYTZINGER_MAX_PREFETCH_SIZE (4 * PLATFORM_CACHE_LINE_SIZE)
+
+// Nodes are 1-based, node k is stored at index k - 1 and its children are
+// the nodes 2k and 2k + 1. Returns the node of the lower bound or 0.
+SORT_INLINE uint64 eytzinger_lower_bound(uint8 *base, uint64 count, uint8 *key, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    const uint64 prefetch_size = min((uint64)EYTZINGER_PREFETCH_DISTANCE * member_size, EYTZINGER_MAX_PREFETCH_SIZE);
+    uint64 k = 1;
+    while (k <= count)
+    {
+        uint8 *descendants = base + (EYTZINGER_PREFETCH_DISTANCE * k - 1) * member_size;
+        for (uint64 offset = 0; offset < prefetch_size; offset += PLATFORM_CACHE_LINE_SIZE)
+            __builtin_prefetch(descendants + offset);
+        k = 2 * k + (compare(base + (k - 1) * member_size, key) == COMPARISON_RESULT_FIRST_IS_SMALLER);
+    }
+
+    // The path turned right after the lower bound and left ever since,
+    // dropping the trailing ones and the zero before them gives its node.
+    return k >> __builtin_ffsl((int64)~k);
+}
+
+
+#define SEARCH_KERNELS(suffix, size, comparator)                                                                                       \
+    static uint64 lower_bound_##suffix(uint8 *base, uint64 count, uint8 *key, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*)) \
+    {                                                                                                                                  \
+        (void)member_size;                                                                                                             \
+        (void)compare;                                                                                                                 \
+        return lower_bound_branchless(base, count, key, size, comparator);                                                             \
+    }                                                                                                                                  \
+                                                                                                                                       \
+    static uint64 eytzinger_lower_bound_##suffix(uint8 *base, uint64 count, uint8 *key, uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*)) \
+    {                                                                                                                                  \
+        (void)member_size;                                                                                                             \
+        (void)compare;                                                                                                                 \
+        return eytzinger_lower_bound(base, count, key, size, comparator);                                                              \
+    }
+
+SEARCH_KERNELS(int32, 4, compare_int32)
+SEARCH_KERNELS(uint32, 4, compare_uint32)
+SEARCH_KERNELS(float32, 4, compare_float32)
+SEARCH_KERNELS(int64, 8, compare_int64)
+SEARCH_KERNELS(uint64, 8, compare_uint64)
+SEARCH_KERNELS(float64, 8, compare_float64)
+SEARCH_KERNELS(generic, member_size, compare)
+
+#undef SEARCH_KERNELS
+
+
+typedef uint64 (*SearchKernel)(uint8*, uint64, uint8*, uint32, enum ComparisonResult (*)(uint8*, uint8*));
+
+static const SearchKernel LOWER_BOUND_KERNELS[] = {
+    lower_bound_generic,
+    lower_bound_int32, lower_bound_uint32, lower_bound_float32,
+    lower_bound_int64, lower_bound_uint64, lower_bound_float64
+};
+
+static const SearchKernel EYTZINGER_LOWER_BOUND_KERNELS[] = {
+    eytzinger_lower_bound_generic,
+    eytzinger_lower_bound_int32, eytzinger_lower_bound_uint32, eytzinger_lower_bound_float32,
+    eytzinger_lower_bound_int64, eytzinger_lower_bound_uint64, eytzinger_lower_bound_float64
+};
+
+
+// Index of the search kernels for the member size and comparator,
+// the built-in comparators get kernels where they are inlined.
+static uint32 search_kernel_index(uint32 member_size, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    enum ComparisonResult (*const comparators[])(uint8*, uint8*) = {
+        NULL,
+        compare_int32, compare_uint32, compare_float32,
+        compare_int64, compare_uint64, compare_float64
+    };
+
+    for (uint32 i = 1; i < sizeof(comparators) / sizeof(comparators[0]); i++)
+        if (compare == comparators[i])
+            return member_size == (i <= 3 ? 4 : 8) ? i : 0;
+    return 0;
+}
+
+
+uint32 array_lower_bound_branchless(Array *array, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    if (array == NULL || key == NULL || compare == NULL || array->member_count == 0)
+        return 0;
+
+    uint32 kernel = search_kernel_index(array->member_size, compare);
+    return LOWER_BOUND_KERNELS[kernel](array->data, array->member_count, key, array->member_size, compare);
+}
+
+
+int64 array_bsearch(Array *array, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    if (array == NULL || key == NULL || compare == NULL)
+        return -1;
+
+    uint32 index = array_lower_bound_branchless(array, key, compare);
+    if (index >= array->member_count)
+        return -1;
+
+    if (compare(array->data + (uint64)index * array->member_size, key) != COMPARISON_RESULT_ARE_EQUAL)
+        return -1;
+    return index;
+}
+
+
+// Fill the subtree of node k with the in-order members from src starting at index i.
+static uint64 eytzinger_fill(uint8 *src, uint8 *dst, uint64 i, uint64 k, uint64 count, uint32 member_size)
+{
+    if (k > count)
+        return i;
+
+    i = eytzinger_fill(src, dst, i, 2 * k, count, member_size);
+    sort_move(dst + (k - 1) * member_size, src + i * member_size, member_size);
+    return eytzinger_fill(src, dst, i + 1, 2 * k + 1, count, member_size);
+}
+
+
+Array* array_to_eytzinger(Array *array, AllocatorInterface *allocator)
+{
+    if (array == NULL || allocator == NULL)
+        return NULL;
+
+    Array *eytzinger = array_new_no_init(allocator, array->member_count, array->member_size);
+    if (eytzinger == NULL)
+        return NULL;
+
+    eytzinger_fill(array->data, eytzinger->data, 0, 1, array->member_count, array->member_size);
+    return eytzinger;
+}
+
+
+int64 array_eytzinger_lower_bound(Array *eytzinger, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    if (eytzinger == NULL || key == NULL || compare == NULL)
+        return -1;
+
+    uint32 kernel = search_kernel_index(eytzinger->member_size, compare);
+    uint64 node = EYTZINGER_LOWER_BOUND_KERNELS[kernel](eytzinger->data, eytzinger->member_count, key, eytzinger->member_size, compare);
+    return (int64)node - 1;
+}
+
+
+int64 array_eytzinger_search(Array *eytzinger, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    int64 index = array_eytzinger_lower_bound(eytzinger, key, compare);
+    if (index < 0)
+        return -1;
+
+    if (compare(eytzinger->data + (uint64)index * eytzinger->member_size, key) != COMPARISON_RESULT_ARE_EQUAL)
+        return -1;
+    return index;
+}
+
+
+Array* array_map(Array *array, AllocatorInterface *allocator, void (*func)(uint8*))
+{
+    if (array == NULL || allocator == NULL || func == NULL)
+        return NULL;
+
+    Array *new_array = array_new_no_init(allocator, array->member_count, array->member_size);
+    if (new_array == NULL)
+        return NULL;
+
+    memory_copy(array->data, new_array->data, (uint64)array->member_count * array->member_size);
+    array_foreach(new_array, func);
+    return new_array;
+}
+
+
+Array* array_filter(Array *array, AllocatorInterface *allocator, int (*func)(uint8*))
+{
+    if (array == NULL || allocator == NULL || func == NULL)
+        return NULL;
+
+    uint64 src_offset;
+    uint64 dest_offset;
+    uint32 passed_items = 0;
+    uint32 index = 0;
+
+    for (uint32 i = 0; i < array->member_count; i++)
+    {
+        src_offset = i * array->member_size;
+        if (func((uint8*)&array->data[src_offset]))
+            passed_items++;
+    }
+
+    Array *new_array = array_new(allocator, passed_items, array->member_size);
+    if (new_array == NULL)
+        return NULL;
+
+    for (uint32 i = 0; i < array->member_count; i++)
+    {
+        src_offset = i * array->member_size;
+        if (func((uint8*)&array->data[src_offset]))
+        {
+            dest_offset = index++ * array->member_size;
+            memory_copy(&array->data[src_offset], &new_array->data[dest_offset], array->member_size);
+        }
+    }
+    return new_array;
+}
+
+
+Array* array_reverse(Array *array, AllocatorInterface *allocator)
+{
+    if (array == NULL || allocator == NULL)
+        return NULL;
+
+    Array *new_array = array_new(allocator, array->member_count, array->member_size);
+    if (new_array == NULL)
+        return NULL;
+
+    uint32 start_offset, end_offset;
+    for (int64 i = array->member_count - 1; i > -1; i--)
+    {
+        start_offset = (array->member_count - i - 1) * array->member_size;
+        end_offset = i * array->member_size;
+        memory_copy(&array->data[end_offset], &new_array->data[start_offset], array->member_size);
+    }
+    return new_array;
+}
+
+
+void array_byteswap(Array *array)
+{
+    if (array == NULL)
+        return;
+
+    const uint32 member_size = array->member_size;
+    switch (member_size)
+    {
+        case 2:
+        case 4:
+        case 8:
+        case 16:
+            memory_byteswap_kernel(array->data, array->member_count, member_size);
+            break;
+
+        default:
+            for (uint32 i = 0; i < array->member_count; i++)
+                switch_endianess(&array->data[(uint64)i * member_size], member_size);
+            break;
+    }
+}
+
+
+int64 array_find_index(Array *array, uint32 start_index, int (*func)(uint8*))
+{
+    if (array == NULL || func == NULL)
+        return -2;
+
+    if (start_index >= array->member_count)
+        return -3;
+
+    uint64 offset;
+    for (uint32 index = start_index; index < array->member_count; index++)
+    {
+        offset = index * array->member_size;
+        if (func((uint8*)&array->data[offset]))
+            return index;
+    }
+    return -1;
+}
+
+
+void array_find_item(Array *array, uint32 start_index, int (*func)(uint8*), uint8 *memory)
+{
+    if (array == NULL || func == NULL || memory == NULL)
+        return;
+
+    if (start_index >= array->member_count)
+        return;
+
+    uint64 offset;
+    for (uint32 index = start_index; index < array->member_count; index++)
+    {
+        offset = index * array->member_size;
+        if (func((uint8*)&array->data[offset]))
+        {
+            memory_copy(&array->data[offset], memory, array->member_size);
+            return;
+        }
+    }
+}
+
+
+void array_reduce(Array *array, void (*func)(uint8*, uint8*, uint8*), uint8 *result)
+{
+    if (array == NULL || func == NULL || result == NULL)
+        return;
+
+    uint8 *current_value = NULL;
+    uint8 *previous_value = NULL;
+    uint64 offset;
+
+    for (uint32 index = 0; index < array->member_count; index++)
+    {
+        offset = index * array->member_size;
+        current_value = (uint8*)&array->data[offset];
+
+        if (previous_value == NULL)
+            previous_value = result;
+
+        func(previous_value, current_value, result);
+        previous_value = current_value;
+    }
+}
+
+
+void array_foreach_ctx(Array *array, void (*func)(uint8*, void*), void *ctx)
+{
+    if (array == NULL || func == NULL)
+        return;
+
+    const uint64 size = (uint64)array->member_count * array->member_size;
+    for (uint64 i = 0; i < size; i += array->member_size)
+        func(&array->data[i], ctx);
+}
+
+
+Array* array_map_ctx(Array *array, AllocatorInterface *allocator, void (*func)(uint8*, void*), void *ctx)
+{
+    if (array == NULL || allocator == NULL || func == NULL)
+        return NULL;
+
+    Array *new_array = array_new_no_init(allocator, array->member_count, array->member_size);
+    if (new_array == NULL)
+        return NULL;
+
+    memory_copy(array->data, new_array->data, (uint64)array->member_count * array->member_size);
+    array_foreach_ctx(new_array, func, ctx);
+    return new_array;
+}
+
+
+// Give back the unused tail of an array made for the worst case of a filter.
+static Array* array_shrink_filtered(Array *array, AllocatorInterface *allocator, uint32 member_count)
+{
+    const uint64 size = ARRAY_DATA_OFFSET + (uint64)array->member_count * array->member_size;
+    if (member_count == 0)
+    {
+        allocator_memory_free(allocator, array, size);
+        return NULL;
+    }
+
+    if (member_count < array->member_count)
+    {
+        Array *shrunk = allocator_memory_resize(allocator, array, size, ARRAY_DATA_OFFSET + (uint64)member_count * array->member_size);
+        if (shrunk == NULL)
+        {
+            allocator_memory_free(allocator, array, size);
+            return NULL;
+        }
+        array = shrunk;
+    }
+    array->member_count = member_count;
+    return array;
+}
+
+
+Array* array_filter_ctx(Array *array, AllocatorInterface *allocator, int (*func)(uint8*, void*), void *ctx)
+{
+    if (array == NULL || allocator == NULL || func == NULL)
+        return NULL;
+
+    Array *new_array = array_new_no_init(allocator, array->member_count, array->member_size);
+    if (new_array == NULL)
+        return NULL;
+
+    const uint32 member_size = array->member_size;
+    uint32 passed_items = 0;
+    for (uint32 i = 0; i < array->member_count; i++)
+    {
+        uint8 *member = &array->data[(uint64)i * member_size];
+        if (func(member, ctx))
+            memory_copy(member, &new_array->data[(uint64)passed_items++ * member_size], member_size);
+    }
+    return array_shrink_filtered(new_array, allocator, passed_items);
+}
+
+
+void array_reduce_ctx(Array *array, void (*func)(uint8*, uint8*, uint8*, void*), uint8 *result, void *ctx)
+{
+    if (array == NULL || func == NULL || result == NULL)
+        return;
+
+    uint8 *previous_value = result;
+    for (uint32 index = 0; index < array->member_count; index++)
+    {
+        uint8 *current_value = &array->data[(uint64)index * array->member_size];
+        func(previous_value, current_value, result, ctx);
+        previous_value = current_value;
+    }
+}
+
+
+int64 array_find_index_ctx(Array *array, uint32 start_index, int (*func)(uint8*, void*), void *ctx)
+{
+    if (array == NULL || func == NULL)
+        return -2;
+
+    if (start_index >= array->member_count)
+        return -3;
+
+    for (uint32 index = start_index; index < array->member_count; index++)
+        if (func(&array->data[(uint64)index * array->member_size], ctx))
+            return index;
+    return -1;
+}
+
+
+// Number of members in the blocks given to the _chunked callbacks.
+static inline uint32 array_chunk_members(uint32 member_size)
+{
+    return member_size >= ARRAY_CHUNK_SIZE ? 1 : ARRAY_CHUNK_SIZE / member_size;
+}
+
+
+void array_foreach_chunked(Array *array, void (*func)(uint8*, uint32, uint32, void*), void *ctx)
+{
+    if (array == NULL || func == NULL || array->member_size == 0)
+        return;
+
+    const uint32 member_size = array->member_size;
+    const uint32 chunk = array_chunk_members(member_size);
+    for (uint32 i = 0; i < array->member_count; i += chunk)
+        func(&array->data[(uint64)i * member_size], min(chunk, array->member_count - i), member_size, ctx);
+}
+
+
+Array* array_map_chunked(Array *array, AllocatorInterface *allocator, void (*func)(uint8*, uint32, uint32, void*), void *ctx)
+{
+    if (array == NULL || allocator == NULL || func == NULL)
+        return NULL;
+
+    Array *new_array = array_new_no_init(allocator, array->member_count, array->member_size);
+    if (new_array == NULL)
+        return NULL;
+
+    // Each block is transformed right after it is copied, while it is still in cache.
+    const uint32 member_size = array->member_size;
+    const uint32 chunk = array_chunk_members(member_size);
+    for (uint32 i = 0; i < array->member_count; i += chunk)
+    {
+        const uint32 count = min(chunk, array->member_count - i);
+        const uint64 offset = (uint64)i * member_size;
+        memory_copy(&array->data[offset], &new_array->data[offset], (uint64)count * member_size);
+        func(&new_array->data[offset], count, member_size, ctx);
+    }
+    return new_array;
+}
+
+
+Array* array_filter_chunked(Array *array, AllocatorInterface *allocator, uint32 (*func)(uint8*, uint32, uint32, void*), void *ctx)
+{
+    if (array == NULL || allocator == NULL || func == NULL)
+        return NULL;
+
+    Array *new_array = array_new_no_init(allocator, array->member_count, array->member_size);
+    if (new_array == NULL)
+        return NULL;
+
+    // Every block is copied right after the members kept so far
+    // and the callback compacts it in place.
+    const uint32 member_size = array->member_size;
+    const uint32 chunk = array_chunk_members(member_size);
+    uint32 passed_items = 0;
+    for (uint32 i = 0; i < array->member_count; i += chunk)
+    {
+        const uint32 count = min(chunk, array->member_count - i);
+        uint8 *block = &new_array->data[(uint64)passed_items * member_size];
+        memory_copy(&array->data[(uint64)i * member_size], block, (uint64)count * member_size);
+
+        uint32 kept = func(block, count, member_size, ctx);
+        passed_items += min(kept, count);
+    }
+    return array_shrink_filtered(new_array, allocator, passed_items);
+}
+
+
+inline void array_reduce_chunked(Array *array, void (*func)(uint8*, uint32, uint32, void*), void *result)
+{
+    array_foreach_chunked(array, func, result);
+}
+
+
+int64 array_find_index_chunked(Array *array, uint32 start_index, int64 (*func)(uint8*, uint32, uint32, void*), void *ctx)
+{
+    if (array == NULL || func == NULL)
+        return -2;
+
+    if (start_index >= array->member_count)
+        return -3;
+
+    const uint32 member_size = array->member_size;
+    const uint32 chunk = array_chunk_members(member_size);
+    for (uint32 i = start_index; i < array->member_count; i += chunk)
+    {
+        const uint32 count = min(chunk, array->member_count - i);
+        int64 index = func(&array->data[(uint64)i * member_size], count, member_size, ctx);
+        if (index >= 0 && index < count)
+            return i + index;
+    }
+    return -1;
+}
+
+
+void array_destroy(Array *array, AllocatorInterface *allocator)
+{
+    if (allocator == NULL || array == NULL)
+        return;
+    allocator_memory_free(allocator, array, ARRAY_DATA_OFFSET + ((uint64)array->member_size * array->member_count));
+}
+
+
+static inline uint64 list_get_allocated_buffer_size(List *list)
+{
+    return list->_allocated_space - LIST_DATA_OFFSET;
+}
+
+
+List* list_new(AllocatorInterface *allocator, uint32 max_members, uint32 member_size)
+{
+    if (allocator == NULL)
+        return NULL;
+
+    if (max_members == 0 || member_size == 0)
+        return NULL;
+
+    uint64 buffer_size = max_members * member_size;
+    uint64 required_space = LIST_DATA_OFFSET + buffer_size;
+
+    List *list = (List*) allocator_memory_allocate(allocator, required_space);
+    if (list == NULL)
+        return NULL;
+
+    list->_allocated_space = required_space;
+    list->member_count = 0;
+    list->member_size = member_size;
+
+    return list;
+}
+
+
+inline void list_get(List *list, uint32 index, uint8 *memory)
+{
+    array_get(list_to_array(list), index, memory);
+}
+
+
+void list_insert_range(List *list, uint32 index, uint8 *memory, uint32 count)
+{
+    if (list == NULL || memory == NULL)
+        return;
+
+    if (index > list->member_count)
+        index = list->member_count;
+
+    uint64 used_space = (uint64)list->member_count * list->member_size;
+    uint64 buffer_size = list_get_allocated_buffer_size(list);
+    uint64 insert_size = (uint64)count * list->member_size;
+
+    if (buffer_size - used_space < insert_size)
+        return;
+
+    uint64 offset = (uint64)index * list->member_size;
+    memory_move(&list->data[offset], &list->data[offset + insert_size], used_space - offset);
+    memory_copy(memory, &list->data[offset], insert_size);
+    list->member_count += count;
+}
+
+
+inline void list_insert(List *list, uint32 index, uint8 *memory)
+{
+    list_insert_range(list, index, memory, 1);
+}
+
+
+inline void list_set(List *list, uint32 index, uint8 *memory)
+{
+    array_set(list_to_array(list), index, memory);
+}
+
+
+inline void list_append(List* list, uint8 *memory)
+{
+    list_insert(list, list->member_count, memory);
+}
+
+
+void list_remove_range(List *list, uint32 index, uint32 count)
+{
+    if (list == NULL)
+        return;
+
+    if (index >= list->member_count)
+        return;
+
+    count = min(count, list->member_count - index);
+
+    uint64 offset = (uint64)index * list->member_size;
+    uint64 removed_size = (uint64)count * list->member_size;
+    uint64 used_space = (uint64)list->member_count * list->member_size;
+
+    memory_copy(&list->data[offset + removed_size], &list->data[offset], used_space - offset - removed_size);
+    list->member_count -= count;
+}
+
+
+inline void list_remove_at(List *list, uint32 index)
+{
+    list_remove_range(list, index, 1);
+}
+
+
+void list_copy_memory(List *list, uint8 *memory, uint32 user_buffer_max_size)
+{
+    if (list == NULL || memory == NULL)
+        return;
+
+    uint64 buffer_size = list_get_allocated_buffer_size(list);
+    uint64 max_size = user_buffer_max_size > buffer_size ? buffer_size : user_buffer_max_size;
+
+    list->member_count = max_size / list->member_size;
+    array_copy_memory(list_to_array(list), memory, max_size);
+}
+
+
+List* list_resize(List *list, AllocatorInterface *allocator, uint32 max_members)
+{
+    if (list == NULL || allocator == NULL)
+        return list;
+
+    List *new_list;
+    uint32 new_member_count = min(list->member_count, max_members);
+    uint64 new_buffer_size = max_members * list->member_size;
+    uint64 new_size = new_buffer_size + LIST_DATA_OFFSET;
+
+    // Assume the allocator is implemented correctly
+    // and memory is copied into new memory block...
+    new_list = allocator_memory_resize(allocator, list, list->_allocated_space, new_size);
+    if (new_list == NULL)
+        return list;
+
+    new_list->_allocated_space = new_size;
+    new_list->member_count = new_member_count;
+    return new_list;
+}
+
+
+inline Array* list_create_slice(List *list, AllocatorInterface* allocator, uint32 start, uint32 end)
+{
+    return array_create_slice(list_to_array(list), allocator, start, end);
+}
+
+
+inline void list_foreach(List *list, void (*func)(uint8*))
+{
+    array_foreach(list_to_array(list), func);
+}
+
+
+inline void list_sort(List *list, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    array_sort(list_to_array(list), compare);
+}
+
+inline int list_sort_radix(List *list, AllocatorInterface *allocator, RadixKey key)
+{
+    return array_sort_radix(list_to_array(list), allocator, key);
+}
+
+inline int list_sort_stable(List *list, AllocatorInterface *allocator, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    return array_sort_stable(list_to_array(list), allocator, compare);
+}
+
+inline int list_sort_parallel(List *list, AllocatorInterface *allocator, WorkerPool *pool, enum ComparisonResult (*compare)(uint8*, uint8*))
+{
+    return array_sort_parallel(list_to_array(list), allocator, pool, compare);
+}
+
+inline Array* list_map(List *list, AllocatorInterface *allocator, void (*func)(uint8*))
+{
+    return array_map(list_to_array(list), allocator, func);
+}
+
+
+inline Array* list_filter(List *list, AllocatorInterface *allocator, int (*func)(uint8*))
+{
+    return array_filter(list_to_array(list), allocator, func);
+}
+
+
+inline Array* list_reverse(List *list, AllocatorInterface *allocator)
+{
+    return array_reverse(list_to_array(list), allocator);
+}
+
+
+inline void list_byteswap(List *list)
+{
+    array_byteswap(list_to_array(list));
+}
+
+
+inline int64 list_find_index(List *list, uint32 start_index, int (*func)(uint8*))
+{
+    return array_find_index(list_to_array(list), start_index, func);
+}
+
+
+inline void list_find_item(List *list, uint32 start_index, int (*func)(uint8*), uint8 *memory)
+{
+    array_find_item(list_to_array(list), start_index, func, memory);
+}
+
+
+inline void list_reduce(List *list, void (*func)(uint8*, uint8*, uint8*), uint8 *result)
+{
+    array_reduce(list_to_array(list), func, result);
+}
+
+
+inline void list_foreach_ctx(List *list, void (*func)(uint8*, void*), void *ctx)
+{
+    array_foreach_ctx(list_to_array(list), func, ctx);
+}
+
+
+inline Array* list_map_ctx(List *list, AllocatorInterface *allocator, void (*func)(uint8*, void*), void *ctx)
+{
+    return array_map_ctx(list_to_array(list), allocator, func, ctx);
+}
+
+
+inline Array* list_filter_ctx(List *list, AllocatorInterface *allocator, int (*func)(uint8*, void*), void *ctx)
+{
+    return array_filter_ctx(list_to_array(list), allocator, func, ctx);
+}
+
+
+inline void list_reduce_ctx(List *list, void (*func)(uint8*, uint8*, uint8*, void*), uint8 *result, void *ctx)
+{
+    array_reduce_ctx(list_to_array(list), func, result, ctx);
+}
+
+
+inline int64 list_find_index_ctx(List *list, uint32 start_index, int (*func)(uint8*, void*), void *ctx)
+{
+    return array_find_index_ctx(list_to_array(list), start_index, func, ctx);
+}
+
+
+inline void list_foreach_chunked(List *list, void (*func)(uint8*, uint32, uint32, void*), void *ctx)
+{
+    array_foreach_chunked(list_to_array(list), func, ctx);
+}
+
+
+inline Array* list_map_chunked(List *list, AllocatorInterface *allocator, void (*func)(uint8*, uint32, uint32, void*), void *ctx)
+{
+    return array_map_chunked(list_to_array(list), allocator, func, ctx);
+}
+
+
+inline Array* list_filter_chunked(List *list, AllocatorInterface *allocator, uint32 (*func)(uint8*, uint32, uint32, void*), void *ctx)
+{
+    return array_filter_chunked(list_to_array(list), allocator, func, ctx);
+}
+
+
+inline void list_reduce_chunked(List *list, void (*func)(uint8*, uint32, uint32, void*), void *result)
 {
-    if (allocator == NULL || array == NULL)
-        return;
-    allocator->memory_free(array, ARRAY_DATA_OFFSET + (array->member_size * array->member_count));
+    array_reduce_chunked(list_to_array(list), func, result);
 }
 
 
-static inline uint64 list_get_allocated_buffer_size(List *list)
+inline int64 list_find_index_chunked(List *list, uint32 start_index, int64 (*func)(uint8*, uint32, uint32, void*), void *ctx)
 {
-    return list->_allocated_space - LIST_DATA_OFFSET;
+    return array_find_index_chunked(list_to_array(list), start_index, func, ctx);
 }
 
 
-List* list_new(AllocatorInterface *allocator, uint32 max_members, uint32 member_size)
+void list_destroy(List *list, AllocatorInterface *allocator)
 {
-    if (allocator == NULL)
-        return NULL;
-
-    if (max_members == 0 || member_size == 0)
-        return NULL;
+    if (list == NULL || allocator == NULL)
+        return;
 
-    uint64 buffer_size = max_members * member_size;
-    uint64 required_space = LIST_DATA_OFFSET + buffer_size;
+    allocator_memory_free(allocator, list, list->_allocated_space);
+}
 
-    List *list = (List*) allocator->memory_allocate(required_space);
-    if (list == NULL)
-        return NULL;
 
-    list->_allocated_space = required_space;
-    list->member_count = 0;
-    list->member_size = member_size;
+void pipeline_init(Pipeline *pipeline, Array *array)
+{
+    if (pipeline == NULL)
+        return;
 
-    return list;
+    pipeline->data = array != NULL ? array->data : NULL;
+    pipeline->member_count = array != NULL ? array->member_count : 0;
+    pipeline->member_size = array != NULL ? array->member_size : 0;
+    pipeline->stage_count = 0;
+    pipeline->invalid = 0;
 }
 
 
-inline void list_get(List *list, uint32 index, uint8 *memory)
+inline void pipeline_init_list(Pipeline *pipeline, List *list)
 {
-    array_get(list_to_array(list), index, memory);
+    pipeline_init(pipeline, list != NULL ? list_to_array(list) : NULL);
 }
 
 
-void list_insert(List *list, uint32 index, uint8 *memory)
+inline uint32 pipeline_member_size(Pipeline *pipeline)
 {
-    if (list == NULL || memory == NULL)
-        return;
-
-    if (index > list->member_count)
-        index = list->member_count;
+    if (pipeline == NULL)
+        return 0;
 
-    uint64 used_space = list->member_count * list->member_size;
-    uint64 buffer_size = list_get_allocated_buffer_size(list);
+    if (pipeline->stage_count == 0)
+        return pipeline->member_size;
+    return pipeline->stages[pipeline->stage_count - 1].member_size;
+}
 
-    if (buffer_size - used_space < list->member_size) {
-        return;
-    }
 
-    list->member_count += 1;
+static PipelineStage* pipeline_add_stage(Pipeline *pipeline, uint32 type, uint32 member_size)
+{
+    if (pipeline == NULL)
+        return NULL;
 
-    if (index < list->member_count - 1)
+    if (pipeline->stage_count >= PIPELINE_MAX_STAGES)
     {
-        for (int64 i = list->member_count - 2; i >= index; i--)
-        {
-            for (uint32 j = 0; j < list->member_size; j++)
-            {
-                uint32 offset = i * list->member_size;
-                list->data[offset + list->member_size + j] = list->data[offset + j];
-            }
-        }
+        pipeline->invalid = 1;
+        return NULL;
     }
 
-    uint32 offset = index * list->member_size;
-    for (uint32 i = 0; i < list->member_size; i++)
-        list->data[offset + i] = memory[i];
+    PipelineStage *stage = &pipeline->stages[pipeline->stage_count++];
+    stage->type = type;
+    stage->member_size = member_size;
+    stage->count = 0;
+    stage->ctx = NULL;
+    stage->filter = NULL;
+    stage->map = NULL;
+    return stage;
 }
 
 
-inline void list_set(List *list, uint32 index, uint8 *memory)
+void pipeline_filter(Pipeline *pipeline, int (*func)(uint8*, void*), void *ctx)
 {
-    array_set(list_to_array(list), index, memory);
-}
+    if (pipeline == NULL)
+        return;
 
+    PipelineStage *stage = pipeline_add_stage(pipeline, PIPELINE_STAGE_FILTER, pipeline_member_size(pipeline));
+    if (stage == NULL)
+        return;
 
-inline void list_append(List* list, uint8 *memory)
-{
-    list_insert(list, list->member_count, memory);
+    stage->filter = func;
+    stage->ctx = ctx;
+    pipeline->invalid |= func == NULL;
 }
 
 
-
-void list_remove_at(List *list, uint32 index)
+void pipeline_map(Pipeline *pipeline, uint32 member_size, void (*func)(uint8*, uint8*, void*), void *ctx)
 {
-    if (list == NULL)
+    if (pipeline == NULL)
         return;
 
-    if (index > list->member_count - 1)
+    PipelineStage *stage = pipeline_add_stage(pipeline, PIPELINE_STAGE_MAP, member_size);
+    if (stage == NULL)
         return;
 
-    for (uint32 i = index + 1; i < list->member_count; i++)
-    {
-        for (uint32 j = 0; j < list->member_size; j++)
-        {
-            uint64 offset = i * list->member_size;
-            list->data[offset - list->member_size + j] = list->data[offset + j];
-        }
-    }
-    list->member_count -= 1;
+    stage->map = func;
+    stage->ctx = ctx;
+    pipeline->invalid |= func == NULL || member_size == 0 || member_size > PIPELINE_MAX_MEMBER_SIZE;
 }
 
 
-void list_copy_memory(List *list, uint8 *memory, uint32 user_buffer_max_size)
+void pipeline_take(Pipeline *pipeline, uint32 count)
 {
-    if (list == NULL || memory == NULL)
+    if (pipeline == NULL)
         return;
 
-    uint64 buffer_size = list_get_allocated_buffer_size(list);
-    uint64 max_size = user_buffer_max_size > buffer_size ? buffer_size : user_buffer_max_size;
+    PipelineStage *stage = pipeline_add_stage(pipeline, PIPELINE_STAGE_TAKE, pipeline_member_size(pipeline));
+    if (stage != NULL)
+        stage->count = count;
+}
 
-    list->member_count = max_size / list->member_size;
-    array_copy_memory(list_to_array(list), memory, max_size);
+
+void pipeline_skip(Pipeline *pipeline, uint32 count)
+{
+    if (pipeline == NULL)
+        return;
+
+    PipelineStage *stage = pipeline_add_stage(pipeline, PIPELINE_STAGE_SKIP, pipeline_member_size(pipeline));
+    if (stage != NULL)
+        stage->count = count;
 }
 
 
-List* list_resize(List *list, AllocatorInterface *allocator, uint32 max_members)
+// Run the source members through the stages one at a time and hand every
+// member that comes out to emit, which returns 0 to stop the run. Mapped
+// members alternate between two local buffers, so a map always reads the
+// previous output while writing the other buffer.
+static int64 pipeline_run(Pipeline *pipeline, int (*emit)(uint8*, void*), void *state)
 {
-    if (list == NULL || allocator == NULL)
-        return list;
+    if (pipeline == NULL || pipeline->invalid)
+        return -1;
 
-    List *new_list;
-    uint32 new_member_count = min(list->member_count, max_members);
-    uint64 new_buffer_size = max_members * list->member_size;
-    uint64 new_size = new_buffer_size + LIST_DATA_OFFSET;
+    uint8 buffers[2][PIPELINE_MAX_MEMBER_SIZE] __attribute__((aligned(16)));
+    uint64 passed[PIPELINE_MAX_STAGES] = { 0 };
+    const uint32 stage_count = pipeline->stage_count;
+    int64 produced = 0;
+    int done = 0;
 
-    // Assume the allocator is implemented correctly
-    // and memory is copied into new memory block...
-    new_list = allocator->memory_resize(list, new_size);
-    if (new_list == NULL)
-        return list;
+    for (uint32 i = 0; i < pipeline->member_count && !done; i++)
+    {
+        uint8 *member = &pipeline->data[(uint64)i * pipeline->member_size];
+        uint32 buffer = 0;
+        uint32 s = 0;
 
-    new_list->_allocated_space = new_size;
-    new_list->member_count = new_member_count;
-    return new_list;
+        for (; s < stage_count; s++)
+        {
+            PipelineStage *stage = &pipeline->stages[s];
+            if (stage->type == PIPELINE_STAGE_FILTER)
+            {
+                if (!stage->filter(member, stage->ctx))
+                    break;
+            }
+            else if (stage->type == PIPELINE_STAGE_MAP)
+            {
+                stage->map(member, buffers[buffer], stage->ctx);
+                member = buffers[buffer];
+                buffer ^= 1;
+            }
+            else if (stage->type == PIPELINE_STAGE_SKIP)
+            {
+                if (passed[s] < stage->count)
+                {
+                    passed[s]++;
+                    break;
+                }
+            }
+            else if (stage->type == PIPELINE_STAGE_TAKE)
+            {
+                // Every later member would have to pass this stage too,
+                // so the run ends once it has let count members through.
+                if (passed[s] == stage->count)
+                {
+                    done = 1;
+                    break;
+                }
+                if (++passed[s] == stage->count)
+                    done = 1;
+            }
+        }
+
+        if (s < stage_count)
+            continue;
+
+        produced++;
+        if (!emit(member, state))
+            break;
+    }
+    return produced;
 }
 
 
-inline Array* list_create_slice(List *list, AllocatorInterface* allocator, uint32 start, uint32 end)
+typedef struct PipelineReduce
 {
-    return array_create_slice(list_to_array(list), allocator, start, end);
-}
+    void (*func)(uint8*, uint8*, void*);
+    uint8 *result;
+    void *ctx;
+} PipelineReduce;
 
 
-inline void list_foreach(List *list, void (*func)(uint8*))
+static int pipeline_emit_reduce(uint8 *member, void *state)
 {
-    array_foreach(list_to_array(list), func);
+    PipelineReduce *reduce = state;
+    reduce->func(member, reduce->result, reduce->ctx);
+    return 1;
 }
 
 
-inline void list_sort(List *list, enum ComparisonResult (*compare)(uint8*, uint8*))
+int64 pipeline_reduce(Pipeline *pipeline, void (*func)(uint8*, uint8*, void*), uint8 *result, void *ctx)
 {
-    array_sort(list_to_array(list), compare);
+    if (func == NULL || result == NULL)
+        return -1;
+
+    PipelineReduce reduce = { func, result, ctx };
+    return pipeline_run(pipeline, pipeline_emit_reduce, &reduce);
 }
 
-inline Array* list_map(List *list, AllocatorInterface *allocator, void (*func)(uint8*))
+
+typedef struct PipelineCollect
 {
-    return array_map(list_to_array(list), allocator, func);
-}
+    uint8 *target;
+    uint32 member_size;
+    uint32 remaining;
+} PipelineCollect;
 
 
-inline Array* list_filter(List *list, AllocatorInterface *allocator, int (*func)(uint8*))
+static int pipeline_emit_collect(uint8 *member, void *state)
 {
-    return array_filter(list_to_array(list), allocator, func);
+    PipelineCollect *collect = state;
+    memory_copy(member, collect->target, collect->member_size);
+    collect->target += collect->member_size;
+    return --collect->remaining > 0;
 }
 
 
-inline Array* list_reverse(List *list, AllocatorInterface *allocator)
+int64 pipeline_collect(Pipeline *pipeline, uint8 *buffer, uint32 max_members)
 {
-    return array_reverse(list_to_array(list), allocator);
+    if (pipeline == NULL || buffer == NULL)
+        return -1;
+
+    if (max_members == 0)
+        return pipeline->invalid ? -1 : 0;
+
+    PipelineCollect collect = { buffer, pipeline_member_size(pipeline), max_members };
+    return pipeline_run(pipeline, pipeline_emit_collect, &collect);
 }
 
 
-inline int64 list_find_index(List *list, uint32 start_index, int (*func)(uint8*))
+Array* pipeline_to_array(Pipeline *pipeline, AllocatorInterface *allocator)
 {
-    return array_find_index(list_to_array(list), start_index, func);
+    if (pipeline == NULL || allocator == NULL || pipeline->invalid)
+        return NULL;
+
+    // Filters only drop members, so skip and take give the upper bound.
+    uint64 max_members = pipeline->member_count;
+    for (uint32 s = 0; s < pipeline->stage_count; s++)
+    {
+        PipelineStage *stage = &pipeline->stages[s];
+        if (stage->type == PIPELINE_STAGE_SKIP)
+            max_members -= min(stage->count, max_members);
+        else if (stage->type == PIPELINE_STAGE_TAKE)
+            max_members = min(stage->count, max_members);
+    }
+
+    Array *array = array_new_no_init(allocator, max_members, pipeline_member_size(pipeline));
+    if (array == NULL)
+        return NULL;
+
+    int64 produced = pipeline_collect(pipeline, array->data, max_members);
+    return array_shrink_filtered(array, allocator, produced);
 }
 
 
-inline void list_find_item(List *list, uint32 start_index, int (*func)(uint8*), uint8 *memory)
+static const int64 EMPTY_SLOT = DICT_EMPTY_SLOT;
+static const int64 REMOVED_SLOT = DICT_REMOVED_SLOT;
+
+
+// The index table functions below are shared by Dict and Set, 'keys' is
+// the list of dict keys or set items. They probe the same sequence as the
+// typed dicts and sets, see C_UTILS_DEFINE_HASH_INDEX.
+
+// Returns the slot of the key, or -1 if it is not in the index table.
+static int64 hash_index_find_slot(Array *index_table, uint32 num_slots, List *keys, uint8 *key)
 {
-    array_find_item(list_to_array(list), start_index, func, memory);
+    int64 *slots = (int64*)index_table->data;
+    uint32 key_size = keys->member_size;
+    uint64 key_hash = dict_hash(key, key_size);
+
+    for (uint32 tries = 0; tries < num_slots; tries++)
+    {
+        uint32 slot = dict_probe_slot(key_hash, tries, num_slots);
+        int64 member = slots[slot];
+
+        if (member == EMPTY_SLOT)
+            return -1;
+
+        if (member != REMOVED_SLOT && memory_are_equal(key, &keys->data[key_size * member], key_size))
+            return slot;
+    }
+    return -1;
 }
 
 
-inline void list_reduce(List *list, void (*func)(uint8*, uint8*, uint8*), uint8 *result)
+// Point the first free slot on the key's probe sequence at member.
+// Returns 1 if the probe sequence has no free slot, 0 otherwise.
+static int hash_index_link(Array *index_table, uint32 num_slots, uint8 *key, uint32 key_size, uint32 member)
 {
-    array_reduce(list_to_array(list), func, result);
+    int64 *slots = (int64*)index_table->data;
+    uint64 key_hash = dict_hash(key, key_size);
+
+    for (uint32 tries = 0; tries < num_slots; tries++)
+    {
+        uint32 slot = dict_probe_slot(key_hash, tries, num_slots);
+        if (slots[slot] < 0)
+        {
+            slots[slot] = member;
+            return 0;
+        }
+    }
+    return 1;
 }
 
 
-void list_destroy(List *list, AllocatorInterface *allocator)
+// Point the slot of the member at index 'from' to index 'to'.
+static void hash_index_relink(Array *index_table, uint32 num_slots, List *keys, uint32 from, uint32 to)
 {
-    if (list == NULL || allocator == NULL)
-        return;
+    int64 *slots = (int64*)index_table->data;
+    uint32 key_size = keys->member_size;
+    uint64 key_hash = dict_hash(&keys->data[key_size * from], key_size);
 
-    allocator->memory_free(list, list->_allocated_space);
+    for (uint32 tries = 0; tries < num_slots; tries++)
+    {
+        uint32 slot = dict_probe_slot(key_hash, tries, num_slots);
+        if (slots[slot] == from)
+        {
+            slots[slot] = to;
+            return;
+        }
+    }
 }
 
 
-static const int64 EMPTY_SLOT = -1;
-static const int64 REMOVED_SLOT = -2;
-
-static uint64 hash(uint8 *data, uint32 length)
+static void hash_index_rehash(Array *index_table, uint32 num_slots, List *keys, uint32 member_count)
 {
-    uint64 result = 5381;
-    for (uint32 i = 0; i < length; i++)
-        result = ((result << 5) + result) + data[i];
-    return result;
+    uint32 key_size = keys->member_size;
+
+    for (uint32 i = 0; i < num_slots; i++)
+        array_set(index_table, i, (uint8*)&EMPTY_SLOT);
+
+    for (uint32 i = 0; i < member_count; i++)
+        hash_index_link(index_table, num_slots, &keys->data[key_size * i], key_size, i);
 }
 
-static inline uint32 probe_index(uint8 *key, uint32 key_length, uint32 tries, uint32 slots)
+
+// Resize the index table to max_members slots, the caller rehashes it.
+// Returns NULL if out of memory, the old index table is left untouched.
+static Array* hash_index_resize(Array *index_table, AllocatorInterface *allocator, uint32 num_slots, uint32 max_members)
 {
-    // Quadratic probing, index = (h(k) + c1 * t + c2 * t^2) % num_slots
-    const uint32 MAGIC_PRIME_1 = 7841;
-    const uint32 MAGIC_PRIME_2 = 5903;
-    return (
-        hash(key, key_length)
-        + (MAGIC_PRIME_1 * tries)
-        + (MAGIC_PRIME_2 * tries * tries)
-    ) % slots;
+    Array *new_index_table = allocator_memory_resize(allocator, index_table, ARRAY_DATA_OFFSET + (8 * (uint64)num_slots), ARRAY_DATA_OFFSET + (8 * (uint64)max_members));
+    if (new_index_table == NULL)
+        return NULL;
+
+    new_index_table->member_count = max_members;
+    return new_index_table;
 }
 
 
-static int64 dict_get_index(Dict *dict, uint8 *key)
+static inline int list_has_capacity(List *list, uint32 max_members)
 {
-    uint8 *key_value;
-    uint64 key_size = dict->keys->member_size;
-    int64 slot_value;
-    uint32 index;
-    uint32 tries = 1;
-
-    while (tries < dict->_num_slots)
-    {
-        index = probe_index(key, key_size, tries-1, dict->_num_slots);
-        array_get(dict->index_table, index, (uint8*)&slot_value);
+    return list->_allocated_space >= LIST_DATA_OFFSET + (uint64)max_members * list->member_size;
+}
 
-        if (slot_value == EMPTY_SLOT)
-            return -1;
 
-        if (slot_value != REMOVED_SLOT)
-        {
-            key_value = &dict->keys->data[key_size * slot_value];
-            if (memory_are_equal(key, key_value, key_size)) {
-                return slot_value;
-            }
-        }
-        tries++;
-    }
-    return -1;
+static int64 dict_get_index(Dict *dict, uint8 *key)
+{
+    int64 slot = hash_index_find_slot(dict->index_table, dict->_num_slots, dict->keys, key);
+    if (slot < 0)
+        return -1;
+    return ((int64*)dict->index_table->data)[slot];
 }
 
 
@@ -712,14 +5072,14 @@ Dict* dict_new(AllocatorInterface *allocator, uint32 max_members, uint32 key_siz
     if (allocator == NULL)
         return NULL;
 
-    Dict *dict = allocator->memory_allocate(sizeof(Dict));
+    Dict *dict = allocator_memory_allocate(allocator, sizeof(Dict));
     if (dict == NULL)
         return NULL;
 
     Array *index_table = array_new(allocator, max_members, 8);
     if (index_table == NULL)
     {
-        allocator->memory_free(dict, sizeof(Dict));
+        allocator_memory_free(allocator, dict, sizeof(Dict));
         return NULL;
     }
 
@@ -727,7 +5087,7 @@ Dict* dict_new(AllocatorInterface *allocator, uint32 max_members, uint32 key_siz
     List *key_list = list_new(allocator, max_members, key_size);
     if (key_list == NULL)
     {
-        allocator->memory_free(dict, sizeof(Dict));
+        allocator_memory_free(allocator, dict, sizeof(Dict));
         array_destroy(index_table, allocator);
         return NULL;
     }
@@ -735,7 +5095,7 @@ Dict* dict_new(AllocatorInterface *allocator, uint32 max_members, uint32 key_siz
     List *value_list = list_new(allocator, max_members, value_size);
     if (value_list == NULL)
     {
-        allocator->memory_free(dict, sizeof(Dict));
+        allocator_memory_free(allocator, dict, sizeof(Dict));
         array_destroy(index_table, allocator);
         list_destroy(key_list, allocator);
         return NULL;
@@ -759,51 +5119,36 @@ int dict_resize(Dict *dict, AllocatorInterface *allocator, uint32 max_members)
     if (dict == NULL || allocator == NULL)
         return 1;
 
-    List *new_keys = list_resize(dict->keys, allocator, max_members);
-    if (new_keys == NULL)
-        return 1;
-
-    List *new_values = list_resize(dict->values, allocator, max_members);
-    if (new_values == NULL)
-        return 1;
+    // The index table never has more slots than the lists have space for
+    // members, so it shrinks before the lists and grows after them.
+    if (max_members < dict->_num_slots)
+    {
+        Array *new_index_table = hash_index_resize(dict->index_table, allocator, dict->_num_slots, max_members);
+        if (new_index_table == NULL)
+            return 1;
+
+        dict->_num_slots = max_members;
+        dict->member_count = min(dict->member_count, max_members);
+        dict->keys->member_count = dict->member_count;
+        dict->values->member_count = dict->member_count;
+        dict->index_table = new_index_table;
+        hash_index_rehash(dict->index_table, dict->_num_slots, dict->keys, dict->member_count);
+    }
 
-    Array *new_index_table = allocator->memory_resize(dict->index_table, ARRAY_DATA_OFFSET + (8 * max_members));
-    if (new_index_table == NULL)
+    dict->keys = list_resize(dict->keys, allocator, max_members);
+    dict->values = list_resize(dict->values, allocator, max_members);
+    if (!list_has_capacity(dict->keys, max_members) || !list_has_capacity(dict->values, max_members))
         return 1;
 
-    new_index_table->member_count = max_members;
-    for (uint32 i = 0; i < max_members; i++)
-        array_set(new_index_table, i, (uint8*)&EMPTY_SLOT);
-
-    dict->_num_slots = max_members;
-    dict->member_count = min(dict->member_count, max_members);
-    dict->keys = new_keys;
-    dict->values = new_values;
-    dict->index_table = new_index_table;
-
-    uint8 *key;
-    uint32 key_size = dict->keys->member_size;
-    uint32 index;
-    int64 slot_value;
-    uint32 tries = 1;
-
-    for (uint32 i = 0; i < dict->member_count; i++)
+    if (max_members > dict->_num_slots)
     {
-        key = &new_keys->data[key_size * i];
-
-        while (tries < dict->_num_slots)
-        {
-            index = probe_index(key, key_size, tries-1, dict->_num_slots);
-            array_get(dict->index_table, index, (uint8*)&slot_value);
+        Array *new_index_table = hash_index_resize(dict->index_table, allocator, dict->_num_slots, max_members);
+        if (new_index_table == NULL)
+            return 1;
 
-            if (slot_value == EMPTY_SLOT || slot_value == REMOVED_SLOT)
-            {
-                slot_value = (int64) i;
-                array_set(dict->index_table, index, (uint8*)&slot_value);
-                break;
-            }
-            tries++;
-        }
+        dict->_num_slots = max_members;
+        dict->index_table = new_index_table;
+        hash_index_rehash(dict->index_table, dict->_num_slots, dict->keys, dict->member_count);
     }
     return 0;
 }
@@ -825,35 +5170,23 @@ void dict_set(Dict *dict, uint8 *key, uint8* value)
     if (dict == NULL || key == NULL || value == NULL)
         return;
 
-    uint8 *key_value;
-    uint32 key_size = dict->keys->member_size;
-    int64 slot_value;
-    uint32 index;
-    uint32 tries = 1;
-
-    while (tries < dict->_num_slots)
+    // Update the value if the key exists...
+    int64 index = dict_get_index(dict, key);
+    if (index > -1)
     {
-        index = probe_index(key, key_size, tries-1, dict->_num_slots);
-        array_get(dict->index_table, index, (uint8*)&slot_value);
+        list_set(dict->values, index, value);
+        return;
+    }
 
-        if (slot_value == EMPTY_SLOT || slot_value == REMOVED_SLOT)
-        {
-            slot_value = (int64) dict->member_count;
-            array_set(dict->index_table, index, (uint8*)&slot_value);
-            list_append(dict->keys, key);
-            list_append(dict->values, value);
-            dict->member_count++;
-            break;
-        }
+    if (dict->member_count >= dict->_num_slots)
+        return;
 
-        // Check if key is the same, and do updating instead...
-        key_value = &dict->keys->data[slot_value];
-        if (memory_are_equal(key, key_value, key_size)) {
-            list_set(dict->values, slot_value, value);
-            break;
-        }
-        tries++;
-    }
+    if (hash_index_link(dict->index_table, dict->_num_slots, key, dict->keys->member_size, dict->member_count))
+        return;
+
+    list_append(dict->keys, key);
+    list_append(dict->values, value);
+    dict->member_count++;
 }
 
 
@@ -873,15 +5206,27 @@ void dict_pop(Dict *dict, uint8 *key, uint8 *memory)
     if (dict == NULL || key == NULL || memory == NULL)
         return;
 
-    int64 index = dict_get_index(dict, key);
-    if (index > -1)
+    int64 slot = hash_index_find_slot(dict->index_table, dict->_num_slots, dict->keys, key);
+    if (slot < 0)
+        return;
+
+    // Move the last member into the hole, so the members stay dense
+    // and only its slot needs to be updated...
+    int64 *slots = (int64*)dict->index_table->data;
+    uint32 index = slots[slot];
+    uint32 last = dict->member_count - 1;
+
+    list_get(dict->values, index, memory);
+    slots[slot] = REMOVED_SLOT;
+    if (index != last)
     {
-        list_get(dict->values, index, memory);
-        array_set(dict->index_table, index, (uint8*)&REMOVED_SLOT);
-        list_remove_at(dict->keys, index);
-        list_remove_at(dict->values, index);
-        dict->member_count--;
+        hash_index_relink(dict->index_table, dict->_num_slots, dict->keys, last, index);
+        list_set(dict->keys, index, &dict->keys->data[dict->keys->member_size * last]);
+        list_set(dict->values, index, &dict->values->data[dict->values->member_size * last]);
     }
+    dict->keys->member_count--;
+    dict->values->member_count--;
+    dict->member_count--;
 }
 
 
@@ -927,16 +5272,14 @@ Array* dict_copy_items(Dict *dict, AllocatorInterface *allocator)
     {
         dest_offset = i * member_size;
         src_offset = i * key_size;
-        for (uint32 j = 0; j < key_size; j++)
-            items->data[dest_offset + j] = dict->keys->data[src_offset + j];
+        memory_copy(&dict->keys->data[src_offset], &items->data[dest_offset], key_size);
     }
 
     for (uint32 i = 0; i < items->member_count; i++)
     {
         dest_offset = (i * member_size) + key_size;
         src_offset = i * value_size;
-        for (uint32 j = 0; j < value_size; j++)
-            items->data[dest_offset + j] = dict->values->data[src_offset + j];
+        memory_copy(&dict->values->data[src_offset], &items->data[dest_offset], value_size);
     }
 
     return items;
@@ -957,36 +5300,16 @@ void dict_destroy(Dict* dict, AllocatorInterface *allocator)
     if (dict->values != NULL)
         list_destroy(dict->values, allocator);
 
-    allocator->memory_free(dict, sizeof(Dict));
+    allocator_memory_free(allocator, dict, sizeof(Dict));
 }
 
 
 static int64 set_get_index(Set *set, uint8 *item)
 {
-    uint8 *item_value;
-    uint32 member_size = set->items->member_size;
-    int64 slot_value;
-    uint32 index;
-    uint32 tries = 1;
-
-    while (tries < set->_num_slots)
-    {
-        index = probe_index(item, member_size, tries-1, set->_num_slots);
-        array_get(set->index_table, index, (uint8*)&slot_value);
-
-        if (slot_value == EMPTY_SLOT)
-            return -1;
-
-        if (slot_value != REMOVED_SLOT)
-        {
-            item_value = &set->items->data[member_size * slot_value];
-            if (memory_are_equal(item, item_value, member_size)) {
-                return slot_value;
-            }
-        }
-        tries++;
-    }
-    return -1;
+    int64 slot = hash_index_find_slot(set->index_table, set->_num_slots, set->items, item);
+    if (slot < 0)
+        return -1;
+    return ((int64*)set->index_table->data)[slot];
 }
 
 
@@ -995,14 +5318,14 @@ Set* set_new(AllocatorInterface *allocator, uint32 max_members, uint32 member_si
     if (allocator == NULL)
         return NULL;
 
-    Set *set = allocator->memory_allocate(sizeof(Set));
+    Set *set = allocator_memory_allocate(allocator, sizeof(Set));
     if (set == NULL)
         return NULL;
 
     Array *index_table = array_new(allocator, max_members, 8);
     if (index_table == NULL)
     {
-        allocator->memory_free(set, sizeof(Set));
+        allocator_memory_free(allocator, set, sizeof(Set));
         return NULL;
     }
 
@@ -1010,7 +5333,7 @@ Set* set_new(AllocatorInterface *allocator, uint32 max_members, uint32 member_si
     List *item_list = list_new(allocator, max_members, member_size);
     if (item_list == NULL)
     {
-        allocator->memory_free(set, sizeof(Set));
+        allocator_memory_free(allocator, set, sizeof(Set));
         array_destroy(index_table, allocator);
         return NULL;
     }
@@ -1034,46 +5357,33 @@ int set_resize(Set *set, AllocatorInterface *allocator, uint32 max_members)
     if (set == NULL || allocator == NULL)
         return 1;
 
-    List *new_items= list_resize(set->items, allocator, max_members);
-    if (new_items == NULL)
-        return 1;
+    // Same order as dict_resize, the index table shrinks first and grows last.
+    if (max_members < set->_num_slots)
+    {
+        Array *new_index_table = hash_index_resize(set->index_table, allocator, set->_num_slots, max_members);
+        if (new_index_table == NULL)
+            return 1;
+
+        set->_num_slots = max_members;
+        set->member_count = min(set->member_count, max_members);
+        set->items->member_count = set->member_count;
+        set->index_table = new_index_table;
+        hash_index_rehash(set->index_table, set->_num_slots, set->items, set->member_count);
+    }
 
-    Array *new_index_table = allocator->memory_resize(set->index_table, ARRAY_DATA_OFFSET + (8 * max_members));
-    if (new_index_table == NULL)
+    set->items = list_resize(set->items, allocator, max_members);
+    if (!list_has_capacity(set->items, max_members))
         return 1;
 
-    new_index_table->member_count = max_members;
-    for (uint32 i = 0; i < max_members; i++)
-        array_set(new_index_table, i, (uint8*)&EMPTY_SLOT);
-
-    set->_num_slots = max_members;
-    set->member_count = min(set->member_count, max_members);
-    set->items = new_items;
-    set->index_table = new_index_table;
-
-    uint8 *key;
-    uint32 key_size = set->items->member_size;
-    uint32 index;
-    int64 slot_value;
-    uint32 tries = 1;
-
-    for (uint32 i = 0; i < set->member_count; i++)
+    if (max_members > set->_num_slots)
     {
-        key = &new_items->data[key_size * i];
-
-        while (tries < set->_num_slots)
-        {
-            index = probe_index(key, key_size, tries-1, set->_num_slots);
-            array_get(set->index_table, index, (uint8*)&slot_value);
+        Array *new_index_table = hash_index_resize(set->index_table, allocator, set->_num_slots, max_members);
+        if (new_index_table == NULL)
+            return 1;
 
-            if (slot_value == EMPTY_SLOT || slot_value == REMOVED_SLOT)
-            {
-                slot_value = (int64) i;
-                array_set(set->index_table, index, (uint8*)&slot_value);
-                break;
-            }
-            tries++;
-        }
+        set->_num_slots = max_members;
+        set->index_table = new_index_table;
+        hash_index_rehash(set->index_table, set->_num_slots, set->items, set->member_count);
     }
     return 0;
 }
@@ -1095,33 +5405,14 @@ void set_add(Set *set, uint8* item)
     if (set == NULL || item == NULL)
         return;
 
-    uint8 *item_value;
-    uint64 member_size = set->items->member_size;
-    int64 slot_value;
-    uint32 index;
-    uint32 tries = 1;
-
-    while (tries < set->_num_slots)
-    {
-        index = probe_index(item, member_size, tries-1, set->_num_slots);
-        array_get(set->index_table, index, (uint8*)&slot_value);
-
-        if (slot_value == EMPTY_SLOT || slot_value == REMOVED_SLOT)
-        {
-            slot_value = (int64) set->member_count;
-            array_set(set->index_table, index, (uint8*)&slot_value);
-            list_append(set->items, item);
-            set->member_count++;
-            break;
-        }
+    if (set->member_count >= set->_num_slots || set_get_index(set, item) > -1)
+        return;
 
-        // Check if item is the same, and do nothing if true...
-        item_value = &set->items->data[slot_value];
-        if (memory_are_equal(item, item_value, member_size))
-            return;
+    if (hash_index_link(set->index_table, set->_num_slots, item, set->items->member_size, set->member_count))
+        return;
 
-        tries++;
-    }
+    list_append(set->items, item);
+    set->member_count++;
 }
 
 
@@ -1130,13 +5421,23 @@ void set_remove(Set *set, uint8* item)
     if (set == NULL || item == NULL)
         return;
 
-    int64 index = set_get_index(set, item);
-    if (index > -1)
+    int64 slot = hash_index_find_slot(set->index_table, set->_num_slots, set->items, item);
+    if (slot < 0)
+        return;
+
+    // Same as dict_pop, the last member moves into the hole...
+    int64 *slots = (int64*)set->index_table->data;
+    uint32 index = slots[slot];
+    uint32 last = set->member_count - 1;
+
+    slots[slot] = REMOVED_SLOT;
+    if (index != last)
     {
-        array_set(set->index_table, index, (uint8*)&REMOVED_SLOT);
-        list_remove_at(set->items, index);
-        set->member_count--;
+        hash_index_relink(set->index_table, set->_num_slots, set->items, last, index);
+        list_set(set->items, index, &set->items->data[set->items->member_size * last]);
     }
+    set->items->member_count--;
+    set->member_count--;
 }
 
 
@@ -1163,6 +5464,6 @@ void set_destroy(Set *set, AllocatorInterface *allocator)
     if (set->items != NULL)
         list_destroy(set->items, allocator);
 
-    allocator->memory_free(set, sizeof(Set));
+    allocator_memory_free(allocator, set, sizeof(Set));
 }
 
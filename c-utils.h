@@ -31,6 +31,9 @@
 // If you wish to port this library for other targets,
 // change the defenitions of the following integer types.
 #define PLATFORM_POINTER_LENGTH 8
+#define PLATFORM_CACHE_LINE_SIZE 64
+#define PLATFORM_PAGE_SIZE 4096
+#define PLATFORM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
 
 #define uint8 unsigned char
 #define uint16 unsigned short
@@ -48,33 +51,59 @@
 #define min(A, B) (A <= B ? A : B)
 
 
-static inline void memory_set(uint8 *memory, uint8 value, uint64 length)
+enum SimdLevel
 {
-    for (uint64 i = 0; i < length; i++)
-        memory[i] = value;
-}
+    SIMD_LEVEL_WORD,
+    SIMD_LEVEL_SSE2,
+    SIMD_LEVEL_SSSE3,
+    SIMD_LEVEL_AVX2
+};
 
 
-static inline void memory_copy(uint8 *src, uint8 *target, uint64 length)
-{
-    for (uint64 i = 0; i < length; i++)
-        target[i] = src[i];
-}
+// Return the widest instruction set the memory kernels
+// can use on this host. Detected with cpuid on x64,
+// SIMD_LEVEL_WORD on every other target.
+enum SimdLevel platform_simd_level();
+
+// Select the kernels used by memory_set, memory_copy, memory_move, memory_are_equal
+// and the array/list byteswap functions.
+// The best supported level is selected automatically on first use,
+// levels above platform_simd_level() are lowered to the supported maximum.
+void memory_kernels_select(enum SimdLevel);
 
+// Set 'length' bytes starting from memory into the provided value.
+void memory_set(uint8 *memory, uint8 value, uint64 length);
+
+// Copy 'length' bytes from src to target. Copies from the lowest
+// address up, so overlapping blocks are only supported if target < src.
+void memory_copy(uint8 *src, uint8 *target, uint64 length);
 
 // Compare the two provided memory blocks and return 1 if
 // blocks are equal, 0 otherwise. Reads at most 'length' bytes.
 // This function should not be used for anything where security
 // is required (for example comparing password hashes).
-static inline int memory_are_equal(uint8* src, uint8 *cmp, uint64 length)
-{
-    for (uint64 i = 0; i < length; i++)
-    {
-        if (src[i] != cmp[i])
-            return 0;
-    }
-    return 1;
-}
+int memory_are_equal(uint8* src, uint8 *cmp, uint64 length);
+
+// Copy 'length' bytes from src to target.
+// The blocks may overlap in either direction.
+void memory_move(uint8 *src, uint8 *target, uint64 length);
+
+
+// Map 'size' bytes of zeroed memory directly from the kernel.
+// Physical pages are only committed when first touched. Mappings of at least
+// PLATFORM_HUGE_PAGE_SIZE bytes are aligned to it and request transparent huge pages.
+// Can be passed to the arena_allocator_init functions as get_memory, see
+// ARENA_ALLOCATOR_FLAG_RELEASE for returning unused arena pages to the kernel.
+// Returns NULL if the mapping fails or the platform is not x64 Linux.
+void* platform_memory_map(uint64 size);
+
+// Unmap memory returned by platform_memory_map. Can be passed to
+// arena_allocator_destroy as free_memory if the ArenaAllocator itself was mapped.
+void platform_memory_unmap(void *memory, uint64 size);
+
+// Return the whole pages inside the provided block to the kernel.
+// The block stays mapped and reads as zero the next time it is touched.
+void platform_memory_release(void *memory, uint64 size);
 
 
 // Return 1 if host is little endian, 0 otherwise.
@@ -108,6 +137,48 @@ enum ComparisonResult
 };
 
 
+// Built-in comparators for the members of Arrays and Lists.
+// array_sort and list_sort recognize these and use sort kernels
+// where the comparison is inlined. Floats compare with < and >,
+// the position of NaNs in the sorted result is unspecified.
+enum ComparisonResult compare_int32(uint8*, uint8*);
+enum ComparisonResult compare_uint32(uint8*, uint8*);
+enum ComparisonResult compare_int64(uint8*, uint8*);
+enum ComparisonResult compare_uint64(uint8*, uint8*);
+enum ComparisonResult compare_float32(uint8*, uint8*);
+enum ComparisonResult compare_float64(uint8*, uint8*);
+
+
+// Key types for array_sort_radix.
+#define RADIX_KEY_UNSIGNED 0
+#define RADIX_KEY_SIGNED   1
+#define RADIX_KEY_FLOAT    2
+#define RADIX_KEY_BYTES    3
+
+// Location and type of the sort key inside each member.
+// Integer keys are little-endian and 1 to 8 bytes wide, float keys
+// are 4 or 8 bytes. Byte keys are compared like strings of 'width'
+// bytes, the first byte being the most significant.
+typedef struct RadixKey
+{
+    uint32 offset;
+    uint32 width;
+    uint32 type;
+} RadixKey;
+
+
+// Runs the tasks of parallel algorithms such as array_sort_parallel.
+// run must call task(argument, index) once for every index in [0, count)
+// and return only after all of the calls have returned. The calls may
+// be spread over up to worker_count threads in any order.
+typedef struct WorkerPool
+{
+    uint32 worker_count;
+    void *context;
+    void (*run)(void *context, void (*task)(void*, uint32), void *argument, uint32 count);
+} WorkerPool;
+
+
 typedef struct AllocatorInterface
 {
     // Should allocate a continuous block of memory
@@ -126,30 +197,304 @@ typedef struct AllocatorInterface
 
     // Mark the memory in segment [memory, memory + n] freed.
     void  (*memory_free)     (void *memory, uint64);
+
+    // Stateful allocators set the functions above to NULL and
+    // implement the ones below instead. These receive the context
+    // pointer as their first argument, and resize also receives
+    // the current size of the memory block.
+    void *context;
+    void* (*context_memory_allocate) (void *context, uint64);
+    void* (*context_memory_resize)   (void *context, void *memory, uint64 old_size, uint64 new_size);
+    void  (*context_memory_free)     (void *context, void *memory, uint64);
 } AllocatorInterface;
 
 
-#define BUMP_ALLOCATOR_BUFFER_OFFSET 16
+// Allocate memory through the provided interface.
+static inline void* allocator_memory_allocate(AllocatorInterface *allocator, uint64 size)
+{
+    if (allocator->memory_allocate != NULL)
+        return allocator->memory_allocate(size);
+    return allocator->context_memory_allocate(allocator->context, size);
+}
+
+// Resize memory through the provided interface.
+static inline void* allocator_memory_resize(AllocatorInterface *allocator, void *memory, uint64 old_size, uint64 new_size)
+{
+    if (allocator->memory_allocate != NULL)
+        return allocator->memory_resize(memory, new_size);
+    return allocator->context_memory_resize(allocator->context, memory, old_size, new_size);
+}
+
+// Free memory through the provided interface.
+static inline void allocator_memory_free(AllocatorInterface *allocator, void *memory, uint64 size)
+{
+    if (allocator->memory_allocate != NULL)
+        allocator->memory_free(memory, size);
+    else
+        allocator->context_memory_free(allocator->context, memory, size);
+}
+
+
+// Define C_UTILS_ALLOCATOR_STATS when compiling both the library and its users
+// to make the allocators keep the counters reported by the *_allocator_stats functions.
+// Without it the counters and the stats functions are compiled out.
+#ifdef C_UTILS_ALLOCATOR_STATS
+
+typedef struct AllocatorCounters
+{
+    uint64 bytes_requested;
+    // Kept only by allocators that cannot derive them from their state.
+    uint64 bytes_used;
+    uint64 bytes_reserved;
+    uint64 peak_bytes_used;
+    uint64 allocations;
+    uint64 failed_allocations;
+} AllocatorCounters;
+
+#define ALLOCATOR_COUNTERS_SIZE 48
+
+typedef struct AllocatorStats
+{
+    // Sum of the requested sizes since the last reset.
+    uint64 bytes_requested;
+    // Memory handed out, including alignment padding and block headers.
+    uint64 bytes_used;
+    // Memory taken from get_memory or the provided regions.
+    uint64 bytes_reserved;
+    // Highest bytes_used since the last reset.
+    uint64 peak_bytes_used;
+    // Free memory outside the largest free block.
+    uint64 fragmented_bytes;
+    // Successful allocations since the last reset.
+    uint64 allocations;
+    // Failed allocations since the allocator was initialized.
+    uint64 failed_allocations;
+    uint32 num_arenas;
+} AllocatorStats;
+
+#else
+
+#define ALLOCATOR_COUNTERS_SIZE 0
+
+#endif
+
+
+#define BUMP_ALLOCATOR_BUFFER_OFFSET (16 + ALLOCATOR_COUNTERS_SIZE)
+
+// Alignment of container memory (Array, List, Dict and Set) taken from
+// bump and arena allocators. Keeps the member data of Arrays and Lists
+// naturally aligned for any member up to 8 bytes.
+#define ALLOCATOR_DEFAULT_ALIGNMENT 16
 
 typedef struct BumpAllocator
 {
     uint64 buffer_size;
     uint64 end_index;
+#ifdef C_UTILS_ALLOCATOR_STATS
+    AllocatorCounters counters;
+#endif
     uint8 buffer[];
 } BumpAllocator;
 
 
-#define ARENA_ALLOCATOR_ARENA_ARRAY_OFFSET (PLATFORM_POINTER_LENGTH + 16)
+#define ARENA_ALLOCATOR_FREE_INDEX_SIZE 4
+
+// Remaining space of an arena that is no longer the current arena.
+// An entry with free_space of 0 is unused.
+typedef struct ArenaFreeSpace
+{
+    uint64 free_space;
+    uint32 arena_index;
+} ArenaFreeSpace;
+
+
+// Memory block for a single oversized allocation of a growing ArenaAllocator.
+typedef struct ArenaChunk
+{
+    struct ArenaChunk *next;
+    uint64 size;
+    uint8 memory[];
+} ArenaChunk;
+
+#define ARENA_CHUNK_MEMORY_OFFSET 16
+
+// Each new arena of a growing ArenaAllocator is twice the size
+// of the previous one, up to arena_size << ARENA_ALLOCATOR_MAX_GROWTH_SHIFT.
+#define ARENA_ALLOCATOR_FLAG_GROWING 0x01
+#define ARENA_ALLOCATOR_MAX_GROWTH_SHIFT 16
+// On reset, the pages of arenas and chunks that stayed unused since the previous
+// reset are returned to the kernel with platform_memory_release. Memory used by
+// the last batch stays resident for the next one. Requires get_memory to return
+// memory from platform_memory_map.
+#define ARENA_ALLOCATOR_FLAG_RELEASE 0x02
+
+#define ARENA_ALLOCATOR_ARENA_ARRAY_OFFSET (PLATFORM_CACHE_LINE_SIZE + 24 + 16 * ARENA_ALLOCATOR_FREE_INDEX_SIZE + 3 * PLATFORM_POINTER_LENGTH + ALLOCATOR_COUNTERS_SIZE)
 
 typedef struct ArenaAllocator
 {
+    // Incremented on every reset, invalidates the slices held by ArenaCaches.
+    // Read by every ArenaCache allocation, so the first cache line of the allocator
+    // holds only this and fields that never change after initialization.
+    uint32 generation;
+    uint32 flags;
     void* (*get_memory)(uint64);
     uint64 arena_size;
     uint32 max_arenas;
+    uint32 _padding[PLATFORM_CACHE_LINE_SIZE / 4 - 7];
     uint32 num_arenas;
+    // Allocations are served from this arena until it runs out of space.
+    // Requests it misses go to the spill arena after it, which becomes current
+    // once it misses as well. Every arena after the used ones is empty.
+    uint32 current_arena;
+    // Taken by ArenaCaches while refilling from this allocator.
+    uint32 lock;
+    // Number of arenas taken into use since the last reset, and before it.
+    uint32 used_arenas;
+    uint32 resident_arenas;
+    // The previous arenas with the most space left.
+    ArenaFreeSpace free_index[ARENA_ALLOCATOR_FREE_INDEX_SIZE];
+    // Dedicated blocks of oversized allocations, in use and recycled by a reset.
+    // Recycled chunks whose pages were released are kept apart.
+    ArenaChunk *chunks;
+    ArenaChunk *free_chunks;
+    ArenaChunk *released_chunks;
+#ifdef C_UTILS_ALLOCATOR_STATS
+    AllocatorCounters counters;
+#endif
     BumpAllocator *arenas[];
 } ArenaAllocator;
 
+typedef char arena_allocator_layout_check[__builtin_offsetof(ArenaAllocator, arenas) == ARENA_ALLOCATOR_ARENA_ARRAY_OFFSET ? 1 : -1];
+
+
+// Per-thread slice of a shared ArenaAllocator.
+typedef struct ArenaCache
+{
+    ArenaAllocator *parent;
+    uint64 refill_size;
+    uint8 *next;
+    uint8 *end;
+    uint32 generation;
+} ArenaCache;
+
+
+// State of an ArenaAllocator saved by arena_allocator_mark.
+typedef struct ArenaAllocatorMark
+{
+    ArenaChunk *chunks;
+    uint64 end_index;
+    uint32 current_arena;
+    uint32 used_arenas;
+    uint64 spill_end_index;
+    ArenaFreeSpace free_index[ARENA_ALLOCATOR_FREE_INDEX_SIZE];
+    uint64 free_index_end[ARENA_ALLOCATOR_FREE_INDEX_SIZE];
+} ArenaAllocatorMark;
+
+
+// Backing memory of a PoolAllocator, split into blocks_per_chunk blocks.
+typedef struct PoolChunk
+{
+    struct PoolChunk *next;
+    uint64 _padding;
+    uint8 memory[];
+} PoolChunk;
+
+#define POOL_CHUNK_MEMORY_OFFSET 16
+
+typedef struct PoolAllocator
+{
+    void* (*get_memory)(uint64);
+    // Used through AllocatorInterface for requests larger than block_size.
+    AllocatorInterface *fallback;
+    uint64 block_size;
+    uint64 blocks_per_chunk;
+    // Freed blocks, each holds the pointer to the next free block.
+    void *free_list;
+    // Blocks of the newest chunk that have never been handed out.
+    uint8 *next_block;
+    uint8 *chunk_end;
+    // Chunks in use, and chunks released by a reset.
+    PoolChunk *chunks;
+    PoolChunk *free_chunks;
+#ifdef C_UTILS_ALLOCATOR_STATS
+    AllocatorCounters counters;
+#endif
+} PoolAllocator;
+
+
+// Free lists are segregated by the highest set bit of the block size (first level),
+// and each first level range is split linearly into TLSF_SL_INDEX_COUNT lists (second level).
+#define TLSF_SL_INDEX_COUNT_LOG2 4
+#define TLSF_SL_INDEX_COUNT (1 << TLSF_SL_INDEX_COUNT_LOG2)
+#define TLSF_ALIGNMENT_LOG2 4
+#define TLSF_FL_INDEX_SHIFT (TLSF_SL_INDEX_COUNT_LOG2 + TLSF_ALIGNMENT_LOG2)
+#define TLSF_FL_INDEX_MAX 38
+#define TLSF_FL_INDEX_COUNT (TLSF_FL_INDEX_MAX - TLSF_FL_INDEX_SHIFT + 1)
+#define TLSF_BLOCK_HEADER_SIZE 16
+
+// Header in front of every block of a TlsfAllocator.
+// The free list links are stored in the memory of free blocks.
+typedef struct TlsfBlock
+{
+    // Only valid if the previous block is free.
+    struct TlsfBlock *prev_physical;
+    // Size of the memory after the header, the low bits hold the block flags.
+    uint64 size;
+    struct TlsfBlock *next_free;
+    struct TlsfBlock *prev_free;
+} TlsfBlock;
+
+typedef struct TlsfAllocator
+{
+    uint64 fl_bitmap;
+    uint32 sl_bitmap[TLSF_FL_INDEX_COUNT];
+    TlsfBlock *blocks[TLSF_FL_INDEX_COUNT][TLSF_SL_INDEX_COUNT];
+#ifdef C_UTILS_ALLOCATOR_STATS
+    AllocatorCounters counters;
+#endif
+} TlsfAllocator;
+
+
+#define ALLOCATOR_TRACE_ALLOCATE 1
+#define ALLOCATOR_TRACE_RESIZE 2
+#define ALLOCATOR_TRACE_FREE 3
+
+// A single operation recorded by an AllocatorRecorder.
+// A trace is a plain array of events, ready to be written into a file.
+typedef struct AllocatorTraceEvent
+{
+    uint32 operation;
+    // Identifies the memory block across its allocate, resize and free events.
+    uint32 id;
+    // Requested size. The old size of a resize or free is the size of
+    // the previous event with the same id.
+    uint64 size;
+} AllocatorTraceEvent;
+
+// Entry of the table mapping live addresses to trace ids, address 0 marks an empty slot.
+typedef struct AllocatorTraceSlot
+{
+    uint64 address;
+    uint64 id;
+} AllocatorTraceSlot;
+
+// Records every operation made through its AllocatorInterface and passes them to the target.
+typedef struct AllocatorRecorder
+{
+    AllocatorInterface *target;
+    // Provides the memory of the events and the address table.
+    AllocatorInterface *trace_allocator;
+    AllocatorTraceEvent *events;
+    uint64 event_count;
+    uint64 event_capacity;
+    AllocatorTraceSlot *slots;
+    uint64 slot_capacity;
+    uint64 live_count;
+    uint32 next_id;
+    // Set if the trace_allocator ran out of memory, the trace is incomplete.
+    uint32 failed;
+} AllocatorRecorder;
+
 
 #define ARRAY_DATA_OFFSET 8
 
@@ -189,6 +534,33 @@ typedef struct Set {
 } Set;
 
 
+// Values of the index table slots of Dict and Set that hold no member.
+#define DICT_EMPTY_SLOT (-1)
+#define DICT_REMOVED_SLOT (-2)
+
+// Hash of the key bytes, shared by Dict, Set and the typed dicts and sets.
+static inline uint64 dict_hash(uint8 *key, uint32 key_size)
+{
+    uint64 result = 5381;
+    for (uint32 i = 0; i < key_size; i++)
+        result = ((result << 5) + result) + key[i];
+    return result;
+}
+
+// Slot of the index table probed on the given try for a key hash.
+static inline uint32 dict_probe_slot(uint64 hash, uint32 tries, uint32 num_slots)
+{
+    // Quadratic probing, index = (h(k) + c1 * t + c2 * t^2) % num_slots
+    const uint32 MAGIC_PRIME_1 = 7841;
+    const uint32 MAGIC_PRIME_2 = 5903;
+    return (
+        hash
+        + (MAGIC_PRIME_1 * tries)
+        + (MAGIC_PRIME_2 * tries * tries)
+    ) % num_slots;
+}
+
+
 // Calculate the total space used by a bump allocator based on its buffer size.
 static inline uint64 bump_allocator_size(uint64 buf_size)
 {
@@ -203,8 +575,54 @@ void bump_allocator_init(BumpAllocator*, uint64);
 void bump_allocator_reset(BumpAllocator*);
 
 // Allocate memory, returns NULL if out of memory or an error occurs.
+// The memory is placed right after the previous allocation without any padding.
 void* bump_allocator_memory_allocate(BumpAllocator*, uint64);
 
+// Return a mark of the current end of the allocated memory.
+static inline uint64 bump_allocator_mark(BumpAllocator *allocator)
+{
+    return allocator->end_index;
+}
+
+// Free everything allocated after the mark was taken.
+// Marks taken after the given mark become invalid.
+// Does nothing if the allocator was reset after taking the mark.
+static inline void bump_allocator_rewind(BumpAllocator *allocator, uint64 mark)
+{
+#ifdef C_UTILS_ALLOCATOR_STATS
+    allocator->counters.peak_bytes_used = max(allocator->counters.peak_bytes_used, allocator->end_index);
+#endif
+    if (mark <= allocator->end_index)
+        allocator->end_index = mark;
+}
+
+// Allocate memory starting at an address that is a multiple of alignment.
+// Alignment must be a power of two up to PLATFORM_PAGE_SIZE, use
+// PLATFORM_CACHE_LINE_SIZE to give the allocation its own cache lines.
+// Returns NULL if out of memory, alignment is invalid, or an error occurs.
+void* bump_allocator_memory_allocate_aligned(BumpAllocator*, uint64 size, uint64 alignment);
+
+// Allocate memory from a bump allocator shared by multiple threads.
+// Space is claimed with a single atomic fetch-add, or with a compare-and-swap
+// loop if alignment is larger than 1. Returns NULL if out of memory or an error occurs.
+// After a failed allocation end_index may be left past buffer_size until the
+// next reset. Resetting or rewinding must not run concurrently with allocations,
+// and the other bump allocator functions are not thread safe.
+void* bump_allocator_memory_allocate_concurrent(BumpAllocator*, uint64 size, uint64 alignment);
+
+// Resize a block of old_size bytes allocated from the bump allocator.
+// The newest allocation is grown or shrunk in place if the buffer has room.
+// Other blocks are returned as is when shrinking, and otherwise copied into
+// a new block aligned to ALLOCATOR_DEFAULT_ALIGNMENT.
+// Returns NULL and leaves the block untouched if out of memory.
+void* bump_allocator_memory_resize(BumpAllocator*, void *memory, uint64 old_size, uint64 new_size);
+
+// Initialize an AllocatorInterface that allocates from the provided BumpAllocator.
+// The memory is aligned to ALLOCATOR_DEFAULT_ALIGNMENT. Resizing uses bump_allocator_memory_resize.
+// Freeing only reclaims the newest allocation, the rest of the memory is reclaimed
+// with bump_allocator_reset or bump_allocator_rewind.
+void bump_allocator_interface(AllocatorInterface*, BumpAllocator*);
+
 // Calculate the memory used by an arena allocator based on its max_arenas.
 // The created bumo allocators are allocated dynamically when needed,
 // these are not included in the total.
@@ -218,17 +636,185 @@ static inline uint64 arena_allocator_size(uint32 max_arenas)
 // the ArenaAllocator.
 void arena_allocator_init(ArenaAllocator*, void* (*get_memory)(uint64), uint64 arena_size, uint32 max_arenas);
 
+// Initialize a growing ArenaAllocator. Memory needs to be allocated by the caller.
+// The first arena is arena_size bytes and every new arena doubles in size,
+// so a small max_arenas covers a large range of workloads.
+// Requests larger than half of the next arena, or requests that do not fit
+// anywhere once max_arenas is reached, get a dedicated chunk of memory.
+void arena_allocator_init_growing(ArenaAllocator*, void* (*get_memory)(uint64), uint64 arena_size, uint32 max_arenas);
+
+// Initialize the ArenaAllocator with a combination of the ARENA_ALLOCATOR_FLAG values.
+// arena_allocator_init is the same as passing no flags, and arena_allocator_init_growing
+// the same as passing ARENA_ALLOCATOR_FLAG_GROWING.
+void arena_allocator_init_with_flags(ArenaAllocator*, void* (*get_memory)(uint64), uint64 arena_size, uint32 max_arenas, uint32 flags);
+
 // Allocate memory, returns NULL if out of memory, or an error occurs.
+// Allocations are taken from the current arena. Requests that do not fit
+// there are tried in the spill arena after it and in the arenas with the most
+// space left before a new arena is taken into use. Once max_arenas is reached,
+// growing allocators give such requests a dedicated chunk, and fixed ones
+// scan every arena before failing.
 void* arena_allocator_memory_allocate(ArenaAllocator*, uint64);
 
+// Allocate aligned memory, see bump_allocator_memory_allocate_aligned.
+// Returns NULL if out of memory, alignment is invalid, or an error occurs.
+void* arena_allocator_memory_allocate_aligned(ArenaAllocator*, uint64 size, uint64 alignment);
+
+// Resize a block of old_size bytes allocated from the arena allocator.
+// The newest allocation of the current or the spill arena, and the newest
+// dedicated chunk, are resized in place when they have room. Otherwise behaves like
+// bump_allocator_memory_resize.
+void* arena_allocator_memory_resize(ArenaAllocator*, void *memory, uint64 old_size, uint64 new_size);
+
+// Save the current state of the allocator into the provided mark.
+void arena_allocator_mark(ArenaAllocator*, ArenaAllocatorMark*);
+
+// Free everything allocated after the mark was taken, in time proportional
+// to the number of arenas and chunks taken into use since then. Arenas in use
+// at the mark only receive allocations through the spill arena and the free
+// index, which the mark records. Allocations the last-resort scan of a fixed allocator places in earlier
+// arenas are kept until reset.
+// Chunks allocated after the mark are kept for reuse like on reset.
+// The mark is invalidated by a reset or by rewinding to an earlier mark.
+void arena_allocator_rewind(ArenaAllocator*, ArenaAllocatorMark*);
+
 // Reset all allocated BumpAllocators. Does not overwrite data,
-// or free already allocated buffers.
+// or free already allocated buffers. Dedicated chunks are kept
+// for reuse by later oversized allocations. See ARENA_ALLOCATOR_FLAG_RELEASE
+// for returning the pages that stay unused to the kernel.
 void arena_allocator_reset(ArenaAllocator*);
 
 // Free all memory used by the ArenaAllocator,
-// including dynamically allocated bump allocators.
+// including dynamically allocated bump allocators and dedicated chunks.
 void arena_allocator_destroy(ArenaAllocator*, void (*free_memory)(void*, uint64));
 
+// Initialize an AllocatorInterface that allocates from the provided ArenaAllocator.
+// The memory is aligned to ALLOCATOR_DEFAULT_ALIGNMENT. Resizing uses arena_allocator_memory_resize.
+// Freeing only reclaims the newest allocation of the current or the spill arena, the rest of the
+// memory is reclaimed with arena_allocator_reset or arena_allocator_rewind.
+void arena_allocator_interface(AllocatorInterface*, ArenaAllocator*);
+
+// Initialize the PoolAllocator. Memory needs to be allocated by the caller.
+// Block size is rounded up to a multiple of PLATFORM_POINTER_LENGTH, and to
+// a multiple of ALLOCATOR_DEFAULT_ALIGNMENT if it is larger than a pointer.
+// Chunks of blocks_per_chunk blocks are taken from get_memory when needed.
+// The pointer to the get_memory-function must be valid for the entire lifetime of
+// the PoolAllocator.
+void pool_allocator_init(PoolAllocator*, void* (*get_memory)(uint64), uint64 block_size, uint64 blocks_per_chunk);
+
+// Initialize the PoolAllocator like pool_allocator_init. Interfaces created with
+// pool_allocator_interface pass requests larger than the block size to fallback,
+// which must be valid for the entire lifetime of the PoolAllocator.
+void pool_allocator_init_with_fallback(PoolAllocator*, void* (*get_memory)(uint64), uint64 block_size, uint64 blocks_per_chunk, AllocatorInterface *fallback);
+
+// Allocate a single block, returns NULL if out of memory.
+void* pool_allocator_memory_allocate(PoolAllocator*);
+
+// Return a block into the pool.
+void pool_allocator_memory_free(PoolAllocator*, void*);
+
+// Mark every block free. Chunks are kept for reuse.
+void pool_allocator_reset(PoolAllocator*);
+
+// Free all chunks and the PoolAllocator itself.
+void pool_allocator_destroy(PoolAllocator*, void (*free_memory)(void*, uint64));
+
+// Initialize an AllocatorInterface that allocates blocks from the provided PoolAllocator.
+// Requests larger than the block size go to the fallback interface given at
+// initialization, or fail if the pool has none. The block size is fixed, so memory
+// of the same size must be resized and freed through an interface of this pool.
+void pool_allocator_interface(AllocatorInterface*, PoolAllocator*);
+
+// Initialize an ArenaCache that hands out memory from slices of refill_size bytes
+// taken from the shared parent. Each thread should use its own ArenaCache,
+// only refills take the lock of the parent, and get_memory of the parent
+// is called without holding it. refill_size is rounded up to a
+// multiple of PLATFORM_CACHE_LINE_SIZE and slices are cache line aligned,
+// so memory of different threads never shares a cache line.
+// The parent should be a growing ArenaAllocator or have arena_size >= refill_size.
+void arena_cache_init(ArenaCache*, ArenaAllocator *parent, uint64 refill_size);
+
+// Allocate memory from the slice of the cache, refilling it from the parent if needed.
+// Requests that do not fit into the slice and are larger than half of refill_size
+// are allocated from the parent directly, keeping the rest of the slice.
+// Resetting the parent invalidates the slices of all of its caches at once,
+// the reset must not run concurrently with allocations.
+// Returns NULL if out of memory, alignment is invalid, or an error occurs.
+void* arena_cache_memory_allocate_aligned(ArenaCache*, uint64 size, uint64 alignment);
+
+// Allocate memory from the cache, see arena_cache_memory_allocate_aligned.
+void* arena_cache_memory_allocate(ArenaCache*, uint64 size);
+
+// Initialize an AllocatorInterface that allocates from the provided ArenaCache.
+// The memory is aligned to ALLOCATOR_DEFAULT_ALIGNMENT. The newest allocation
+// of the slice is resized in place, memory is reclaimed by resetting the parent.
+void arena_cache_interface(AllocatorInterface*, ArenaCache*);
+
+// Initialize the TlsfAllocator to manage the provided memory region.
+// The TlsfAllocator and the region are allocated by the caller,
+// for example with platform_memory_map.
+void tlsf_allocator_init(TlsfAllocator*, uint8 *memory, uint64 size);
+
+// Add another memory region to the TlsfAllocator.
+// Regions smaller than 64 bytes are ignored, regions larger than
+// 2^TLSF_FL_INDEX_MAX bytes are truncated.
+void tlsf_allocator_add_region(TlsfAllocator*, uint8 *memory, uint64 size);
+
+// Allocate memory in constant time, aligned to ALLOCATOR_DEFAULT_ALIGNMENT.
+// Returns NULL if size is 0 or no free block is large enough.
+void* tlsf_allocator_memory_allocate(TlsfAllocator*, uint64 size);
+
+// Resize memory in constant time (plus the copy if the block is moved).
+// The block is grown into a free neighbour or shrunk in place when possible,
+// otherwise old_size bytes are copied into a new block.
+// Returns NULL and keeps the old block if out of memory.
+void* tlsf_allocator_memory_resize(TlsfAllocator*, void *memory, uint64 old_size, uint64 new_size);
+
+// Free memory in constant time, merging it with free neighbours.
+void tlsf_allocator_memory_free(TlsfAllocator*, void *memory);
+
+// Initialize an AllocatorInterface that allocates from the provided TlsfAllocator.
+void tlsf_allocator_interface(AllocatorInterface*, TlsfAllocator*);
+
+// Initialize the AllocatorRecorder. Operations are forwarded to the target,
+// the trace is stored in memory taken from trace_allocator.
+void allocator_recorder_init(AllocatorRecorder*, AllocatorInterface *target, AllocatorInterface *trace_allocator);
+
+// Initialize an AllocatorInterface that records its operations into the provided AllocatorRecorder.
+void allocator_recorder_interface(AllocatorInterface*, AllocatorRecorder*);
+
+// Free the trace of the AllocatorRecorder.
+void allocator_recorder_destroy(AllocatorRecorder*);
+
+// Run the operations of a trace against the provided allocator. Memory left
+// allocated by the trace is freed at the end. The table of live blocks
+// is allocated from scratch. Returns the number of failed allocations and resizes.
+// A trace with an unknown operation or an id not below count is not run,
+// and count is returned.
+uint64 allocator_trace_replay(AllocatorTraceEvent *events, uint64 count, AllocatorInterface *allocator, AllocatorInterface *scratch);
+
+#ifdef C_UTILS_ALLOCATOR_STATS
+
+// Report the usage of the BumpAllocator. Also reports the fill of a single
+// arena of an ArenaAllocator, where failed_allocations counts the requests
+// that did not fit into that arena.
+void bump_allocator_stats(BumpAllocator*, AllocatorStats*);
+
+// Report the usage of the ArenaAllocator and its chunks. Free space left
+// behind in previous arenas is reported as fragmented_bytes, use
+// bump_allocator_stats on allocator->arenas[i] for the fill of each arena.
+void arena_allocator_stats(ArenaAllocator*, AllocatorStats*);
+
+// Report the usage of the PoolAllocator. Requests passed to the
+// fallback interface are not included.
+void pool_allocator_stats(PoolAllocator*, AllocatorStats*);
+
+// Report the usage of the TlsfAllocator. Walks the free lists
+// to find the largest free block.
+void tlsf_allocator_stats(TlsfAllocator*, AllocatorStats*);
+
+#endif
+
 // Allocate space and initialize the array.
 // All bytes are initialized into 0x00 values.
 // Returns NULL instead of an empty array.
@@ -267,6 +853,12 @@ Array* array_filter(Array*, AllocatorInterface*, int (*func)(uint8*));
 // Create a reversed copy of the given array.
 Array* array_reverse(Array*, AllocatorInterface*);
 
+// Reverse the byte order of every member of the array in place,
+// for example to convert an array of network order integers into host order.
+// Members of 2, 4, 8 and 16 bytes are swapped in one vectorized pass,
+// other member sizes are swapped one by one with switch_endianess.
+void array_byteswap(Array*);
+
 // Return the first index after the given start index
 // where the test function returns a non zero value.
 // If no mathces are found, or an error occurs, negative value is returned.
@@ -293,9 +885,111 @@ void array_foreach(Array*, void (*func)(uint8*));
 //
 void array_reduce(Array*, void (*func)(uint8*, uint8*, uint8*), uint8 *result);
 
-// Sort the array in place.
+// Variants of array_foreach, array_map, array_filter, array_reduce and
+// array_find_index that pass the ctx pointer as the last argument of every
+// call, for callbacks that need state without globals. array_filter_ctx
+// calls the test function once per member.
+void array_foreach_ctx(Array*, void (*func)(uint8*, void*), void *ctx);
+Array* array_map_ctx(Array*, AllocatorInterface*, void (*func)(uint8*, void*), void *ctx);
+Array* array_filter_ctx(Array*, AllocatorInterface*, int (*func)(uint8*, void*), void *ctx);
+void array_reduce_ctx(Array*, void (*func)(uint8*, uint8*, uint8*, void*), uint8 *result, void *ctx);
+int64 array_find_index_ctx(Array*, uint32 start_index, int (*func)(uint8*, void*), void *ctx);
+
+// Blocks given to the _chunked callbacks hold at most this many bytes,
+// or a single member if members are larger.
+#define ARRAY_CHUNK_SIZE 16384
+
+// Variants that call func once per block of consecutive members instead of
+// once per member. The callback receives the first member of the block, the
+// number of members in it, member_size and ctx, so it can run a tight loop
+// the compiler can vectorize.
+//
+// array_map_chunked copies every block into the new array and calls func on
+// the copy. array_filter_chunked copies every block into the new array, func
+// moves the members to keep to the front of the block and returns their
+// count. array_reduce_chunked lets func fold each block into result.
+// array_find_index_chunked expects func to return the index of the first
+// match inside the block, or a negative value, and returns the index in the
+// array like array_find_index.
+//
+// EXAMPLE sum of an array of integers:
+//
+// void sum_block(uint8 *base, uint32 count, uint32 size, void *result) { int *n = (int*)base; for (uint32 i = 0; i < count; i++) *(int*)result += n[i]; }
+// int result = 0;
+// array_reduce_chunked(array, sum_block, &result);
+//
+void array_foreach_chunked(Array*, void (*func)(uint8*, uint32, uint32, void*), void *ctx);
+Array* array_map_chunked(Array*, AllocatorInterface*, void (*func)(uint8*, uint32, uint32, void*), void *ctx);
+Array* array_filter_chunked(Array*, AllocatorInterface*, uint32 (*func)(uint8*, uint32, uint32, void*), void *ctx);
+void array_reduce_chunked(Array*, void (*func)(uint8*, uint32, uint32, void*), void *result);
+int64 array_find_index_chunked(Array*, uint32 start_index, int64 (*func)(uint8*, uint32, uint32, void*), void *ctx);
+
+// Sort the array in place with introsort, O(n log n) in the worst case.
+// The order of equal members is not preserved. Members of 4, 8 and 16 bytes
+// are moved as whole words, and the built-in comparators (compare_int32, ...)
+// are inlined into the sort when they match the member size.
 void array_sort(Array*, enum ComparisonResult (*compare)(uint8*, uint8*));
 
+// Sort the array in place, preserving the order of equal members.
+// Natural merge sort: ascending and strictly descending runs already in
+// the data are merged as they are, so nearly sorted input is close to O(n).
+// Arrays of more than 32 members take scratch memory for half of the
+// members from the allocator. Returns 1 and leaves the array untouched
+// if out of memory, 0 otherwise.
+int array_sort_stable(Array*, AllocatorInterface*, enum ComparisonResult (*compare)(uint8*, uint8*));
+
+// Sort the array in place with a parallel merge sort on the worker pool.
+// The array is split into one chunk per worker, the chunks are sorted
+// with the natural merge sort of array_sort_stable, and pairs of sorted
+// runs are then merged with every worker writing its own share of the
+// output. The result is the same as with array_sort_stable.
+// Scratch memory for all members is taken from the allocator. Every worker
+// gets at least 4096 members, so smaller arrays or a NULL pool fall back to
+// array_sort_stable. Returns 1 and leaves the array untouched
+// if out of memory, 0 otherwise.
+int array_sort_parallel(Array*, AllocatorInterface*, WorkerPool*, enum ComparisonResult (*compare)(uint8*, uint8*));
+
+// Binary search over an array sorted by compare. The comparator receives
+// a member as the first argument and the key as the second.
+//
+// array_lower_bound returns the index of the first member not smaller than
+// the key, array_upper_bound the index of the first member larger than the
+// key. Both return member_count if there is no such member.
+uint32 array_lower_bound(Array*, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*));
+uint32 array_upper_bound(Array*, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*));
+
+// Same as array_lower_bound, but the search always takes log2(member_count)
+// steps without branching on the comparison, and prefetches the next
+// midpoints. Faster on large arrays, where mispredicted branches and cache
+// misses dominate. The built-in comparators are inlined into the search.
+uint32 array_lower_bound_branchless(Array*, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*));
+
+// Return the index of a member equal to the key, or -1 if there is none.
+int64 array_bsearch(Array*, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*));
+
+// Copy a sorted array into a new array in Eytzinger order: the members of a
+// binary search tree stored level by level, so that the first levels of
+// every search share the same cache lines. Returns NULL if out of memory
+// or the array is empty.
+Array* array_to_eytzinger(Array*, AllocatorInterface*);
+
+// Search an array made by array_to_eytzinger, prefetching four levels ahead.
+// Returns the index in the Eytzinger array of the smallest member not smaller
+// than the key, or -1 if every member is smaller.
+int64 array_eytzinger_lower_bound(Array *eytzinger, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*));
+
+// Return the index in the Eytzinger array of a member equal to the key, or -1.
+int64 array_eytzinger_search(Array *eytzinger, uint8 *key, enum ComparisonResult (*compare)(uint8*, uint8*));
+
+// Sort the array in place by the given key with LSD radix sort,
+// one counting pass per key byte. Passes where every member has the
+// same byte are skipped. The order of equal keys is preserved.
+// Scratch memory of member_count * member_size bytes and 1 KiB per
+// key byte is taken from the allocator for the duration of the call.
+// Returns 1 and leaves the array untouched if the key is invalid or
+// out of memory, 0 otherwise.
+int array_sort_radix(Array*, AllocatorInterface*, RadixKey key);
+
 // Free memory used by the array.
 void array_destroy(Array*, AllocatorInterface*);
 
@@ -333,6 +1027,11 @@ void list_set(List*, uint32 index, uint8*);
 // Fails silently if there is not enough memory for the addition.
 void list_insert(List*, uint32 index, uint8*);
 
+// Copy 'count' members into the list from the provided address
+// starting at the specified index. The existing members are shifted only once.
+// Fails silently if there is not enough memory for the whole range.
+void list_insert_range(List*, uint32 index, uint8*, uint32 count);
+
 // Copy memory into the end of the list from to the provided address
 // for a total of list.member_size bytes. Increments the member_count,
 // always adds the new item without effecting existing ones.
@@ -342,6 +1041,10 @@ void list_append(List*, uint8*);
 // Remove the element at the specified index from list.
 void list_remove_at(List*, uint32 index);
 
+// Remove 'count' elements starting from the specified index.
+// The range is clipped to the end of the list.
+void list_remove_range(List*, uint32 index, uint32 count);
+
 // Copy memory into the list from to the provided address
 // for a total length of MIN(list.max_members * list.member_size, max_length).
 // Overwrites exiting members.
@@ -363,6 +1066,10 @@ Array* list_filter(List*, AllocatorInterface*, int (*func)(uint8*));
 // Create a reversed array from the given list.
 Array* list_reverse(List*, AllocatorInterface*);
 
+// Reverse the byte order of every member of the list in place.
+// See array_byteswap.
+void list_byteswap(List*);
+
 // Return the first index after the given start index
 // where the test function returns a non zero value.
 // If no mathces are found, or an error occurs, negative value is returned.
@@ -389,12 +1096,123 @@ void list_foreach(List*, void (*func)(uint8*));
 //
 void list_reduce(List*, void (*func)(uint8*, uint8*, uint8*), uint8*);
 
-// Sort the list in place.
+// Callback variants with a context pointer, see array_foreach_ctx.
+void list_foreach_ctx(List*, void (*func)(uint8*, void*), void *ctx);
+Array* list_map_ctx(List*, AllocatorInterface*, void (*func)(uint8*, void*), void *ctx);
+Array* list_filter_ctx(List*, AllocatorInterface*, int (*func)(uint8*, void*), void *ctx);
+void list_reduce_ctx(List*, void (*func)(uint8*, uint8*, uint8*, void*), uint8 *result, void *ctx);
+int64 list_find_index_ctx(List*, uint32 start_index, int (*func)(uint8*, void*), void *ctx);
+
+// Callback variants that work on blocks of members, see array_foreach_chunked.
+void list_foreach_chunked(List*, void (*func)(uint8*, uint32, uint32, void*), void *ctx);
+Array* list_map_chunked(List*, AllocatorInterface*, void (*func)(uint8*, uint32, uint32, void*), void *ctx);
+Array* list_filter_chunked(List*, AllocatorInterface*, uint32 (*func)(uint8*, uint32, uint32, void*), void *ctx);
+void list_reduce_chunked(List*, void (*func)(uint8*, uint32, uint32, void*), void *result);
+int64 list_find_index_chunked(List*, uint32 start_index, int64 (*func)(uint8*, uint32, uint32, void*), void *ctx);
+
+// Sort the list in place, see array_sort.
 void list_sort(List*, enum ComparisonResult (*compare)(uint8*, uint8*));
 
+// Sort the list in place by the given key, see array_sort_radix.
+int list_sort_radix(List*, AllocatorInterface*, RadixKey key);
+
+// Sort the list in place, preserving the order of equal members, see array_sort_stable.
+int list_sort_stable(List*, AllocatorInterface*, enum ComparisonResult (*compare)(uint8*, uint8*));
+
+// Sort the list in place on the worker pool, see array_sort_parallel.
+int list_sort_parallel(List*, AllocatorInterface*, WorkerPool*, enum ComparisonResult (*compare)(uint8*, uint8*));
+
 // Free memory used by the list.
 void list_destroy(List*, AllocatorInterface *allocator);
 
+// Pipelines
+//
+// A pipeline chains filter, map, take and skip stages over the members of an
+// Array or a List without intermediate arrays. Nothing runs until one of
+// pipeline_reduce, pipeline_collect or pipeline_to_array is called, which
+// then passes every member through all stages before reading the next one,
+// and stops reading as soon as a take stage is exhausted. A pipeline does not
+// allocate, and can be run any number of times.
+//
+// EXAMPLE sum of the squares of the first 10 even integers:
+//
+// Pipeline pipeline;
+// pipeline_init(&pipeline, array);
+// pipeline_filter(&pipeline, is_even, NULL);
+// pipeline_map(&pipeline, sizeof(int64), square_to_int64, NULL);
+// pipeline_take(&pipeline, 10);
+// int64 sum = 0;
+// pipeline_reduce(&pipeline, add_int64, (uint8*)&sum, NULL);
+//
+#define PIPELINE_MAX_STAGES 16
+// Largest member a map stage can produce.
+#define PIPELINE_MAX_MEMBER_SIZE 256
+
+#define PIPELINE_STAGE_FILTER 1
+#define PIPELINE_STAGE_MAP 2
+#define PIPELINE_STAGE_TAKE 3
+#define PIPELINE_STAGE_SKIP 4
+
+typedef struct PipelineStage
+{
+    uint32 type;
+    // Member size after this stage.
+    uint32 member_size;
+    uint64 count;
+    void *ctx;
+    int (*filter)(uint8 *member, void *ctx);
+    void (*map)(uint8 *member, uint8 *output, void *ctx);
+} PipelineStage;
+
+typedef struct Pipeline
+{
+    uint8 *data;
+    uint32 member_count;
+    uint32 member_size;
+    uint32 stage_count;
+    // Set when a stage could not be added, the pipeline will not run.
+    uint32 invalid;
+    PipelineStage stages[PIPELINE_MAX_STAGES];
+} Pipeline;
+
+// Start a pipeline over the members of the array or list.
+// The source must outlive the pipeline and is never modified.
+void pipeline_init(Pipeline*, Array*);
+void pipeline_init_list(Pipeline*, List*);
+
+// Keep the members for which func returns a non zero value.
+void pipeline_filter(Pipeline*, int (*func)(uint8 *member, void *ctx), void *ctx);
+
+// Replace every member with the output of func, which writes a member of
+// member_size bytes. member_size may differ from the input member size, but
+// can be at most PIPELINE_MAX_MEMBER_SIZE. The output is aligned to 16 bytes.
+void pipeline_map(Pipeline*, uint32 member_size, void (*func)(uint8 *member, uint8 *output, void *ctx), void *ctx);
+
+// Pass only the first count members reaching this stage.
+void pipeline_take(Pipeline*, uint32 count);
+
+// Drop the first count members reaching this stage.
+void pipeline_skip(Pipeline*, uint32 count);
+
+// Size of the members the pipeline produces, 0 if pipeline is NULL.
+uint32 pipeline_member_size(Pipeline*);
+
+// Run the pipeline and call func for every member it produces,
+// func accumulates the member into result.
+// Returns the number of members reduced, or -1 if the pipeline is invalid.
+int64 pipeline_reduce(Pipeline*, void (*func)(uint8 *member, uint8 *result, void *ctx), uint8 *result, void *ctx);
+
+// Run the pipeline and copy the members it produces into the buffer,
+// stopping once max_members have been written.
+// Returns the number of members written, or -1 if the pipeline is invalid.
+int64 pipeline_collect(Pipeline*, uint8 *buffer, uint32 max_members);
+
+// Run the pipeline into a new array. Memory for the largest possible result
+// is allocated up front and shrunk to the members produced.
+// Returns NULL instead of an empty array, if out of memory,
+// or if the pipeline is invalid.
+Array* pipeline_to_array(Pipeline*, AllocatorInterface*);
+
 // Allocate memory and initialize the dict.
 // Returns NULL if max_members * member_sixe == 0.
 Dict* dict_new(AllocatorInterface*, uint32 max_members, uint32 key_size, uint32 value_size);
@@ -427,7 +1245,8 @@ void dict_get(Dict*, uint8* key, uint8*);
 
 // Move value associated with the provided key into the
 // provided memory location. This must be atleast dict.value_size bytes.
-// Removes the key and its value from the dict.
+// Removes the key and its value from the dict,
+// the last key and value move into their place.
 // Memory pointed by key must be atleast dict.key_size bytes.
 // Fails silently if key is not found.
 void dict_pop(Dict*, uint8* key, uint8*);
@@ -465,7 +1284,8 @@ int set_contains_item(Set*, uint8 *item);
 // performance will decrease due to hash collisions.
 void set_add(Set*, uint8* item);
 
-// Remove the provided item from the set.
+// Remove the provided item from the set,
+// the last item moves into its place.
 // Memory pointed by item must be atleast dict.member_size bytes.
 // Fails silently if item is not in the set.
 void set_remove(Set*, uint8* item);
@@ -477,5 +1297,673 @@ Array* set_copy_items(Set*, AllocatorInterface*);
 void set_destroy(Set*, AllocatorInterface*);
 
 
+// Typed containers
+//
+// The macros below generate a container type and static inline functions for
+// one member type, so member sizes are compile-time constants and callbacks
+// given as constants are inlined into the loops. The generated types have the
+// same memory layout as Array, List, Dict and Set. They are created with the
+// untyped functions, and name_to_array, name_to_list, name_to_dict and
+// name_to_set convert them back for the rest of the API. Member types
+// must not need more than 8 byte alignment. The typed accessors do not check
+// indices, use member_count.
+//
+// EXAMPLE:
+//
+// C_UTILS_DEFINE_LIST(int_list, int32)
+//
+// static inline int int32_less(int32 a, int32 b) { return a < b; }
+//
+// int_list *numbers = int_list_new(allocator, 64);
+// int_list_append(numbers, 42);
+// int_list_sort(numbers, int32_less);
+//
+// Dict and Set take key equality as int (*)(K, K), which must agree with
+// comparing the key bytes. Keys are hashed and probed like dict_set and
+// set_add do, so the typed and untyped functions can be mixed on the same
+// dict or set, and key types must not have padding. Members are kept dense:
+// removing one moves the last member into its place, as dict_pop does.
+
+
+// Introsort over typed members, shared by typed arrays and lists. It follows
+// array_sort: median of three pivots, heapsort once a range has been
+// partitioned 2 * log2(count) times, and insertion sort for short ranges.
+// is_less returns non zero if the first member sorts before the second.
+#define C_UTILS_DEFINE_SORT(name, T)                                                          \
+    static inline __attribute__((always_inline)) void name##_sift_down(T *data, uint32 root, uint32 count, int (*is_less)(T, T)) \
+    {                                                                                         \
+        T member = data[root];                                                                \
+        uint32 child;                                                                         \
+        while ((child = 2 * root + 1) < count)                                                \
+        {                                                                                     \
+            if (child + 1 < count && is_less(data[child], data[child + 1]))                   \
+                child++;                                                                      \
+            if (!is_less(member, data[child]))                                                \
+                break;                                                                        \
+            data[root] = data[child];                                                         \
+            root = child;                                                                     \
+        }                                                                                     \
+        data[root] = member;                                                                  \
+    }                                                                                         \
+                                                                                              \
+    static inline __attribute__((always_inline)) void name##_swap(T *data, uint32 a, uint32 b) \
+    {                                                                                         \
+        T member = data[a];                                                                   \
+        data[a] = data[b];                                                                    \
+        data[b] = member;                                                                     \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_sort_members(T *data, uint32 count, int (*is_less)(T, T))       \
+    {                                                                                         \
+        struct { T *data; uint32 count; uint32 depth_limit; } stack[32];                      \
+        uint32 top = 0;                                                                       \
+        uint32 depth_limit = count > 1 ? 2 * (31 - __builtin_clz(count)) : 0;                 \
+        uint32 i, j, mid;                                                                     \
+        T pivot, member;                                                                      \
+                                                                                              \
+        for (;;)                                                                              \
+        {                                                                                     \
+            while (count > 16)                                                                \
+            {                                                                                 \
+                if (depth_limit == 0)                                                         \
+                {                                                                             \
+                    for (i = count / 2; i > 0; i--)                                           \
+                        name##_sift_down(data, i - 1, count, is_less);                        \
+                    for (i = count - 1; i > 0; i--)                                           \
+                    {                                                                         \
+                        name##_swap(data, 0, i);                                              \
+                        name##_sift_down(data, 0, i, is_less);                                \
+                    }                                                                         \
+                    count = 0;                                                                \
+                    break;                                                                    \
+                }                                                                             \
+                depth_limit--;                                                                \
+                                                                                              \
+                /* The median of three becomes the pivot in the first member. */              \
+                mid = count / 2;                                                              \
+                if (is_less(data[mid], data[0]))                                              \
+                    name##_swap(data, 0, mid);                                                \
+                if (is_less(data[count - 1], data[mid]))                                      \
+                {                                                                             \
+                    name##_swap(data, mid, count - 1);                                        \
+                    if (is_less(data[mid], data[0]))                                          \
+                        name##_swap(data, 0, mid);                                            \
+                }                                                                             \
+                name##_swap(data, 0, mid);                                                    \
+                pivot = data[0];                                                              \
+                                                                                              \
+                i = 0;                                                                        \
+                j = count;                                                                    \
+                for (;;)                                                                      \
+                {                                                                             \
+                    do                                                                        \
+                        i++;                                                                  \
+                    while (i < count && is_less(data[i], pivot));                             \
+                    do                                                                        \
+                        j--;                                                                  \
+                    while (is_less(pivot, data[j]));                                          \
+                    if (i >= j)                                                               \
+                        break;                                                                \
+                    name##_swap(data, i, j);                                                  \
+                }                                                                             \
+                name##_swap(data, 0, j);                                                      \
+                                                                                              \
+                /* Continue with the smaller side and push the larger one. */                 \
+                if (j < count - j - 1)                                                        \
+                {                                                                             \
+                    stack[top].data = data + j + 1;                                           \
+                    stack[top].count = count - j - 1;                                         \
+                    count = j;                                                                \
+                }                                                                             \
+                else                                                                          \
+                {                                                                             \
+                    stack[top].data = data;                                                   \
+                    stack[top].count = j;                                                     \
+                    data += j + 1;                                                            \
+                    count -= j + 1;                                                           \
+                }                                                                             \
+                stack[top++].depth_limit = depth_limit;                                       \
+            }                                                                                 \
+                                                                                              \
+            for (i = 1; i < count; i++)                                                       \
+            {                                                                                 \
+                member = data[i];                                                             \
+                for (j = i; j > 0 && is_less(member, data[j - 1]); j--)                       \
+                    data[j] = data[j - 1];                                                    \
+                data[j] = member;                                                             \
+            }                                                                                 \
+                                                                                              \
+            if (top == 0)                                                                     \
+                return;                                                                       \
+            top--;                                                                            \
+            data = stack[top].data;                                                           \
+            count = stack[top].count;                                                         \
+            depth_limit = stack[top].depth_limit;                                             \
+        }                                                                                     \
+    }
+
+
+#define C_UTILS_DEFINE_ARRAY(name, T)                                                         \
+    C_UTILS_DEFINE_SORT(name, T)                                                              \
+                                                                                              \
+    typedef struct name                                                                       \
+    {                                                                                         \
+        uint32 member_count;                                                                  \
+        uint32 member_size;                                                                   \
+        T data[];                                                                             \
+    } name;                                                                                   \
+                                                                                              \
+    typedef char name##_layout_check[__builtin_offsetof(name, data) == ARRAY_DATA_OFFSET ? 1 : -1]; \
+                                                                                              \
+    static inline name* name##_new(AllocatorInterface *allocator, uint32 member_count)       \
+    {                                                                                         \
+        return (name*)array_new(allocator, member_count, sizeof(T));                         \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_destroy(name *array, AllocatorInterface *allocator)            \
+    {                                                                                         \
+        array_destroy((Array*)array, allocator);                                             \
+    }                                                                                         \
+                                                                                              \
+    static inline Array* name##_to_array(name *array)                                        \
+    {                                                                                         \
+        return (Array*)array;                                                                 \
+    }                                                                                         \
+                                                                                              \
+    /* Returns NULL if the member size does not match. */                                    \
+    static inline name* name##_from_array(Array *array)                                      \
+    {                                                                                         \
+        return array != NULL && array->member_size == sizeof(T) ? (name*)array : NULL;       \
+    }                                                                                         \
+                                                                                              \
+    static inline T name##_get(name *array, uint32 index)                                    \
+    {                                                                                         \
+        return array->data[index];                                                            \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_set(name *array, uint32 index, T value)                        \
+    {                                                                                         \
+        array->data[index] = value;                                                           \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_fill(name *array, T value)                                     \
+    {                                                                                         \
+        for (uint32 i = 0; i < array->member_count; i++)                                     \
+            array->data[i] = value;                                                           \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_foreach(name *array, void (*func)(T*))                         \
+    {                                                                                         \
+        for (uint32 i = 0; i < array->member_count; i++)                                     \
+            func(&array->data[i]);                                                            \
+    }                                                                                         \
+                                                                                              \
+    static inline T name##_reduce(name *array, T initial, T (*func)(T, T))                   \
+    {                                                                                         \
+        for (uint32 i = 0; i < array->member_count; i++)                                     \
+            initial = func(initial, array->data[i]);                                          \
+        return initial;                                                                       \
+    }                                                                                         \
+                                                                                              \
+    /* Returns -1 if no member from start_index onwards matches. */                          \
+    static inline int64 name##_find_index(name *array, uint32 start_index, int (*func)(T*))  \
+    {                                                                                         \
+        for (uint32 i = start_index; i < array->member_count; i++)                           \
+            if (func(&array->data[i]))                                                        \
+                return i;                                                                     \
+        return -1;                                                                            \
+    }                                                                                         \
+                                                                                              \
+    /* Copies the array and calls func on every member of the copy, see array_map. */         \
+    static inline name* name##_map(name *array, AllocatorInterface *allocator, void (*func)(T*)) \
+    {                                                                                         \
+        name *result = (name*)array_new_no_init(allocator, array->member_count, sizeof(T));   \
+        if (result == NULL)                                                                   \
+            return NULL;                                                                      \
+        for (uint32 i = 0; i < array->member_count; i++)                                      \
+        {                                                                                     \
+            result->data[i] = array->data[i];                                                 \
+            func(&result->data[i]);                                                           \
+        }                                                                                     \
+        return result;                                                                        \
+    }                                                                                         \
+                                                                                              \
+    /* Returns NULL instead of an empty array, see array_filter. */                           \
+    static inline name* name##_filter(name *array, AllocatorInterface *allocator, int (*func)(T*)) \
+    {                                                                                         \
+        uint32 passed = 0;                                                                    \
+        for (uint32 i = 0; i < array->member_count; i++)                                      \
+            passed += func(&array->data[i]) != 0;                                             \
+        name *result = (name*)array_new_no_init(allocator, passed, sizeof(T));                \
+        if (result == NULL)                                                                   \
+            return NULL;                                                                      \
+        passed = 0;                                                                           \
+        for (uint32 i = 0; i < array->member_count; i++)                                      \
+            if (func(&array->data[i]))                                                        \
+                result->data[passed++] = array->data[i];                                      \
+        return result;                                                                        \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_sort(name *array, int (*is_less)(T, T))                         \
+    {                                                                                         \
+        name##_sort_members(array->data, array->member_count, is_less);                       \
+    }
+
+
+#define C_UTILS_DEFINE_LIST(name, T)                                                          \
+    C_UTILS_DEFINE_SORT(name, T)                                                              \
+                                                                                              \
+    typedef struct name                                                                       \
+    {                                                                                         \
+        uint64 _allocated_space;                                                              \
+        uint32 member_count;                                                                  \
+        uint32 member_size;                                                                   \
+        T data[];                                                                             \
+    } name;                                                                                   \
+                                                                                              \
+    typedef char name##_layout_check[__builtin_offsetof(name, data) == LIST_DATA_OFFSET ? 1 : -1]; \
+                                                                                              \
+    static inline name* name##_new(AllocatorInterface *allocator, uint32 max_members)        \
+    {                                                                                         \
+        return (name*)list_new(allocator, max_members, sizeof(T));                           \
+    }                                                                                         \
+                                                                                              \
+    /* Returns the given list if resizing failed, see list_resize. */                        \
+    static inline name* name##_resize(name *list, AllocatorInterface *allocator, uint32 max_members) \
+    {                                                                                         \
+        return (name*)list_resize((List*)list, allocator, max_members);                      \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_destroy(name *list, AllocatorInterface *allocator)             \
+    {                                                                                         \
+        list_destroy((List*)list, allocator);                                                 \
+    }                                                                                         \
+                                                                                              \
+    static inline List* name##_to_list(name *list)                                           \
+    {                                                                                         \
+        return (List*)list;                                                                   \
+    }                                                                                         \
+                                                                                              \
+    /* Returns NULL if the member size does not match. */                                    \
+    static inline name* name##_from_list(List *list)                                         \
+    {                                                                                         \
+        return list != NULL && list->member_size == sizeof(T) ? (name*)list : NULL;          \
+    }                                                                                         \
+                                                                                              \
+    static inline uint32 name##_capacity(name *list)                                         \
+    {                                                                                         \
+        return (list->_allocated_space - LIST_DATA_OFFSET) / sizeof(T);                      \
+    }                                                                                         \
+                                                                                              \
+    static inline T name##_get(name *list, uint32 index)                                     \
+    {                                                                                         \
+        return list->data[index];                                                             \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_set(name *list, uint32 index, T value)                         \
+    {                                                                                         \
+        list->data[index] = value;                                                            \
+    }                                                                                         \
+                                                                                              \
+    /* Fails silently if the list is full. */                                                \
+    static inline void name##_append(name *list, T value)                                    \
+    {                                                                                         \
+        if (list->member_count < name##_capacity(list))                                      \
+            list->data[list->member_count++] = value;                                         \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_remove_at(name *list, uint32 index)                            \
+    {                                                                                         \
+        if (index >= list->member_count)                                                      \
+            return;                                                                           \
+        list->member_count--;                                                                 \
+        for (uint32 i = index; i < list->member_count; i++)                                  \
+            list->data[i] = list->data[i + 1];                                                \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_foreach(name *list, void (*func)(T*))                          \
+    {                                                                                         \
+        for (uint32 i = 0; i < list->member_count; i++)                                      \
+            func(&list->data[i]);                                                             \
+    }                                                                                         \
+                                                                                              \
+    static inline T name##_reduce(name *list, T initial, T (*func)(T, T))                    \
+    {                                                                                         \
+        for (uint32 i = 0; i < list->member_count; i++)                                      \
+            initial = func(initial, list->data[i]);                                           \
+        return initial;                                                                       \
+    }                                                                                         \
+                                                                                              \
+    /* Returns -1 if no member from start_index onwards matches. */                          \
+    static inline int64 name##_find_index(name *list, uint32 start_index, int (*func)(T*))   \
+    {                                                                                         \
+        for (uint32 i = start_index; i < list->member_count; i++)                            \
+            if (func(&list->data[i]))                                                         \
+                return i;                                                                     \
+        return -1;                                                                            \
+    }                                                                                         \
+                                                                                              \
+    /* Unlike list_map, the copy is a full list of the same type. */                          \
+    static inline name* name##_map(name *list, AllocatorInterface *allocator, void (*func)(T*)) \
+    {                                                                                         \
+        name *result = (name*)list_new(allocator, list->member_count, sizeof(T));             \
+        if (result == NULL)                                                                   \
+            return NULL;                                                                      \
+        for (uint32 i = 0; i < list->member_count; i++)                                       \
+        {                                                                                     \
+            result->data[i] = list->data[i];                                                  \
+            func(&result->data[i]);                                                           \
+        }                                                                                     \
+        result->member_count = list->member_count;                                            \
+        return result;                                                                        \
+    }                                                                                         \
+                                                                                              \
+    /* Unlike list_filter, returns a full list of the same type, or NULL if empty. */         \
+    static inline name* name##_filter(name *list, AllocatorInterface *allocator, int (*func)(T*)) \
+    {                                                                                         \
+        uint32 passed = 0;                                                                    \
+        for (uint32 i = 0; i < list->member_count; i++)                                       \
+            passed += func(&list->data[i]) != 0;                                              \
+        name *result = (name*)list_new(allocator, passed, sizeof(T));                         \
+        if (result == NULL)                                                                   \
+            return NULL;                                                                      \
+        for (uint32 i = 0; i < list->member_count; i++)                                       \
+            if (func(&list->data[i]))                                                         \
+                result->data[result->member_count++] = list->data[i];                         \
+        return result;                                                                        \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_sort(name *list, int (*is_less)(T, T))                          \
+    {                                                                                         \
+        name##_sort_members(list->data, list->member_count, is_less);                         \
+    }
+
+
+// Open addressing over the index table shared by typed dicts and sets.
+// Slots hold the index of a member in 'keys', DICT_EMPTY_SLOT or
+// DICT_REMOVED_SLOT, and are probed with dict_hash and dict_probe_slot
+// over the key bytes, the same sequence the untyped functions use.
+#define C_UTILS_DEFINE_HASH_INDEX(name, K, keys, eq)                                          \
+    /* Returns the slot of the key, or -1 if it is not in the table. */                      \
+    static inline int64 name##_find_slot(name *table, K key)                                  \
+    {                                                                                         \
+        int64 *slots = (int64*)table->index_table->data;                                      \
+        uint64 key_hash = dict_hash((uint8*)&key, sizeof(K));                                 \
+        for (uint32 tries = 0; tries < table->_num_slots; tries++)                            \
+        {                                                                                     \
+            uint32 slot = dict_probe_slot(key_hash, tries, table->_num_slots);                \
+            int64 member = slots[slot];                                                       \
+            if (member == DICT_EMPTY_SLOT)                                                    \
+                return -1;                                                                    \
+            if (member != DICT_REMOVED_SLOT && eq(table->keys->data[member], key))            \
+                return slot;                                                                  \
+        }                                                                                     \
+        return -1;                                                                            \
+    }                                                                                         \
+                                                                                              \
+    /* Point the first free slot on the key's probe sequence at member. */                   \
+    /* Returns 1 if the probe sequence has no free slot, 0 otherwise. */                     \
+    static inline int name##_link(name *table, K key, uint32 member)                          \
+    {                                                                                         \
+        int64 *slots = (int64*)table->index_table->data;                                      \
+        uint64 key_hash = dict_hash((uint8*)&key, sizeof(K));                                 \
+        for (uint32 tries = 0; tries < table->_num_slots; tries++)                            \
+        {                                                                                     \
+            uint32 slot = dict_probe_slot(key_hash, tries, table->_num_slots);                \
+            if (slots[slot] < 0)                                                              \
+            {                                                                                 \
+                slots[slot] = member;                                                         \
+                return 0;                                                                     \
+            }                                                                                 \
+        }                                                                                     \
+        return 1;                                                                             \
+    }                                                                                         \
+                                                                                              \
+    /* Point the slot of the member at index 'from' to index 'to'. */                        \
+    static inline void name##_relink(name *table, uint32 from, uint32 to)                     \
+    {                                                                                         \
+        int64 *slots = (int64*)table->index_table->data;                                      \
+        uint64 key_hash = dict_hash((uint8*)&table->keys->data[from], sizeof(K));             \
+        for (uint32 tries = 0; tries < table->_num_slots; tries++)                            \
+        {                                                                                     \
+            uint32 slot = dict_probe_slot(key_hash, tries, table->_num_slots);                \
+            if (slots[slot] == from)                                                          \
+            {                                                                                 \
+                slots[slot] = to;                                                             \
+                return;                                                                       \
+            }                                                                                 \
+        }                                                                                     \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_rehash(name *table)                                             \
+    {                                                                                         \
+        int64 *slots = (int64*)table->index_table->data;                                      \
+        for (uint32 i = 0; i < table->_num_slots; i++)                                        \
+            slots[i] = DICT_EMPTY_SLOT;                                                       \
+        for (uint32 i = 0; i < table->member_count; i++)                                      \
+            name##_link(table, table->keys->data[i], i);                                      \
+    }                                                                                         \
+                                                                                              \
+    /* Grow or shrink the index table to max_members slots and rehash. */                    \
+    static inline int name##_resize_index(name *table, AllocatorInterface *allocator, uint32 max_members) \
+    {                                                                                         \
+        Array *index_table = allocator_memory_resize(                                         \
+            allocator,                                                                        \
+            table->index_table,                                                               \
+            ARRAY_DATA_OFFSET + 8 * (uint64)table->_num_slots,                                \
+            ARRAY_DATA_OFFSET + 8 * (uint64)max_members                                       \
+        );                                                                                    \
+        if (index_table == NULL)                                                              \
+            return 1;                                                                         \
+        index_table->member_count = max_members;                                              \
+        table->index_table = index_table;                                                     \
+        table->_num_slots = max_members;                                                      \
+        name##_rehash(table);                                                                 \
+        return 0;                                                                             \
+    }
+
+
+#define C_UTILS_DEFINE_DICT(name, K, V, eq)                                                   \
+    C_UTILS_DEFINE_LIST(name##_keys, K)                                                       \
+    C_UTILS_DEFINE_LIST(name##_values, V)                                                     \
+                                                                                              \
+    typedef struct name                                                                       \
+    {                                                                                         \
+        uint32 _num_slots;                                                                    \
+        uint32 member_count;                                                                  \
+        Array *index_table;                                                                   \
+        name##_keys *keys;                                                                    \
+        name##_values *values;                                                                \
+    } name;                                                                                   \
+                                                                                              \
+    C_UTILS_DEFINE_HASH_INDEX(name, K, keys, eq)                                              \
+                                                                                              \
+    static inline name* name##_new(AllocatorInterface *allocator, uint32 max_members)        \
+    {                                                                                         \
+        return (name*)dict_new(allocator, max_members, sizeof(K), sizeof(V));               \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_destroy(name *dict, AllocatorInterface *allocator)             \
+    {                                                                                         \
+        dict_destroy((Dict*)dict, allocator);                                                 \
+    }                                                                                         \
+                                                                                              \
+    static inline Dict* name##_to_dict(name *dict)                                           \
+    {                                                                                         \
+        return (Dict*)dict;                                                                   \
+    }                                                                                         \
+                                                                                              \
+    static inline int name##_contains_key(name *dict, K key)                                 \
+    {                                                                                         \
+        return name##_find_slot(dict, key) >= 0;                                              \
+    }                                                                                         \
+                                                                                              \
+    /* Copy the value of the key into value. Returns 1 if found, 0 otherwise. */             \
+    static inline int name##_get(name *dict, K key, V *value)                                \
+    {                                                                                         \
+        int64 slot = name##_find_slot(dict, key);                                             \
+        if (slot < 0)                                                                         \
+            return 0;                                                                         \
+        *value = dict->values->data[((int64*)dict->index_table->data)[slot]];                 \
+        return 1;                                                                             \
+    }                                                                                         \
+                                                                                              \
+    /* Insert or update the key. Fails silently if the probe finds no free */                \
+    /* slot, keep the dict under 2/3 full as with dict_set. */                               \
+    static inline void name##_set(name *dict, K key, V value)                                \
+    {                                                                                         \
+        int64 slot = name##_find_slot(dict, key);                                             \
+        if (slot >= 0)                                                                        \
+        {                                                                                     \
+            dict->values->data[((int64*)dict->index_table->data)[slot]] = value;              \
+            return;                                                                           \
+        }                                                                                     \
+        if (dict->member_count >= dict->_num_slots)                                           \
+            return;                                                                           \
+        if (name##_link(dict, key, dict->member_count))                                       \
+            return;                                                                           \
+        name##_keys_append(dict->keys, key);                                                  \
+        name##_values_append(dict->values, value);                                            \
+        dict->member_count++;                                                                 \
+    }                                                                                         \
+                                                                                              \
+    /* Remove the key. Returns 1 if it was in the dict, 0 otherwise. */                      \
+    static inline int name##_remove(name *dict, K key)                                       \
+    {                                                                                         \
+        int64 slot = name##_find_slot(dict, key);                                             \
+        if (slot < 0)                                                                         \
+            return 0;                                                                         \
+        int64 *slots = (int64*)dict->index_table->data;                                       \
+        uint32 member = slots[slot];                                                          \
+        uint32 last = dict->member_count - 1;                                                 \
+        slots[slot] = DICT_REMOVED_SLOT;                                                      \
+        if (member != last)                                                                   \
+        {                                                                                     \
+            name##_relink(dict, last, member);                                                \
+            dict->keys->data[member] = dict->keys->data[last];                                \
+            dict->values->data[member] = dict->values->data[last];                            \
+        }                                                                                     \
+        dict->keys->member_count--;                                                           \
+        dict->values->member_count--;                                                         \
+        dict->member_count--;                                                                 \
+        return 1;                                                                             \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_foreach(name *dict, void (*func)(K*, V*))                      \
+    {                                                                                         \
+        for (uint32 i = 0; i < dict->member_count; i++)                                      \
+            func(&dict->keys->data[i], &dict->values->data[i]);                               \
+    }                                                                                         \
+                                                                                              \
+    /* Returns 1 and leaves the dict usable if out of memory or if */                        \
+    /* max_members is smaller than member_count, 0 otherwise. Like */                        \
+    /* dict_resize, the index shrinks before the lists and grows after. */                   \
+    static inline int name##_resize(name *dict, AllocatorInterface *allocator, uint32 max_members) \
+    {                                                                                         \
+        if (max_members < dict->member_count)                                                 \
+            return 1;                                                                         \
+        if (max_members < dict->_num_slots && name##_resize_index(dict, allocator, max_members)) \
+            return 1;                                                                         \
+        dict->keys = name##_keys_resize(dict->keys, allocator, max_members);                  \
+        dict->values = name##_values_resize(dict->values, allocator, max_members);            \
+        if (name##_keys_capacity(dict->keys) != max_members)                                  \
+            return 1;                                                                         \
+        if (name##_values_capacity(dict->values) != max_members)                              \
+            return 1;                                                                         \
+        if (max_members > dict->_num_slots)                                                   \
+            return name##_resize_index(dict, allocator, max_members);                         \
+        return 0;                                                                             \
+    }
+
+
+#define C_UTILS_DEFINE_SET(name, T, eq)                                                       \
+    C_UTILS_DEFINE_LIST(name##_items, T)                                                      \
+                                                                                              \
+    typedef struct name                                                                       \
+    {                                                                                         \
+        uint32 _num_slots;                                                                    \
+        uint32 member_count;                                                                  \
+        Array *index_table;                                                                   \
+        name##_items *items;                                                                  \
+    } name;                                                                                   \
+                                                                                              \
+    C_UTILS_DEFINE_HASH_INDEX(name, T, items, eq)                                             \
+                                                                                              \
+    static inline name* name##_new(AllocatorInterface *allocator, uint32 max_members)        \
+    {                                                                                         \
+        return (name*)set_new(allocator, max_members, sizeof(T));                            \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_destroy(name *set, AllocatorInterface *allocator)              \
+    {                                                                                         \
+        set_destroy((Set*)set, allocator);                                                    \
+    }                                                                                         \
+                                                                                              \
+    static inline Set* name##_to_set(name *set)                                              \
+    {                                                                                         \
+        return (Set*)set;                                                                     \
+    }                                                                                         \
+                                                                                              \
+    static inline int name##_contains_item(name *set, T item)                                \
+    {                                                                                         \
+        return name##_find_slot(set, item) >= 0;                                              \
+    }                                                                                         \
+                                                                                              \
+    /* Fails silently if the set already has the item or if the probe */                     \
+    /* finds no free slot, keep the set under 2/3 full as with set_add. */                   \
+    static inline void name##_add(name *set, T item)                                         \
+    {                                                                                         \
+        if (set->member_count >= set->_num_slots || name##_find_slot(set, item) >= 0)        \
+            return;                                                                           \
+        if (name##_link(set, item, set->member_count))                                        \
+            return;                                                                           \
+        name##_items_append(set->items, item);                                                \
+        set->member_count++;                                                                  \
+    }                                                                                         \
+                                                                                              \
+    /* Remove the item. Returns 1 if it was in the set, 0 otherwise. */                      \
+    static inline int name##_remove(name *set, T item)                                       \
+    {                                                                                         \
+        int64 slot = name##_find_slot(set, item);                                             \
+        if (slot < 0)                                                                         \
+            return 0;                                                                         \
+        int64 *slots = (int64*)set->index_table->data;                                        \
+        uint32 member = slots[slot];                                                          \
+        uint32 last = set->member_count - 1;                                                  \
+        slots[slot] = DICT_REMOVED_SLOT;                                                      \
+        if (member != last)                                                                   \
+        {                                                                                     \
+            name##_relink(set, last, member);                                                 \
+            set->items->data[member] = set->items->data[last];                                \
+        }                                                                                     \
+        set->items->member_count--;                                                           \
+        set->member_count--;                                                                  \
+        return 1;                                                                             \
+    }                                                                                         \
+                                                                                              \
+    static inline void name##_foreach(name *set, void (*func)(T*))                           \
+    {                                                                                         \
+        for (uint32 i = 0; i < set->member_count; i++)                                       \
+            func(&set->items->data[i]);                                                       \
+    }                                                                                         \
+                                                                                              \
+    /* Returns 1 and leaves the set usable if out of memory or if */                         \
+    /* max_members is smaller than member_count, 0 otherwise. Like */                        \
+    /* set_resize, the index shrinks before the items and grows after. */                    \
+    static inline int name##_resize(name *set, AllocatorInterface *allocator, uint32 max_members) \
+    {                                                                                         \
+        if (max_members < set->member_count)                                                  \
+            return 1;                                                                         \
+        if (max_members < set->_num_slots && name##_resize_index(set, allocator, max_members)) \
+            return 1;                                                                         \
+        set->items = name##_items_resize(set->items, allocator, max_members);                 \
+        if (name##_items_capacity(set->items) != max_members)                                 \
+            return 1;                                                                         \
+        if (max_members > set->_num_slots)                                                    \
+            return name##_resize_index(set, allocator, max_members);                          \
+        return 0;                                                                             \
+    }
+
+
 #endif
 
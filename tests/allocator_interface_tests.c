@@ -0,0 +1,158 @@
+int test_arena_allocator_interface(AllocatorInterface *allocator)
+{
+    int error = 0;
+    AllocatorInterface arena_interface;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(8));
+    arena_allocator_init_growing(arena_alloc, allocator->memory_allocate, 1024, 8);
+    arena_allocator_interface(&arena_interface, arena_alloc);
+
+    Dict *dict = dict_new(&arena_interface, 64, sizeof(uint64), sizeof(uint32));
+    Set *set = set_new(&arena_interface, 64, sizeof(uint32));
+    List *list = list_new(&arena_interface, 4, sizeof(uint64));
+    if (dict == NULL || set == NULL || list == NULL)
+        return 1;
+
+    for (uint32 i = 0; i < 32; i++)
+    {
+        uint64 key = i * 1000;
+        dict_set(dict, (uint8*)&key, (uint8*)&i);
+        set_add(set, (uint8*)&i);
+
+        if (list->member_count == (list->_allocated_space - LIST_DATA_OFFSET) / list->member_size)
+            list = list_resize(list, &arena_interface, list->member_count * 2);
+        list_append(list, (uint8*)&key);
+    }
+
+    if (((uint64) list->data) % ALLOCATOR_DEFAULT_ALIGNMENT != 0 || list->member_count != 32)
+        error = 1;
+
+    for (uint32 i = 0; i < 32; i++)
+    {
+        uint64 key = i * 1000;
+        uint64 list_value;
+        uint32 value = 0;
+        dict_get(dict, (uint8*)&key, (uint8*)&value);
+        list_get(list, i, (uint8*)&list_value);
+        if (value != i || !set_contains_item(set, (uint8*)&i) || list_value != key)
+            error = 1;
+    }
+
+    // Destroying is a no-op, everything is reclaimed at once with the reset.
+    dict_destroy(dict, &arena_interface);
+    set_destroy(set, &arena_interface);
+    list_destroy(list, &arena_interface);
+    arena_allocator_reset(arena_alloc);
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return error;
+}
+
+
+int test_bump_allocator_interface(AllocatorInterface *allocator)
+{
+    int error = 0;
+    AllocatorInterface bump_interface;
+    uint32 bump_alloc_size = bump_allocator_size(1024);
+    BumpAllocator *bump_alloc = allocator->memory_allocate(bump_alloc_size);
+    bump_allocator_init(bump_alloc, 1024);
+    bump_allocator_interface(&bump_interface, bump_alloc);
+
+    Array *array = array_new(&bump_interface, 3, 1);
+    Array *aligned = array_new(&bump_interface, 4, sizeof(uint64));
+    if (array == NULL || aligned == NULL)
+        return 1;
+
+    if (((uint64) aligned->data) % sizeof(uint64) != 0)
+        error = 1;
+
+    uint64 mark = bump_allocator_mark(bump_alloc);
+    if (array_new(&bump_interface, 1024, 1) != NULL)
+        error = 1;
+
+    Array *reversed = array_reverse(aligned, &bump_interface);
+    if (reversed == NULL)
+        error = 1;
+
+    bump_allocator_rewind(bump_alloc, mark);
+    if (array_new(&bump_interface, 4, sizeof(uint64)) != reversed)
+        error = 1;
+
+    allocator->memory_free(bump_alloc, bump_alloc_size);
+    return error;
+}
+
+
+int test_allocator_recorder(AllocatorInterface *allocator)
+{
+    int error = 0;
+    AllocatorRecorder recorder;
+    AllocatorInterface recording_interface;
+    allocator_recorder_init(&recorder, allocator, allocator);
+    allocator_recorder_interface(&recording_interface, &recorder);
+
+    Dict *dict = dict_new(&recording_interface, 16, sizeof(uint32), sizeof(uint32));
+    List *lists[8];
+    for (uint32 i = 0; i < 8; i++)
+        lists[i] = list_new(&recording_interface, 1, sizeof(uint64));
+    for (uint32 n = 2; n <= 64; n *= 2)
+    {
+        for (uint32 i = 0; i < 8; i++)
+            lists[i] = list_resize(lists[i], &recording_interface, n);
+    }
+    for (uint32 i = 0; i < 8; i++)
+        list_destroy(lists[i], &recording_interface);
+
+    AllocatorTraceEvent *events = recorder.events;
+    error |= recorder.failed || recorder.live_count == 0;
+    error |= events[0].operation != ALLOCATOR_TRACE_ALLOCATE;
+
+    // The lists keep their ids through every resize.
+    uint32 list_id = recorder.next_id - 8;
+    uint32 resizes = 0, frees = 0;
+    for (uint64 i = 0; i < recorder.event_count; i++)
+    {
+        if (events[i].id != list_id)
+            continue;
+        resizes += events[i].operation == ALLOCATOR_TRACE_RESIZE;
+        frees += events[i].operation == ALLOCATOR_TRACE_FREE;
+    }
+    error |= resizes != 6 || frees != 1;
+
+    dict_destroy(dict, &recording_interface);
+    error |= recorder.live_count != 0;
+
+    // The trace replays into a different allocator.
+    AllocatorInterface arena_interface;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(8));
+    arena_allocator_init_growing(arena_alloc, allocator->memory_allocate, 1024, 8);
+    arena_allocator_interface(&arena_interface, arena_alloc);
+    error |= allocator_trace_replay(recorder.events, recorder.event_count, &arena_interface, allocator) != 0;
+
+    // Traces with unknown operations or ids outside the trace are not run.
+    AllocatorTraceEvent invalid[2] = { { ALLOCATOR_TRACE_ALLOCATE, 0, 16 }, { ALLOCATOR_TRACE_FREE, 0xFFFFFFFF, 16 } };
+    error |= allocator_trace_replay(invalid, 2, &arena_interface, allocator) != 2;
+    invalid[1].id = 0;
+    invalid[1].operation = 7;
+    error |= allocator_trace_replay(invalid, 2, &arena_interface, allocator) != 2;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    allocator_recorder_destroy(&recorder);
+
+    // A resize the target could not do is not part of the trace.
+    AllocatorInterface bump_interface;
+    BumpAllocator *bump = allocator->memory_allocate(bump_allocator_size(256));
+    bump_allocator_init(bump, 256);
+    bump_allocator_interface(&bump_interface, bump);
+    allocator_recorder_init(&recorder, &bump_interface, allocator);
+    allocator_recorder_interface(&recording_interface, &recorder);
+
+    void *memory = allocator_memory_allocate(&recording_interface, 64);
+    error |= allocator_memory_resize(&recording_interface, memory, 64, 4096) != NULL;
+    allocator_memory_free(&recording_interface, memory, 64);
+    error |= recorder.event_count != 2 || recorder.events[1].operation != ALLOCATOR_TRACE_FREE;
+    error |= recorder.live_count != 0;
+
+    allocator_recorder_destroy(&recorder);
+    allocator->memory_free(bump, bump_allocator_size(256));
+    return error;
+}
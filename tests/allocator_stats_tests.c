@@ -0,0 +1,159 @@
+#ifdef C_UTILS_ALLOCATOR_STATS
+
+int test_bump_allocator_stats(AllocatorInterface *allocator)
+{
+    int error = 0;
+    AllocatorStats stats;
+    uint64 bump_alloc_size = bump_allocator_size(1024);
+    BumpAllocator *bump_alloc = allocator->memory_allocate(bump_alloc_size);
+    bump_allocator_init(bump_alloc, 1024);
+
+    bump_allocator_memory_allocate(bump_alloc, 100);
+    bump_allocator_memory_allocate_aligned(bump_alloc, 10, 16);
+    bump_allocator_memory_allocate(bump_alloc, 2000);
+    bump_allocator_stats(bump_alloc, &stats);
+
+    error |= stats.bytes_requested != 110;
+    error |= stats.bytes_used != (uint64)(bump_alloc->end_index) || stats.bytes_used < 110;
+    error |= stats.bytes_reserved != 1024;
+    error |= stats.allocations != 2 || stats.failed_allocations != 1;
+
+    // The peak is kept after rewinding, until the next reset.
+    uint64 used = stats.bytes_used;
+    bump_allocator_rewind(bump_alloc, 0);
+    bump_allocator_stats(bump_alloc, &stats);
+    error |= stats.bytes_used != 0 || stats.peak_bytes_used != used;
+
+    bump_allocator_reset(bump_alloc);
+    bump_allocator_stats(bump_alloc, &stats);
+    error |= stats.peak_bytes_used != 0 || stats.bytes_requested != 0 || stats.failed_allocations != 1;
+
+    allocator->memory_free(bump_alloc, bump_alloc_size);
+    return error;
+}
+
+
+int test_arena_allocator_stats(AllocatorInterface *allocator)
+{
+    int error = 0;
+    AllocatorStats stats;
+    ArenaAllocatorMark mark;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(4));
+    arena_allocator_init(arena_alloc, allocator->memory_allocate, 1024, 4);
+
+    arena_allocator_memory_allocate(arena_alloc, 1000);
+    arena_allocator_mark(arena_alloc, &mark);
+    arena_allocator_memory_allocate(arena_alloc, 1000);
+    arena_allocator_memory_allocate(arena_alloc, 2000);
+    arena_allocator_stats(arena_alloc, &stats);
+
+    error |= stats.bytes_requested != 2000 || stats.bytes_used != 2000;
+    error |= stats.bytes_reserved != 2048 || stats.num_arenas != 2;
+    // The 24 bytes left in the first arena, the second arena has the largest free space.
+    error |= stats.fragmented_bytes != 24;
+    error |= stats.allocations != 2 || stats.failed_allocations != 1;
+
+    // Fill of a single arena.
+    bump_allocator_stats(arena_alloc->arenas[0], &stats);
+    error |= stats.bytes_used != 1000 || stats.bytes_reserved != 1024 || stats.failed_allocations != 1;
+
+    arena_allocator_rewind(arena_alloc, &mark);
+    arena_allocator_stats(arena_alloc, &stats);
+    error |= stats.bytes_used != 1000 || stats.peak_bytes_used != 2000;
+
+    arena_allocator_reset(arena_alloc);
+    arena_allocator_stats(arena_alloc, &stats);
+    error |= stats.bytes_used != 0 || stats.peak_bytes_used != 0 || stats.bytes_reserved != 2048;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+
+    // bytes_used is counted as memory is handed out and given back,
+    // it matches the fill of the arenas and the chunks in use.
+    AllocatorInterface arena_interface;
+    arena_alloc = allocator->memory_allocate(arena_allocator_size(4));
+    arena_allocator_init_growing(arena_alloc, allocator->memory_allocate, 256, 4);
+    arena_allocator_interface(&arena_interface, arena_alloc);
+
+    List *list = list_new(&arena_interface, 4, sizeof(uint64));
+    arena_allocator_memory_allocate_aligned(arena_alloc, 3, 1);
+    arena_allocator_mark(arena_alloc, &mark);
+    for (uint32 i = 0; i < 20; i++)
+        arena_allocator_memory_allocate_aligned(arena_alloc, 40, 32);
+    void *chunk = allocator_memory_allocate(&arena_interface, 5000);
+    void *newest = allocator_memory_allocate(&arena_interface, 64);
+    newest = allocator_memory_resize(&arena_interface, newest, 64, 16);
+    allocator_memory_free(&arena_interface, newest, 16);
+    allocator_memory_free(&arena_interface, chunk, 5000);
+
+    uint64 bytes_used = 0;
+    for (uint32 i = 0; i < arena_alloc->num_arenas; i++)
+        bytes_used += arena_alloc->arenas[i]->end_index;
+    for (ArenaChunk *arena_chunk = arena_alloc->chunks; arena_chunk != NULL; arena_chunk = arena_chunk->next)
+        bytes_used += arena_chunk->size;
+    arena_allocator_stats(arena_alloc, &stats);
+    error |= arena_alloc->chunks == NULL || stats.bytes_used != bytes_used;
+
+    uint64 peak_bytes_used = stats.bytes_used;
+    arena_allocator_rewind(arena_alloc, &mark);
+    arena_allocator_stats(arena_alloc, &stats);
+    error |= stats.bytes_used != LIST_DATA_OFFSET + 4 * sizeof(uint64) + 3 || stats.peak_bytes_used < peak_bytes_used;
+
+    list_destroy(list, &arena_interface);
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return error;
+}
+
+
+int test_pool_allocator_stats(AllocatorInterface *allocator)
+{
+    int error = 0;
+    void *blocks[5];
+    AllocatorStats stats;
+    PoolAllocator *pool = allocator->memory_allocate(sizeof(PoolAllocator));
+    pool_allocator_init(pool, allocator->memory_allocate, 16, 4);
+
+    for (uint32 i = 0; i < 5; i++)
+        blocks[i] = pool_allocator_memory_allocate(pool);
+    pool_allocator_memory_free(pool, blocks[4]);
+    pool_allocator_stats(pool, &stats);
+
+    error |= stats.bytes_used != 64 || stats.peak_bytes_used != 80;
+    error |= stats.bytes_reserved != 128 || stats.allocations != 5;
+
+    pool_allocator_reset(pool);
+    pool_allocator_stats(pool, &stats);
+    error |= stats.bytes_used != 0 || stats.bytes_reserved != 128;
+
+    pool_allocator_destroy(pool, allocator->memory_free);
+    return error;
+}
+
+
+int test_tlsf_allocator_stats(AllocatorInterface *allocator)
+{
+    int error = 0;
+    AllocatorStats stats;
+    const uint64 region_size = 64 * 1024;
+    TlsfAllocator *tlsf = allocator->memory_allocate(sizeof(TlsfAllocator));
+    uint8 *region = allocator->memory_allocate(region_size);
+    tlsf_allocator_init(tlsf, region, region_size);
+
+    uint8 *a = tlsf_allocator_memory_allocate(tlsf, 100);
+    tlsf_allocator_memory_allocate(tlsf, 1000);
+    tlsf_allocator_memory_allocate(tlsf, region_size);
+    tlsf_allocator_memory_free(tlsf, a);
+    tlsf_allocator_stats(tlsf, &stats);
+
+    error |= stats.bytes_requested != 1100 || stats.allocations != 2 || stats.failed_allocations != 1;
+    error |= stats.bytes_used != 1008 + TLSF_BLOCK_HEADER_SIZE;
+    error |= stats.peak_bytes_used != 112 + 1008 + 2 * TLSF_BLOCK_HEADER_SIZE;
+    error |= stats.bytes_reserved != region_size;
+    // The freed 112 byte block is separated from the rest of the region.
+    error |= stats.fragmented_bytes != 112;
+
+    allocator->memory_free(region, region_size);
+    allocator->memory_free(tlsf, sizeof(TlsfAllocator));
+    return error;
+}
+
+#endif
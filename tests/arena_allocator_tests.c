@@ -98,4 +98,478 @@ int test_arena_allocator_size_check(AllocatorInterface *allocator)
     cleanup:
         arena_allocator_destroy(arena_alloc, allocator->memory_free);
     return error;
-}
\ No newline at end of file
+}
+
+int test_arena_allocator_aligned_allocation(AllocatorInterface *allocator)
+{
+    uint8 *memory;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(4));
+    arena_allocator_init(arena_alloc, allocator->memory_allocate, 256, 4);
+
+    for (uint32 i = 0; i < 12; i++)
+    {
+        arena_allocator_memory_allocate(arena_alloc, 3);
+        memory = arena_allocator_memory_allocate_aligned(arena_alloc, 40, PLATFORM_CACHE_LINE_SIZE);
+        if (memory == NULL || ((uint64) memory) % PLATFORM_CACHE_LINE_SIZE != 0)
+            return 1;
+    }
+
+    if (arena_alloc->num_arenas < 2)
+        return 1;
+
+    if (arena_allocator_memory_allocate_aligned(arena_alloc, 8, 24) != NULL)
+        return 1;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return 0;
+}
+
+
+int test_arena_allocator_current_arena(AllocatorInterface *allocator)
+{
+    uint8 *memory;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(4));
+    arena_allocator_init(arena_alloc, allocator->memory_allocate, 1024, 4);
+
+    arena_allocator_memory_allocate(arena_alloc, 1000);
+    arena_allocator_memory_allocate(arena_alloc, 1000);
+    if (arena_alloc->num_arenas != 2 || arena_alloc->current_arena != 0)
+        return 1;
+
+    // Still fits into the current arena.
+    memory = arena_allocator_memory_allocate(arena_alloc, 20);
+    if (memory != arena_alloc->arenas[0]->buffer + 1000)
+        return 1;
+
+    // Does not fit into the current arena anymore,
+    // the space left in the spill arena is used instead.
+    memory = arena_allocator_memory_allocate(arena_alloc, 20);
+    if (memory != arena_alloc->arenas[1]->buffer + 1000 || arena_alloc->num_arenas != 2)
+        return 1;
+
+    arena_allocator_reset(arena_alloc);
+    memory = arena_allocator_memory_allocate(arena_alloc, 1000);
+    if (memory != arena_alloc->arenas[0]->buffer)
+        return 1;
+
+    // Arenas left over from before the reset are reused in order.
+    memory = arena_allocator_memory_allocate(arena_alloc, 1000);
+    if (memory != arena_alloc->arenas[1]->buffer || arena_alloc->num_arenas != 2)
+        return 1;
+
+    // Once max_arenas is reached, misses only look at the free index and
+    // the arenas themselves, and no arena is recorded in the index twice.
+    arena_allocator_memory_allocate(arena_alloc, 1000);
+    arena_allocator_memory_allocate(arena_alloc, 1000);
+    if (arena_alloc->num_arenas != 4 || arena_alloc->current_arena != 2)
+        return 1;
+
+    for (uint32 i = 0; i < 3; i++)
+    {
+        if (arena_allocator_memory_allocate(arena_alloc, 100) != NULL)
+            return 1;
+    }
+
+    for (uint32 i = 0; i < ARENA_ALLOCATOR_FREE_INDEX_SIZE; i++)
+    {
+        for (uint32 j = i + 1; j < ARENA_ALLOCATOR_FREE_INDEX_SIZE; j++)
+        {
+            if (arena_alloc->free_index[i].free_space > 0 && arena_alloc->free_index[j].free_space > 0
+                && arena_alloc->free_index[i].arena_index == arena_alloc->free_index[j].arena_index)
+                return 1;
+        }
+    }
+
+    if (arena_allocator_memory_allocate(arena_alloc, 24) != arena_alloc->arenas[3]->buffer + 1000)
+        return 1;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return 0;
+}
+
+
+int test_arena_allocator_growing(AllocatorInterface *allocator)
+{
+    uint8 *memory, *chunk_memory;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(8));
+    arena_allocator_init_growing(arena_alloc, allocator->memory_allocate, 64, 8);
+
+    for (uint32 i = 0; i < 7; i++)
+    {
+        memory = arena_allocator_memory_allocate(arena_alloc, 32);
+        if (memory == NULL)
+            return 1;
+    }
+
+    // 64 + 128 + 256 bytes hold the seven allocations.
+    if (arena_alloc->num_arenas != 3 || arena_alloc->arenas[2]->buffer_size != 256)
+        return 1;
+
+    chunk_memory = arena_allocator_memory_allocate_aligned(arena_alloc, 10000, PLATFORM_CACHE_LINE_SIZE);
+    if (chunk_memory == NULL || ((uint64) chunk_memory) % PLATFORM_CACHE_LINE_SIZE != 0)
+        return 1;
+
+    if (arena_alloc->chunks == NULL || arena_alloc->num_arenas != 3)
+        return 1;
+    memset(chunk_memory, 0xAB, 10000);
+
+    // Reset keeps the chunk and hands it to the next oversized request that fits.
+    arena_allocator_reset(arena_alloc);
+    if (arena_alloc->chunks != NULL || arena_alloc->free_chunks == NULL)
+        return 1;
+    ArenaChunk *recycled = arena_alloc->free_chunks;
+
+    // A chunk more than twice the request is not pinned by it.
+    memory = arena_allocator_memory_allocate(arena_alloc, 4000);
+    if (memory == NULL || arena_alloc->free_chunks == NULL || arena_alloc->chunks == NULL)
+        return 1;
+
+    memory = arena_allocator_memory_allocate(arena_alloc, 6000);
+    if (memory == NULL || arena_alloc->chunks != recycled || arena_alloc->free_chunks != NULL)
+        return 1;
+
+    memory = arena_allocator_memory_allocate(arena_alloc, 20000);
+    if (memory == NULL || arena_alloc->chunks->next == NULL)
+        return 1;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return 0;
+}
+
+
+static uint8 misaligned_memory[1 << 16] __attribute__((aligned(16)));
+static uint64 misaligned_memory_used;
+
+// Hands out memory that is aligned to 8 bytes but never to 16.
+static void* misaligned_get_memory(uint64 size)
+{
+    uint8 *memory = misaligned_memory + misaligned_memory_used + 8;
+    if (misaligned_memory_used + size + 32 > sizeof(misaligned_memory))
+        return NULL;
+    misaligned_memory_used += (size + 8 + 15) & ~(uint64)15;
+    return memory;
+}
+
+
+static void misaligned_free_memory(void *memory, uint64 size)
+{
+}
+
+
+int test_arena_allocator_chunk_padding(AllocatorInterface *allocator)
+{
+    uint8 *memory;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(2));
+    misaligned_memory_used = 0;
+    arena_allocator_init_growing(arena_alloc, misaligned_get_memory, 64, 2);
+
+    // Padding the chunk memory to the alignment stays inside the chunk.
+    memory = arena_allocator_memory_allocate_aligned(arena_alloc, 1000, ALLOCATOR_DEFAULT_ALIGNMENT);
+    if (memory == NULL || (uint64)memory % ALLOCATOR_DEFAULT_ALIGNMENT != 0)
+        return 1;
+
+    ArenaChunk *chunk = arena_alloc->chunks;
+    if (chunk == NULL || memory + 1000 > chunk->memory + chunk->size)
+        return 1;
+
+    // A recycled chunk is reused only if the padding fits as well.
+    arena_allocator_reset(arena_alloc);
+    memory = arena_allocator_memory_allocate_aligned(arena_alloc, chunk->size, ALLOCATOR_DEFAULT_ALIGNMENT);
+    if (memory == NULL || arena_alloc->chunks == chunk || arena_alloc->free_chunks != chunk)
+        return 1;
+
+    memory = arena_allocator_memory_allocate_aligned(arena_alloc, chunk->size - 8, ALLOCATOR_DEFAULT_ALIGNMENT);
+    if (memory == NULL || arena_alloc->chunks != chunk)
+        return 1;
+
+    arena_allocator_destroy(arena_alloc, misaligned_free_memory);
+    allocator->memory_free(arena_alloc, arena_allocator_size(2));
+    return 0;
+}
+
+
+int test_arena_allocator_mark_rewind(AllocatorInterface *allocator)
+{
+    uint8 *before, *memory;
+    ArenaAllocatorMark mark;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(8));
+    arena_allocator_init_growing(arena_alloc, allocator->memory_allocate, 1024, 8);
+
+    arena_allocator_memory_allocate(arena_alloc, 900);
+    arena_allocator_memory_allocate(arena_alloc, 900);
+    before = arena_allocator_memory_allocate(arena_alloc, 16);
+    arena_allocator_mark(arena_alloc, &mark);
+
+    // Scratch allocations spread over the current arena, the free index,
+    // new arenas and a dedicated chunk.
+    for (uint32 i = 0; i < 100; i++)
+    {
+        memory = arena_allocator_memory_allocate(arena_alloc, 100);
+        if (memory == NULL)
+            return 1;
+    }
+    if (arena_allocator_memory_allocate(arena_alloc, 1 << 20) == NULL)
+        return 1;
+
+    arena_allocator_rewind(arena_alloc, &mark);
+    if (arena_alloc->current_arena != 0 || arena_alloc->arenas[0]->end_index != 916)
+        return 1;
+
+    if (arena_alloc->arenas[1]->end_index != 900 || arena_alloc->arenas[2]->end_index != 0)
+        return 1;
+
+    if (arena_alloc->chunks != NULL || arena_alloc->free_chunks == NULL)
+        return 1;
+
+    memory = arena_allocator_memory_allocate(arena_alloc, 16);
+    if (memory != before + 16)
+        return 1;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+
+    // With max_arenas reached, allocations after the mark only go to the
+    // current arena, the spill arena and the free index, which the mark records.
+    arena_alloc = allocator->memory_allocate(arena_allocator_size(6));
+    arena_allocator_init(arena_alloc, allocator->memory_allocate, 1024, 6);
+    for (uint32 i = 0; i < 6; i++)
+        arena_allocator_memory_allocate(arena_alloc, 1000);
+    arena_allocator_mark(arena_alloc, &mark);
+
+    uint32 count = 0;
+    while (arena_allocator_memory_allocate(arena_alloc, 20) != NULL)
+        count++;
+    if (count != 2 + ARENA_ALLOCATOR_FREE_INDEX_SIZE)
+        return 1;
+
+    arena_allocator_rewind(arena_alloc, &mark);
+    for (uint32 i = 0; i < 6; i++)
+    {
+        if (arena_alloc->arenas[i]->end_index != 1000)
+            return 1;
+    }
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return 0;
+}
+
+
+int test_arena_allocator_resize(AllocatorInterface *allocator)
+{
+    uint8 *memory, *resized;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(4));
+    arena_allocator_init(arena_alloc, allocator->memory_allocate, 1024, 4);
+
+    memory = arena_allocator_memory_allocate(arena_alloc, 100);
+    resized = arena_allocator_memory_resize(arena_alloc, memory, 100, 1000);
+    if (resized != memory || arena_alloc->arenas[0]->end_index != 1000)
+        return 1;
+
+    // Not the newest allocation anymore, so it is moved into the next arena.
+    arena_allocator_memory_allocate(arena_alloc, 10);
+    memset(memory, 0x22, 1000);
+    resized = arena_allocator_memory_resize(arena_alloc, memory, 1000, 1008);
+    if (resized != arena_alloc->arenas[1]->buffer || resized[999] != 0x22 || arena_alloc->used_arenas != 2)
+        return 1;
+
+    // The newest allocation of the spill arena grows in place there.
+    memory = resized;
+    resized = arena_allocator_memory_resize(arena_alloc, memory, 1008, 1024);
+    if (resized != memory || arena_alloc->arenas[1]->end_index != 1024)
+        return 1;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return 0;
+}
+
+
+typedef struct ArenaCacheTest
+{
+    ArenaCache cache;
+    uint8 *memory[CONCURRENT_TEST_ALLOCATIONS];
+    uint32 thread_id;
+} ArenaCacheTest;
+
+
+static void* arena_cache_allocate(void *argument)
+{
+    ArenaCacheTest *test = argument;
+    for (uint32 i = 0; i < CONCURRENT_TEST_ALLOCATIONS; i++)
+    {
+        test->memory[i] = arena_cache_memory_allocate_aligned(&test->cache, 24, 8);
+        if (test->memory[i] != NULL)
+            memset(test->memory[i], test->thread_id, 24);
+    }
+    return NULL;
+}
+
+
+int test_arena_cache_concurrent_allocation(AllocatorInterface *allocator)
+{
+    int error = 0;
+    pthread_t threads[CONCURRENT_TEST_THREADS];
+    ArenaCacheTest tests[CONCURRENT_TEST_THREADS];
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(16));
+    arena_allocator_init_growing(arena_alloc, allocator->memory_allocate, 4096, 16);
+
+    for (uint32 i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        arena_cache_init(&tests[i].cache, arena_alloc, 1000);
+        tests[i].thread_id = i;
+        pthread_create(&threads[i], NULL, arena_cache_allocate, &tests[i]);
+    }
+    for (uint32 i = 0; i < CONCURRENT_TEST_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    // Refills are cache line sized and aligned, and no allocation was overwritten.
+    error |= tests[0].cache.refill_size != 1024;
+    for (uint32 i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        for (uint32 j = 0; j < CONCURRENT_TEST_ALLOCATIONS; j++)
+        {
+            uint8 *memory = tests[i].memory[j];
+            if (memory == NULL || ((uint64)memory & 7) != 0)
+            {
+                error = 1;
+                continue;
+            }
+            for (uint32 k = 0; k < 24; k++)
+                error |= memory[k] != i;
+        }
+    }
+
+    // Resetting the parent drops the slices of every cache.
+    arena_allocator_reset(arena_alloc);
+    uint8 *memory = arena_cache_memory_allocate(&tests[1].cache, 8);
+    error |= memory - arena_alloc->arenas[0]->buffer >= PLATFORM_CACHE_LINE_SIZE;
+    error |= ((uint64)memory & (PLATFORM_CACHE_LINE_SIZE - 1)) != 0;
+    error |= tests[0].cache.next == NULL;
+    error |= arena_cache_memory_allocate(&tests[0].cache, 8) != memory + 1024;
+
+    // Large requests that do not fit keep the rest of the slice.
+    error |= arena_cache_memory_allocate(&tests[0].cache, 600) != memory + 1032;
+    error |= arena_cache_memory_allocate(&tests[0].cache, 600) != memory + 2048;
+    error |= tests[0].cache.next != memory + 1632;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return error;
+}
+
+
+static ArenaAllocator *unlocked_parent;
+static uint32 locked_get_memory_calls;
+
+// Counts the calls made while the parent of the caches is locked.
+static void* unlocked_get_memory(uint64 size)
+{
+    if (unlocked_parent != NULL && __atomic_load_n(&unlocked_parent->lock, __ATOMIC_RELAXED) != 0)
+        locked_get_memory_calls++;
+    return malloc(size);
+}
+
+
+static void unlocked_free_memory(void *memory, uint64 size)
+{
+    free(memory);
+}
+
+
+int test_arena_cache_refill_unlocked(AllocatorInterface *allocator)
+{
+    int error = 0;
+    ArenaCache cache;
+    unlocked_parent = NULL;
+    locked_get_memory_calls = 0;
+    ArenaAllocator *arena_alloc = malloc(arena_allocator_size(4));
+    arena_allocator_init_growing(arena_alloc, unlocked_get_memory, 1024, 4);
+    unlocked_parent = arena_alloc;
+    arena_cache_init(&cache, arena_alloc, 512);
+
+    // Refills grow the parent with new arenas and a dedicated chunk.
+    for (uint32 i = 0; i < 64; i++)
+        error |= arena_cache_memory_allocate(&cache, 200) == NULL;
+    error |= arena_cache_memory_allocate(&cache, 100000) == NULL;
+    error |= arena_alloc->num_arenas < 2 || arena_alloc->chunks == NULL;
+    error |= locked_get_memory_calls != 0;
+
+    // The cache line read by every cache allocation is not shared with the refill state.
+    error |= (uint8*)&arena_alloc->generation + PLATFORM_CACHE_LINE_SIZE > (uint8*)&arena_alloc->num_arenas;
+
+    unlocked_parent = NULL;
+    arena_allocator_destroy(arena_alloc, unlocked_free_memory);
+    return error;
+}
+
+
+int test_arena_cache_interface(AllocatorInterface *allocator)
+{
+    AllocatorInterface cache_allocator;
+    ArenaCache cache;
+    ArenaAllocator *arena_alloc = allocator->memory_allocate(arena_allocator_size(4));
+    arena_allocator_init_growing(arena_alloc, allocator->memory_allocate, 4096, 4);
+    arena_cache_init(&cache, arena_alloc, 512);
+    arena_cache_interface(&cache_allocator, &cache);
+
+    List *list = list_new(&cache_allocator, 4, sizeof(uint32));
+    for (uint32 i = 1; i <= 64; i++)
+        list = list_resize(list, &cache_allocator, i);
+    if (list == NULL || ((uint64)list & 15) != 0)
+        return 1;
+
+    // The list was the newest allocation of the slice and grew in place.
+    if (cache.next != (uint8*)list + LIST_DATA_OFFSET + 64 * sizeof(uint32))
+        return 1;
+
+    list_destroy(list, &cache_allocator);
+    if (cache.next != (uint8*)list)
+        return 1;
+
+    arena_allocator_destroy(arena_alloc, allocator->memory_free);
+    return 0;
+}
+
+
+int test_arena_allocator_mapped(AllocatorInterface *allocator)
+{
+    const uint64 arena_size = 16 * PLATFORM_PAGE_SIZE;
+    ArenaAllocator *arena_alloc = platform_memory_map(arena_allocator_size(4));
+    arena_allocator_init_with_flags(arena_alloc, platform_memory_map, arena_size, 4,
+        ARENA_ALLOCATOR_FLAG_GROWING | ARENA_ALLOCATOR_FLAG_RELEASE);
+
+    uint8 *first = arena_allocator_memory_allocate(arena_alloc, arena_size);
+    uint8 *second = arena_allocator_memory_allocate(arena_alloc, arena_size);
+    uint8 *chunk = arena_allocator_memory_allocate(arena_alloc, 16 * arena_size);
+    if (first == NULL || second == NULL || chunk == NULL || arena_alloc->used_arenas != 2)
+        return 1;
+
+    memset(first, 0x33, arena_size);
+    memset(second, 0x44, arena_size);
+    memset(chunk, 0x55, 16 * arena_size);
+
+    // Memory used by the batch stays resident for the next one.
+    arena_allocator_reset(arena_alloc);
+    if (first[PLATFORM_PAGE_SIZE] != 0x33 || second[PLATFORM_PAGE_SIZE] != 0x44 || chunk[PLATFORM_PAGE_SIZE] != 0x55)
+        return 1;
+
+    if (arena_allocator_memory_allocate(arena_alloc, 8) != first)
+        return 1;
+
+    // The second arena and the chunk stayed unused for a whole batch and are released,
+    // the first arena stays resident.
+    arena_allocator_reset(arena_alloc);
+    if (first[PLATFORM_PAGE_SIZE] != 0x33 || second[PLATFORM_PAGE_SIZE] != 0x00 || chunk[PLATFORM_PAGE_SIZE] != 0x00)
+        return 1;
+
+    if (arena_alloc->free_chunks != NULL || arena_alloc->released_chunks == NULL)
+        return 1;
+
+    // Released memory is taken into use again, and released only once.
+    if (arena_allocator_memory_allocate(arena_alloc, 16 * arena_size) != chunk || arena_alloc->released_chunks != NULL)
+        return 1;
+    second[0] = 0x66;
+    arena_allocator_reset(arena_alloc);
+    if (second[0] != 0x66 || arena_alloc->free_chunks == NULL)
+        return 1;
+
+    arena_allocator_destroy(arena_alloc, platform_memory_unmap);
+    return 0;
+}
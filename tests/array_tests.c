@@ -192,6 +192,430 @@ int test_array_sorting(AllocatorInterface *allocator)
 }
 
 
+// Inputs that drive a last-element pivot quicksort quadratic.
+int test_array_sorting_patterns(AllocatorInterface *allocator)
+{
+    const uint32 count = 20000;
+    Array *array = array_new(allocator, count, sizeof(int));
+    if (array == NULL)
+        return 1;
+
+    int *numbers = (int*)array->data;
+    for (uint32 pattern = 0; pattern < 5; pattern++)
+    {
+        int64 sum = 0;
+        srand(pattern);
+        for (uint32 i = 0; i < count; i++)
+        {
+            switch (pattern)
+            {
+                case 0: numbers[i] = i; break;
+                case 1: numbers[i] = count - i; break;
+                case 2: numbers[i] = 7; break;
+                case 3: numbers[i] = i % 100; break;
+                case 4: numbers[i] = rand() - RAND_MAX / 2; break;
+            }
+            sum += numbers[i];
+        }
+
+        array_sort(array, array_compare);
+        for (uint32 i = 0; i < count; i++)
+        {
+            sum -= numbers[i];
+            if (i > 0 && numbers[i - 1] > numbers[i])
+                return 1;
+        }
+        if (sum != 0)
+            return 1;
+    }
+
+    array_destroy(array, allocator);
+    return 0;
+}
+
+
+#define CHECK_SORTED(type, compare, value)                     \
+    do {                                                       \
+        Array *array = array_new(allocator, count, sizeof(type)); \
+        if (array == NULL)                                     \
+            return 1;                                          \
+        type *values = (type*)array->data;                     \
+        for (uint32 i = 0; i < count; i++)                     \
+            values[i] = (value);                               \
+        array_sort(array, compare);                            \
+        for (uint32 i = 1; i < count; i++)                     \
+            error |= values[i - 1] > values[i];                \
+        array_destroy(array, allocator);                       \
+    } while (0)
+
+
+int test_array_sort_builtin_comparators(AllocatorInterface *allocator)
+{
+    const uint32 count = 5000;
+    int error = 0;
+
+    srand(18);
+    CHECK_SORTED(int32, compare_int32, rand() - RAND_MAX / 2);
+    CHECK_SORTED(uint32, compare_uint32, (uint32)rand() << 1 | (rand() & 1));
+    CHECK_SORTED(int64, compare_int64, ((int64)rand() << 32) - ((int64)rand() << 16));
+    CHECK_SORTED(uint64, compare_uint64, (uint64)rand() << 33 | (uint64)rand());
+    CHECK_SORTED(float, compare_float32, (float)(rand() - RAND_MAX / 2) / 1000.0f);
+    CHECK_SORTED(double, compare_float64, (double)(rand() - RAND_MAX / 2) / 7.0);
+    return error;
+}
+
+#undef CHECK_SORTED
+
+
+static enum ComparisonResult compare_key(uint8 *a, uint8 *b)
+{
+    uint16 a_key, b_key;
+    memcpy(&a_key, a, sizeof(uint16));
+    memcpy(&b_key, b, sizeof(uint16));
+    if (a_key > b_key)
+        return COMPARISON_RESULT_FIRST_IS_LARGER;
+    if (a_key < b_key)
+        return COMPARISON_RESULT_FIRST_IS_SMALLER;
+    return COMPARISON_RESULT_ARE_EQUAL;
+}
+
+
+int test_array_sort_member_sizes(AllocatorInterface *allocator)
+{
+    const uint32 sizes[] = { 3, 4, 8, 12, 16, 40 };
+    const uint32 count = 3000;
+
+    srand(3);
+    for (uint32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        uint32 size = sizes[s];
+        Array *array = array_new(allocator, count, size);
+        if (array == NULL)
+            return 1;
+
+        for (uint32 i = 0; i < count; i++)
+        {
+            uint8 *member = array->data + i * size;
+            uint16 key = rand() % 1000;
+            memcpy(member, &key, sizeof(uint16));
+            for (uint32 j = 2; j < size; j++)
+                member[j] = (uint8)(key + j);
+        }
+
+        array_sort(array, compare_key);
+        uint16 previous = 0;
+        for (uint32 i = 0; i < count; i++)
+        {
+            uint8 *member = array->data + i * size;
+            uint16 key;
+            memcpy(&key, member, sizeof(uint16));
+            if (key < previous)
+                return 1;
+            for (uint32 j = 2; j < size; j++)
+                if (member[j] != (uint8)(key + j))
+                    return 1;
+            previous = key;
+        }
+        array_destroy(array, allocator);
+    }
+    return 0;
+}
+
+
+static enum ComparisonResult compare_stable_key(uint8 *a, uint8 *b)
+{
+    uint32 a_key = *(uint32*)a / 4;
+    uint32 b_key = *(uint32*)b / 4;
+    if (a_key > b_key)
+        return COMPARISON_RESULT_FIRST_IS_LARGER;
+    if (a_key < b_key)
+        return COMPARISON_RESULT_FIRST_IS_SMALLER;
+    return COMPARISON_RESULT_ARE_EQUAL;
+}
+
+
+int test_array_sort_stable(AllocatorInterface *allocator)
+{
+    const uint32 sizes[] = { 8, 16, 24 };
+    const uint32 counts[] = { 1, 20, 5000 };
+    int error = 0;
+
+    srand(20);
+    for (uint32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    for (uint32 c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    for (uint32 pattern = 0; pattern < 4; pattern++)
+    {
+        uint32 size = sizes[s];
+        uint32 count = counts[c];
+        Array *array = array_new(allocator, count, size);
+        if (array == NULL)
+            return 1;
+
+        // The key is the first uint32 divided by 4, the second uint32 is
+        // the original position of the member.
+        for (uint32 i = 0; i < count; i++)
+        {
+            uint32 *member = (uint32*)(array->data + i * size);
+            switch (pattern)
+            {
+                case 0: member[0] = rand() % 1000; break;
+                case 1: member[0] = i; break;
+                case 2: member[0] = count - i; break;
+                case 3: member[0] = i % 50 == 0 ? rand() % count : i; break;
+            }
+            member[1] = i;
+        }
+
+        error |= array_sort_stable(array, allocator, compare_stable_key);
+        for (uint32 i = 1; i < count; i++)
+        {
+            uint32 *previous = (uint32*)(array->data + (i - 1) * size);
+            uint32 *member = (uint32*)(array->data + i * size);
+            enum ComparisonResult order = compare_stable_key((uint8*)previous, (uint8*)member);
+            error |= order == COMPARISON_RESULT_FIRST_IS_LARGER;
+            error |= order == COMPARISON_RESULT_ARE_EQUAL && previous[1] > member[1];
+        }
+        array_destroy(array, allocator);
+    }
+
+    List *list = list_new(allocator, 100, sizeof(uint32));
+    for (uint32 i = 0; i < 100; i++)
+    {
+        uint32 value = 100 - i;
+        list_append(list, (uint8*)&value);
+    }
+    error |= list_sort_stable(list, allocator, compare_uint32);
+    for (uint32 i = 0; i < 100; i++)
+        error |= ((uint32*)list->data)[i] != i + 1;
+    list_destroy(list, allocator);
+    return error;
+}
+
+
+typedef struct TestWorkerPool
+{
+    uint32 thread_count;
+    uint32 next;
+    uint32 count;
+    void (*task)(void*, uint32);
+    void *argument;
+} TestWorkerPool;
+
+
+static void* test_worker_pool_thread(void *context)
+{
+    TestWorkerPool *pool = context;
+    uint32 index;
+    while ((index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->count)
+        pool->task(pool->argument, index);
+    return NULL;
+}
+
+
+static void test_worker_pool_run(void *context, void (*task)(void*, uint32), void *argument, uint32 count)
+{
+    TestWorkerPool *pool = context;
+    pthread_t threads[8];
+
+    pool->next = 0;
+    pool->count = count;
+    pool->task = task;
+    pool->argument = argument;
+    for (uint32 i = 0; i < pool->thread_count; i++)
+        pthread_create(&threads[i], NULL, test_worker_pool_thread, pool);
+    for (uint32 i = 0; i < pool->thread_count; i++)
+        pthread_join(threads[i], NULL);
+}
+
+
+int test_array_sort_parallel(AllocatorInterface *allocator)
+{
+    const uint32 workers[] = { 2, 3, 4, 7 };
+    const uint32 sizes[] = { 8, 12 };
+    const uint32 count = 60000;
+    int error = 0;
+
+    TestWorkerPool context = { 4, 0, 0, NULL, NULL };
+    WorkerPool pool = { 4, &context, test_worker_pool_run };
+
+    for (uint32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    for (uint32 w = 0; w < sizeof(workers) / sizeof(workers[0]); w++)
+    {
+        uint32 size = sizes[s];
+        Array *array = array_new(allocator, count, size);
+        Array *expected = array_new(allocator, count, size);
+        if (array == NULL || expected == NULL)
+            return 1;
+
+        srand(21 + w);
+        for (uint32 i = 0; i < count; i++)
+        {
+            uint32 *member = (uint32*)(array->data + i * size);
+            member[0] = i % 7 == 0 ? i : (uint32)rand() % 20000;
+            member[1] = i;
+        }
+        memcpy(expected->data, array->data, count * size);
+
+        pool.worker_count = workers[w];
+        context.thread_count = min(workers[w], 4);
+        error |= array_sort_parallel(array, allocator, &pool, compare_stable_key);
+        error |= array_sort_stable(expected, allocator, compare_stable_key);
+        error |= memcmp(array->data, expected->data, count * size) != 0;
+
+        array_destroy(array, allocator);
+        array_destroy(expected, allocator);
+    }
+
+    List *list = list_new(allocator, 20000, sizeof(int32));
+    for (uint32 i = 0; i < 20000; i++)
+    {
+        int32 value = rand() - RAND_MAX / 2;
+        list_append(list, (uint8*)&value);
+    }
+    error |= list_sort_parallel(list, allocator, &pool, compare_int32);
+    error |= list_sort_parallel(list, allocator, NULL, compare_int32);
+    for (uint32 i = 1; i < 20000; i++)
+        error |= ((int32*)list->data)[i - 1] > ((int32*)list->data)[i];
+    list_destroy(list, allocator);
+    return error;
+}
+
+
+typedef struct RadixRecord
+{
+    uint64 timestamp;
+    uint32 id;
+    int32 value;
+} RadixRecord;
+
+
+int test_array_sort_radix(AllocatorInterface *allocator)
+{
+    const uint32 count = 10000;
+    int error = 0;
+
+    Array *array = array_new(allocator, count, sizeof(RadixRecord));
+    if (array == NULL)
+        return 1;
+
+    RadixRecord *records = (RadixRecord*)array->data;
+    srand(19);
+    for (uint32 i = 0; i < count; i++)
+    {
+        records[i].timestamp = 1700000000000ULL + (uint64)(rand() % 5000) * 3;
+        records[i].id = i;
+        records[i].value = rand() - RAND_MAX / 2;
+    }
+
+    RadixKey timestamp = { 0, 8, RADIX_KEY_UNSIGNED };
+    error |= array_sort_radix(array, allocator, timestamp);
+    for (uint32 i = 1; i < count; i++)
+    {
+        error |= records[i - 1].timestamp > records[i].timestamp;
+        if (records[i - 1].timestamp == records[i].timestamp)
+            error |= records[i - 1].id > records[i].id;
+    }
+
+    RadixKey value = { 12, 4, RADIX_KEY_SIGNED };
+    error |= array_sort_radix(array, allocator, value);
+    for (uint32 i = 1; i < count; i++)
+        error |= records[i - 1].value > records[i].value;
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        float number = (float)records[i].value / 3.0f;
+        memcpy(&records[i].id, &number, sizeof(float));
+    }
+    RadixKey real = { 8, 4, RADIX_KEY_FLOAT };
+    error |= array_sort_radix(array, allocator, real);
+    for (uint32 i = 1; i < count; i++)
+    {
+        float a, b;
+        memcpy(&a, &records[i - 1].id, sizeof(float));
+        memcpy(&b, &records[i].id, sizeof(float));
+        error |= a > b;
+    }
+
+    RadixKey bytes = { 3, 6, RADIX_KEY_BYTES };
+    error |= array_sort_radix(array, allocator, bytes);
+    for (uint32 i = 1; i < count; i++)
+        error |= memcmp(array->data + (i - 1) * sizeof(RadixRecord) + 3, array->data + i * sizeof(RadixRecord) + 3, 6) > 0;
+
+    RadixKey out_of_bounds = { 12, 8, RADIX_KEY_UNSIGNED };
+    RadixKey short_float = { 0, 2, RADIX_KEY_FLOAT };
+    error |= array_sort_radix(array, allocator, out_of_bounds) != 1;
+    error |= array_sort_radix(array, allocator, short_float) != 1;
+
+    array_destroy(array, allocator);
+    return error;
+}
+
+
+int test_array_binary_search(AllocatorInterface *allocator)
+{
+    const uint32 counts[] = { 1, 2, 7, 1000 };
+    int error = 0;
+
+    srand(23);
+    for (uint32 c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        uint32 count = counts[c];
+        Array *array = array_new(allocator, count, sizeof(int));
+        if (array == NULL)
+            return 1;
+
+        int *numbers = (int*)array->data;
+        for (uint32 i = 0; i < count; i++)
+            numbers[i] = rand() % (count + 1) * 2;
+        array_sort(array, compare_int32);
+
+        Array *eytzinger = array_to_eytzinger(array, allocator);
+        if (eytzinger == NULL)
+            return 1;
+
+        for (int key = -3; key <= (int)count * 2 + 3; key++)
+        {
+            uint32 lower = 0, upper = 0;
+            while (lower < count && numbers[lower] < key)
+                lower++;
+            while (upper < count && numbers[upper] <= key)
+                upper++;
+
+            error |= array_lower_bound(array, (uint8*)&key, array_compare) != lower;
+            error |= array_upper_bound(array, (uint8*)&key, array_compare) != upper;
+            error |= array_lower_bound_branchless(array, (uint8*)&key, array_compare) != lower;
+            error |= array_lower_bound_branchless(array, (uint8*)&key, compare_int32) != lower;
+
+            int64 found = array_bsearch(array, (uint8*)&key, compare_int32);
+            if (lower < upper)
+                error |= found < lower || found >= upper;
+            else
+                error |= found != -1;
+
+            int64 node = array_eytzinger_lower_bound(eytzinger, (uint8*)&key, compare_int32);
+            if (lower == count)
+                error |= node != -1;
+            else
+                error |= node < 0 || ((int*)eytzinger->data)[node] != numbers[lower];
+
+            node = array_eytzinger_search(eytzinger, (uint8*)&key, array_compare);
+            if (lower < upper)
+                error |= node < 0 || ((int*)eytzinger->data)[node] != key;
+            else
+                error |= node != -1;
+        }
+
+        int key = 0;
+        error |= array_bsearch(array, NULL, compare_int32) != -1;
+        error |= array_bsearch(array, (uint8*)&key, NULL) != -1;
+
+        array_destroy(eytzinger, allocator);
+        array_destroy(array, allocator);
+    }
+    return error;
+}
+
+
 static void square(uint8 *memory)
 {
     int *number = (int*) memory;
@@ -226,7 +650,7 @@ int test_array_map(AllocatorInterface *allocator)
 
     if (new_array != NULL)
     {
-        error = memcmp(new_array->data, squared_numbers, 16 * sizeof(int));
+        error = memcmp(new_array->data, squared_numbers, 16 * sizeof(int)) != 0;
         array_destroy(new_array, allocator);
     }
 
@@ -455,3 +879,182 @@ int test_array_reduce_complex(AllocatorInterface *allocator)
     array_destroy(array, allocator);
     return !(result == 27);
 }
+
+
+static void scale_ctx(uint8 *member, void *ctx)
+{
+    *(int*)member *= *(int*)ctx;
+}
+
+
+static int is_multiple_ctx(uint8 *member, void *ctx)
+{
+    int *calls = (int*)ctx;
+    calls[1]++;
+    return *(int*)member % calls[0] == 0;
+}
+
+
+static void sum_ctx(uint8 *previous, uint8 *current, uint8 *result, void *ctx)
+{
+    *(int*)result += *(int*)current * *(int*)ctx;
+}
+
+
+int test_array_callback_context(AllocatorInterface *allocator)
+{
+    int error = 0;
+    Array *array = array_new(allocator, 100, sizeof(int));
+    if (array == NULL)
+        return 1;
+
+    for (uint32 i = 0; i < 100; i++)
+        ((int*)array->data)[i] = i;
+
+    int factor = 3;
+    array_foreach_ctx(array, scale_ctx, &factor);
+    error |= ((int*)array->data)[99] != 297;
+
+    Array *mapped = array_map_ctx(array, allocator, scale_ctx, &factor);
+    error |= mapped == NULL || ((int*)mapped->data)[10] != 90 || ((int*)array->data)[10] != 30;
+    array_destroy(mapped, allocator);
+
+    // Multiples of 6 among 0, 3, ..., 297, the test runs once per member.
+    int filter_ctx[2] = { 6, 0 };
+    Array *filtered = array_filter_ctx(array, allocator, is_multiple_ctx, filter_ctx);
+    error |= filtered == NULL || filtered->member_count != 50 || filter_ctx[1] != 100;
+    error |= filtered != NULL && ((int*)filtered->data)[49] != 294;
+    array_destroy(filtered, allocator);
+
+    int result = 0;
+    factor = 2;
+    array_reduce_ctx(array, sum_ctx, (uint8*)&result, &factor);
+    error |= result != 2 * 3 * (99 * 100 / 2);
+
+    filter_ctx[0] = 7;
+    filter_ctx[1] = 0;
+    error |= array_find_index_ctx(array, 1, is_multiple_ctx, filter_ctx) != 7;
+    error |= array_find_index_ctx(array, 100, is_multiple_ctx, filter_ctx) >= 0;
+
+    array_destroy(array, allocator);
+    return error;
+}
+
+
+static void square_block(uint8 *base, uint32 count, uint32 member_size, void *ctx)
+{
+    int64 *numbers = (int64*)base;
+    for (uint32 i = 0; i < count; i++)
+        numbers[i] *= numbers[i];
+    (*(uint32*)ctx)++;
+}
+
+
+static void sum_block(uint8 *base, uint32 count, uint32 member_size, void *result)
+{
+    int64 *numbers = (int64*)base;
+    for (uint32 i = 0; i < count; i++)
+        *(int64*)result += numbers[i];
+}
+
+
+static uint32 keep_even_block(uint8 *base, uint32 count, uint32 member_size, void *ctx)
+{
+    int64 *numbers = (int64*)base;
+    uint32 kept = 0;
+    for (uint32 i = 0; i < count; i++)
+        if (numbers[i] % 2 == 0)
+            numbers[kept++] = numbers[i];
+    return kept;
+}
+
+
+static int64 find_block(uint8 *base, uint32 count, uint32 member_size, void *ctx)
+{
+    int64 *numbers = (int64*)base;
+    for (uint32 i = 0; i < count; i++)
+        if (numbers[i] == *(int64*)ctx)
+            return i;
+    return -1;
+}
+
+
+int test_array_chunked_callbacks(AllocatorInterface *allocator)
+{
+    const uint32 count = 5000;
+    int error = 0;
+
+    Array *array = array_new(allocator, count, sizeof(int64));
+    if (array == NULL)
+        return 1;
+
+    int64 *numbers = (int64*)array->data;
+    for (uint32 i = 0; i < count; i++)
+        numbers[i] = i;
+
+    // 5000 members of 8 bytes span three blocks.
+    uint32 blocks = 0;
+    Array *squares = array_map_chunked(array, allocator, square_block, &blocks);
+    error |= squares == NULL || blocks != 3 || numbers[70] != 70;
+    error |= squares != NULL && ((int64*)squares->data)[4999] != 4999 * 4999;
+
+    int64 sum = 0;
+    array_reduce_chunked(squares, sum_block, &sum);
+    error |= sum != (int64)4999 * 5000 * 9999 / 6;
+
+    blocks = 0;
+    array_foreach_chunked(array, square_block, &blocks);
+    error |= blocks != 3 || numbers[3000] != 9000000;
+    error |= memcmp(array->data, squares->data, count * sizeof(int64)) != 0;
+
+    Array *even = array_filter_chunked(array, allocator, keep_even_block, NULL);
+    error |= even == NULL || even->member_count != count / 2;
+    for (uint32 i = 0; even != NULL && i < even->member_count; i++)
+        error |= ((int64*)even->data)[i] != (int64)(2 * i) * (2 * i);
+
+    int64 key = 4100 * 4100;
+    error |= array_find_index_chunked(array, 0, find_block, &key) != 4100;
+    error |= array_find_index_chunked(array, 4101, find_block, &key) != -1;
+    key = -1;
+    error |= array_find_index_chunked(array, 0, find_block, &key) != -1;
+
+    array_destroy(even, allocator);
+    array_destroy(squares, allocator);
+    array_destroy(array, allocator);
+    return error;
+}
+
+
+int test_array_byteswap(AllocatorInterface *allocator)
+{
+    const uint32 member_sizes[] = { 1, 2, 3, 4, 8, 12, 16 };
+    const uint32 member_count = 67;
+    int error = 0;
+
+    for (int level = SIMD_LEVEL_WORD; level <= (int)platform_simd_level(); level++)
+    {
+        memory_kernels_select((enum SimdLevel)level);
+
+        for (uint32 s = 0; s < sizeof(member_sizes) / sizeof(uint32); s++)
+        {
+            const uint32 member_size = member_sizes[s];
+            Array *array = array_new(allocator, member_count, member_size);
+            for (uint32 i = 0; i < member_count * member_size; i++)
+                array->data[i] = (uint8)i;
+
+            array_byteswap(array);
+
+            for (uint32 i = 0; i < member_count * member_size; i++)
+            {
+                uint32 member_start = i - (i % member_size);
+                uint32 expected = member_start + member_size - 1 - (i % member_size);
+                if (array->data[i] != (uint8)expected)
+                    error = 1;
+            }
+            array_destroy(array, allocator);
+        }
+    }
+
+    memory_kernels_select(platform_simd_level());
+    return error;
+}
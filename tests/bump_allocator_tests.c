@@ -55,3 +55,211 @@ int test_bump_allocator_bound_check(AllocatorInterface *allocator)
         allocator->memory_free(bump_alloc, bump_alloc_size);
     return error;
 }
+
+
+int test_bump_allocator_aligned_allocation(AllocatorInterface *allocator)
+{
+    int error = 0;
+    uint8 *a, *b, *c;
+    uint32 bump_alloc_size = bump_allocator_size(1024);
+
+    BumpAllocator *bump_alloc = allocator->memory_allocate(bump_alloc_size);
+    bump_allocator_init(bump_alloc, 1024);
+
+    a = bump_allocator_memory_allocate(bump_alloc, 12);
+    b = bump_allocator_memory_allocate_aligned(bump_alloc, 8 * sizeof(uint64), sizeof(uint64));
+    c = bump_allocator_memory_allocate_aligned(bump_alloc, 1, PLATFORM_CACHE_LINE_SIZE);
+
+    if (a == NULL || b == NULL || c == NULL)
+    {
+        error = 1;
+        goto cleanup;
+    }
+
+    error = 3;
+    error -= ((uint64) b) % sizeof(uint64) == 0;
+    error -= ((uint64) c) % PLATFORM_CACHE_LINE_SIZE == 0;
+    error -= bump_alloc->end_index == (uint64)(c - bump_alloc->buffer) + 1;
+
+    cleanup:
+        allocator->memory_free(bump_alloc, bump_alloc_size);
+    return error;
+}
+
+
+int test_bump_allocator_aligned_allocation_bound_check(AllocatorInterface *allocator)
+{
+    int error = 4;
+    uint32 bump_alloc_size = bump_allocator_size(64);
+
+    BumpAllocator *bump_alloc = allocator->memory_allocate(bump_alloc_size);
+    bump_allocator_init(bump_alloc, 64);
+
+    error -= bump_allocator_memory_allocate_aligned(bump_alloc, 8, 3) == NULL;
+    error -= bump_allocator_memory_allocate_aligned(bump_alloc, 8, 2 * PLATFORM_PAGE_SIZE) == NULL;
+
+    // The padding needed for alignment must also fit into the buffer.
+    bump_allocator_memory_allocate(bump_alloc, 1);
+    error -= bump_allocator_memory_allocate_aligned(bump_alloc, 63, 16) == NULL;
+    error -= bump_alloc->end_index == 1;
+
+    allocator->memory_free(bump_alloc, bump_alloc_size);
+    return error;
+}
+
+
+int test_bump_allocator_mark_rewind(AllocatorInterface *allocator)
+{
+    int error = 4;
+    uint8 *a, *b, *c;
+    uint32 bump_alloc_size = bump_allocator_size(64);
+
+    BumpAllocator *bump_alloc = allocator->memory_allocate(bump_alloc_size);
+    bump_allocator_init(bump_alloc, 64);
+
+    a = bump_allocator_memory_allocate(bump_alloc, 8);
+    uint64 mark = bump_allocator_mark(bump_alloc);
+    b = bump_allocator_memory_allocate(bump_alloc, 16);
+    bump_allocator_memory_allocate(bump_alloc, 16);
+
+    bump_allocator_rewind(bump_alloc, mark);
+    error -= bump_alloc->end_index == 8;
+
+    c = bump_allocator_memory_allocate(bump_alloc, 16);
+    error -= a == bump_alloc->buffer && c == b;
+
+    // Rewinding to a mark past the end after a reset does nothing.
+    bump_allocator_reset(bump_alloc);
+    bump_allocator_rewind(bump_alloc, mark);
+    error -= bump_alloc->end_index == 0;
+
+    bump_allocator_rewind(bump_alloc, 0);
+    error -= bump_alloc->end_index == 0;
+
+    allocator->memory_free(bump_alloc, bump_alloc_size);
+    return error;
+}
+
+
+int test_bump_allocator_resize(AllocatorInterface *allocator)
+{
+    int error = 5;
+    uint8 *a, *b, *memory;
+    uint32 bump_alloc_size = bump_allocator_size(256);
+
+    BumpAllocator *bump_alloc = allocator->memory_allocate(bump_alloc_size);
+    bump_allocator_init(bump_alloc, 256);
+
+    a = bump_allocator_memory_allocate(bump_alloc, 16);
+    memset(a, 0x11, 16);
+
+    // The newest allocation grows and shrinks in place.
+    memory = bump_allocator_memory_resize(bump_alloc, a, 16, 64);
+    error -= memory == a && bump_alloc->end_index == 64;
+
+    memory = bump_allocator_memory_resize(bump_alloc, a, 64, 32);
+    error -= memory == a && bump_alloc->end_index == 32;
+
+    b = bump_allocator_memory_allocate(bump_alloc, 16);
+
+    // Older blocks are moved, keeping their contents.
+    memory = bump_allocator_memory_resize(bump_alloc, a, 16, 48);
+    error -= memory != a && memory != NULL && memory[0] == 0x11 && memory[15] == 0x11;
+
+    // Not enough space left to grow in place or to move.
+    memory = bump_allocator_memory_resize(bump_alloc, b, 16, 512);
+    error -= memory == NULL;
+
+    memory = bump_allocator_memory_resize(bump_alloc, b, 16, 8);
+    error -= memory == b;
+
+    allocator->memory_free(bump_alloc, bump_alloc_size);
+    return error;
+}
+
+
+#define CONCURRENT_TEST_THREADS 4
+#define CONCURRENT_TEST_ALLOCATIONS 1000
+
+typedef struct ConcurrentBumpTest
+{
+    BumpAllocator *allocator;
+    uint64 alignment;
+    uint32 thread_id;
+    uint32 failed;
+} ConcurrentBumpTest;
+
+
+static void* concurrent_bump_allocate(void *argument)
+{
+    ConcurrentBumpTest *test = argument;
+    for (uint32 i = 0; i < CONCURRENT_TEST_ALLOCATIONS; i++)
+    {
+        uint8 *memory = bump_allocator_memory_allocate_concurrent(test->allocator, 12, test->alignment);
+        if (memory == NULL || ((uint64) memory) % test->alignment != 0)
+        {
+            test->failed = 1;
+            break;
+        }
+        memset(memory, (int)test->thread_id, 12);
+
+        // Oversized requests fail without moving other threads onto handed out memory.
+        if (bump_allocator_memory_allocate_concurrent(test->allocator, (uint64)-1, test->alignment) != NULL)
+            test->failed = 1;
+    }
+    return NULL;
+}
+
+
+int test_bump_allocator_concurrent_allocation(AllocatorInterface *allocator)
+{
+    int error = 0;
+    const uint64 alignments[] = { 1, 16 };
+    const uint64 buffer_size = CONCURRENT_TEST_THREADS * CONCURRENT_TEST_ALLOCATIONS * 16;
+    uint64 bump_alloc_size = bump_allocator_size(buffer_size);
+    BumpAllocator *bump_alloc = allocator->memory_allocate(bump_alloc_size);
+    pthread_t threads[CONCURRENT_TEST_THREADS];
+    ConcurrentBumpTest tests[CONCURRENT_TEST_THREADS];
+    uint32 counts[CONCURRENT_TEST_THREADS + 1];
+
+    for (uint32 a = 0; a < 2; a++)
+    {
+        bump_allocator_init(bump_alloc, buffer_size);
+        memset(bump_alloc->buffer, CONCURRENT_TEST_THREADS, buffer_size);
+        memset(counts, 0x00, sizeof(counts));
+
+        for (uint32 i = 0; i < CONCURRENT_TEST_THREADS; i++)
+        {
+            tests[i].allocator = bump_alloc;
+            tests[i].alignment = alignments[a];
+            tests[i].thread_id = i;
+            tests[i].failed = 0;
+            pthread_create(&threads[i], NULL, concurrent_bump_allocate, &tests[i]);
+        }
+        for (uint32 i = 0; i < CONCURRENT_TEST_THREADS; i++)
+        {
+            pthread_join(threads[i], NULL);
+            error |= tests[i].failed;
+        }
+
+        // No two threads got overlapping memory.
+        for (uint64 i = 0; i < buffer_size; i++)
+            counts[bump_alloc->buffer[i]]++;
+        for (uint32 i = 0; i < CONCURRENT_TEST_THREADS; i++)
+            error |= counts[i] != CONCURRENT_TEST_ALLOCATIONS * 12;
+    }
+
+    // Only the 4 bytes after the last 12 byte allocation are left.
+    error |= bump_allocator_memory_allocate_concurrent(bump_alloc, 1, 16) != NULL;
+    error |= bump_allocator_memory_allocate_concurrent(bump_alloc, 8, 1) != NULL;
+    error |= bump_alloc->end_index != buffer_size - 4;
+
+    bump_allocator_init(bump_alloc, buffer_size);
+    uint8 *first = bump_allocator_memory_allocate_concurrent(bump_alloc, 16, 1);
+    error |= bump_allocator_memory_allocate_concurrent(bump_alloc, (uint64)-1, 1) != NULL;
+    uint8 *second = bump_allocator_memory_allocate_concurrent(bump_alloc, 16, 1);
+    error |= first == NULL || second != first + 16;
+
+    allocator->memory_free(bump_alloc, bump_alloc_size);
+    return error;
+}
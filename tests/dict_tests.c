@@ -252,3 +252,66 @@ int test_dict_resize(AllocatorInterface *allocator)
         dict_destroy(dict, allocator);
     return err;
 }
+
+
+// Returns a key after 'key' whose probe sequence starts in the same slot.
+static uint32 colliding_key(uint32 key, uint32 num_slots)
+{
+    uint32 slot = dict_probe_slot(dict_hash((uint8*)&key, sizeof(uint32)), 0, num_slots);
+    uint32 other = key + 1;
+    while (dict_probe_slot(dict_hash((uint8*)&other, sizeof(uint32)), 0, num_slots) != slot)
+        other++;
+    return other;
+}
+
+
+int test_dict_update_and_pop(AllocatorInterface *allocator)
+{
+    int error = 0;
+    uint32 key, value;
+    Dict *dict = dict_new(allocator, INITIAL_DICT_SIZE, sizeof(uint32), sizeof(uint32));
+    if (dict == NULL)
+        return 1;
+
+    for (key = 1; key <= 6; key++)
+    {
+        value = key * 10;
+        dict_set(dict, (uint8*)&key, (uint8*)&value);
+    }
+
+    // Updating a key that is not the first member does not add it again.
+    key = 4;
+    value = 400;
+    dict_set(dict, (uint8*)&key, (uint8*)&value);
+    error |= dict->member_count != 6;
+
+    // The index follows the members moved by pop.
+    key = 2;
+    dict_pop(dict, (uint8*)&key, (uint8*)&value);
+    error |= value != 20 || dict_contains_key(dict, (uint8*)&key);
+    error |= dict->member_count != 5;
+    for (key = 1; key <= 6; key++)
+    {
+        if (key == 2)
+            continue;
+        value = 0;
+        dict_get(dict, (uint8*)&key, (uint8*)&value);
+        error |= value != (key == 4 ? 400 : key * 10);
+    }
+
+    // A key probed past a removed slot is updated, not added again.
+    uint32 first = 100;
+    uint32 second = colliding_key(first, dict->_num_slots);
+    dict_set(dict, (uint8*)&first, (uint8*)&value);
+    dict_set(dict, (uint8*)&second, (uint8*)&value);
+    dict_pop(dict, (uint8*)&first, (uint8*)&value);
+    value = 7;
+    dict_set(dict, (uint8*)&second, (uint8*)&value);
+    error |= dict->member_count != 6;
+    value = 0;
+    dict_get(dict, (uint8*)&second, (uint8*)&value);
+    error |= value != 7;
+
+    dict_destroy(dict, allocator);
+    return error;
+}
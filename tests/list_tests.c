@@ -319,3 +319,94 @@ int test_list_sort(AllocatorInterface *allocator)
     list_destroy(list, allocator);
     return error;
 }
+
+
+int test_list_insert_range(AllocatorInterface *allocator)
+{
+    int error = 3;
+    char buffer[LIST_INITIAL_SIZE + 1];
+
+    List *list = list_new(allocator, LIST_INITIAL_SIZE, 1);
+    list_insert_range(list, 0, (uint8*) "AAAA", 4);
+    list_insert_range(list, 2, (uint8*) "BBB", 3);
+    memset(buffer, 0x00, LIST_INITIAL_SIZE + 1);
+    memcpy(buffer, list->data, list->member_count);
+    error -= strcmp(buffer, "AABBBAA") == 0;
+
+    list_insert_range(list, 100, (uint8*) "CC", 2);
+    memset(buffer, 0x00, LIST_INITIAL_SIZE + 1);
+    memcpy(buffer, list->data, list->member_count);
+    error -= strcmp(buffer, "AABBBAACC") == 0;
+
+    // Does not fit, list must stay untouched.
+    list_insert_range(list, 0, (uint8*) "DDDDDDDD", 8);
+    error -= list->member_count == 9;
+
+    list_destroy(list, allocator);
+    return error;
+}
+
+
+int test_list_remove_range(AllocatorInterface *allocator)
+{
+    char *str = "AAAABBBBCCCCDDDD";
+    char buffer[LIST_INITIAL_SIZE + 1];
+    int error = 4;
+
+    List *list = list_new(allocator, LIST_INITIAL_SIZE, 4);
+    list->member_count = 4;
+    memcpy(list->data, str, 16);
+
+    list_remove_range(list, 4, 1);
+    error -= list->member_count == 4;
+
+    list_remove_range(list, 1, 2);
+    memset(buffer, 0x00, LIST_INITIAL_SIZE + 1);
+    memcpy(buffer, list->data, list->member_count * list->member_size);
+    error -= strcmp(buffer, "AAAADDDD") == 0;
+
+    list_remove_range(list, 1, 100);
+    memset(buffer, 0x00, LIST_INITIAL_SIZE + 1);
+    memcpy(buffer, list->data, list->member_count * list->member_size);
+    error -= strcmp(buffer, "AAAA") == 0;
+
+    list_remove_at(list, 0);
+    list_remove_at(list, 0);
+    error -= list->member_count == 0;
+
+    list_destroy(list, allocator);
+    return error;
+}
+
+
+static void list_count_ctx(uint8 *member, void *ctx)
+{
+    *(int*)ctx += *(int*)member;
+}
+
+
+static void list_count_block(uint8 *base, uint32 count, uint32 member_size, void *result)
+{
+    for (uint32 i = 0; i < count; i++)
+        *(int*)result += ((int*)base)[i];
+}
+
+
+int test_list_callback_variants(AllocatorInterface *allocator)
+{
+    int error = 0;
+    List *list = list_new(allocator, LIST_INITIAL_SIZE, sizeof(int));
+    for (int i = 1; i <= 10; i++)
+        list_append(list, (uint8*)&i);
+
+    int sum = 0;
+    list_foreach_ctx(list, list_count_ctx, &sum);
+    error |= sum != 55;
+
+    sum = 0;
+    list_reduce_chunked(list, list_count_block, &sum);
+    error |= sum != 55;
+
+    list_destroy(list, allocator);
+    return error;
+}
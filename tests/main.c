@@ -1,15 +1,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "c-utils.h"
 
 // Test files
+#include "memory_tests.c"
 #include "array_tests.c"
 #include "list_tests.c"
 #include "dict_tests.c"
 #include "set_tests.c"
+#include "typed_container_tests.c"
+#include "pipeline_tests.c"
 #include "bump_allocator_tests.c"
 #include "arena_allocator_tests.c"
+#include "pool_allocator_tests.c"
+#include "tlsf_allocator_tests.c"
+#include "allocator_interface_tests.c"
+#include "allocator_stats_tests.c"
 
 
 void* _memory_allocate(uint64 size)
@@ -31,12 +39,26 @@ void _memory_free(void* memory, uint64 size)
 
 
 int (*tests[])(AllocatorInterface*) = {
+    test_memory_set,
+    test_memory_copy,
+    test_memory_copy_overlapping,
+    test_memory_are_equal,
+    test_memory_move,
+    test_platform_memory_map,
+
     test_basic_array_use,
     test_array_bound_check,
     test_array_copy_memory,
     test_array_slicing,
     test_array_foreach,
     test_array_sorting,
+    test_array_sorting_patterns,
+    test_array_sort_builtin_comparators,
+    test_array_sort_member_sizes,
+    test_array_sort_radix,
+    test_array_sort_stable,
+    test_array_sort_parallel,
+    test_array_binary_search,
     test_array_map,
     test_array_filter,
     test_array_reverse,
@@ -44,18 +66,58 @@ int (*tests[])(AllocatorInterface*) = {
     test_array_find_item,
     test_array_reduce_simple,
     test_array_reduce_complex,
+    test_array_callback_context,
+    test_array_chunked_callbacks,
+    test_array_byteswap,
 
     test_bump_allocator_memory_allocation,
     test_bump_allocator_bound_check,
+    test_bump_allocator_aligned_allocation,
+    test_bump_allocator_aligned_allocation_bound_check,
+    test_bump_allocator_mark_rewind,
+    test_bump_allocator_resize,
+    test_bump_allocator_concurrent_allocation,
 
     test_arena_allocator_uniform_memory_allocation,
     test_arena_allocator_memory_allocation,
     test_arena_allocator_size_check,
+    test_arena_allocator_aligned_allocation,
+    test_arena_allocator_current_arena,
+    test_arena_allocator_growing,
+    test_arena_allocator_chunk_padding,
+    test_arena_allocator_mark_rewind,
+    test_arena_allocator_resize,
+    test_arena_cache_concurrent_allocation,
+    test_arena_cache_interface,
+    test_arena_cache_refill_unlocked,
+    test_arena_allocator_mapped,
+
+    test_pool_allocator_memory_allocation,
+    test_pool_allocator_interface,
+
+    test_tlsf_allocator_memory_allocation,
+    test_tlsf_allocator_resize,
+    test_tlsf_allocator_random_allocation,
+    test_tlsf_allocator_interface,
+
+    test_arena_allocator_interface,
+    test_bump_allocator_interface,
+    test_allocator_recorder,
+
+#ifdef C_UTILS_ALLOCATOR_STATS
+    test_bump_allocator_stats,
+    test_arena_allocator_stats,
+    test_pool_allocator_stats,
+    test_tlsf_allocator_stats,
+#endif
 
     test_basic_list_use,
     test_list_resize,
     test_list_insertion,
     test_list_removing,
+    test_list_insert_range,
+    test_list_remove_range,
+    test_list_callback_variants,
     test_list_getting_items,
     test_list_copy_memory,
     test_list_create_slice,
@@ -68,10 +130,20 @@ int (*tests[])(AllocatorInterface*) = {
     test_dict_copy_values,
     test_dict_copy_items,
     test_dict_resize,
+    test_dict_update_and_pop,
 
     test_set_usage,
     test_set_copy_items,
     test_set_resize,
+    test_set_add_and_remove,
+
+    test_typed_array,
+    test_typed_list,
+    test_typed_dict,
+    test_typed_set,
+
+    test_pipeline,
+    test_pipeline_list_and_invalid,
     NULL
 };
 
@@ -0,0 +1,200 @@
+#define MEMORY_TEST_BUFFER_SIZE 512
+#define MEMORY_TEST_MAX_LENGTH 300
+#define MEMORY_TEST_GUARD 0xEE
+
+
+static int memory_test_levels(int (*test)(void))
+{
+    int error = 0;
+    for (int level = SIMD_LEVEL_WORD; level <= (int)platform_simd_level(); level++)
+    {
+        memory_kernels_select((enum SimdLevel)level);
+        error |= test();
+    }
+    memory_kernels_select(platform_simd_level());
+    return error;
+}
+
+
+static int memory_set_all_lengths(void)
+{
+    uint8 buffer[MEMORY_TEST_BUFFER_SIZE];
+
+    for (uint32 offset = 0; offset < 8; offset++)
+    {
+        for (uint32 length = 0; length < MEMORY_TEST_MAX_LENGTH; length++)
+        {
+            memset(buffer, MEMORY_TEST_GUARD, MEMORY_TEST_BUFFER_SIZE);
+            memory_set(buffer + offset, 0x42, length);
+
+            for (uint32 i = 0; i < MEMORY_TEST_BUFFER_SIZE; i++)
+            {
+                uint8 expected = (i >= offset && i < offset + length) ? 0x42 : MEMORY_TEST_GUARD;
+                if (buffer[i] != expected)
+                    return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+
+static int memory_copy_all_lengths(void)
+{
+    uint8 src[MEMORY_TEST_BUFFER_SIZE];
+    uint8 target[MEMORY_TEST_BUFFER_SIZE];
+
+    for (uint32 i = 0; i < MEMORY_TEST_BUFFER_SIZE; i++)
+        src[i] = (uint8)(i * 7 + 1);
+
+    for (uint32 offset = 0; offset < 8; offset++)
+    {
+        for (uint32 length = 0; length < MEMORY_TEST_MAX_LENGTH; length++)
+        {
+            memset(target, MEMORY_TEST_GUARD, MEMORY_TEST_BUFFER_SIZE);
+            memory_copy(src + 3, target + offset, length);
+
+            for (uint32 i = 0; i < MEMORY_TEST_BUFFER_SIZE; i++)
+            {
+                uint8 expected = (i >= offset && i < offset + length) ? src[3 + i - offset] : MEMORY_TEST_GUARD;
+                if (target[i] != expected)
+                    return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+
+static int memory_copy_overlapping_down(void)
+{
+    uint8 buffer[MEMORY_TEST_BUFFER_SIZE];
+    uint8 expected[MEMORY_TEST_BUFFER_SIZE];
+
+    for (uint32 shift = 1; shift < 40; shift++)
+    {
+        for (uint32 i = 0; i < MEMORY_TEST_BUFFER_SIZE; i++)
+            buffer[i] = expected[i] = (uint8)i;
+        memmove(expected, expected + shift, MEMORY_TEST_MAX_LENGTH);
+
+        memory_copy(buffer + shift, buffer, MEMORY_TEST_MAX_LENGTH);
+        if (memcmp(buffer, expected, MEMORY_TEST_BUFFER_SIZE) != 0)
+            return 1;
+    }
+    return 0;
+}
+
+
+static int memory_are_equal_all_lengths(void)
+{
+    uint8 a[MEMORY_TEST_BUFFER_SIZE];
+    uint8 b[MEMORY_TEST_BUFFER_SIZE];
+
+    for (uint32 i = 0; i < MEMORY_TEST_BUFFER_SIZE; i++)
+        a[i] = b[i] = (uint8)(i * 13);
+
+    for (uint32 offset = 0; offset < 8; offset++)
+    {
+        for (uint32 length = 0; length < MEMORY_TEST_MAX_LENGTH; length++)
+        {
+            if (!memory_are_equal(a + offset, b + offset, length))
+                return 1;
+
+            for (uint32 i = 0; i < length; i++)
+            {
+                b[offset + i] ^= 0x80;
+                int equal = memory_are_equal(a + offset, b + offset, length);
+                b[offset + i] ^= 0x80;
+                if (equal)
+                    return 1;
+            }
+
+            // Bytes right after the compared block must not matter.
+            b[offset + length] ^= 0x01;
+            int equal = memory_are_equal(a + offset, b + offset, length);
+            b[offset + length] ^= 0x01;
+            if (!equal)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+
+int test_memory_set(AllocatorInterface *allocator)
+{
+    return memory_test_levels(memory_set_all_lengths);
+}
+
+
+int test_memory_copy(AllocatorInterface *allocator)
+{
+    return memory_test_levels(memory_copy_all_lengths);
+}
+
+
+int test_memory_copy_overlapping(AllocatorInterface *allocator)
+{
+    return memory_test_levels(memory_copy_overlapping_down);
+}
+
+
+int test_memory_are_equal(AllocatorInterface *allocator)
+{
+    return memory_test_levels(memory_are_equal_all_lengths);
+}
+
+
+static int memory_move_all_shifts(void)
+{
+    uint8 buffer[MEMORY_TEST_BUFFER_SIZE];
+    uint8 expected[MEMORY_TEST_BUFFER_SIZE];
+
+    for (uint32 shift = 0; shift < 80; shift++)
+    {
+        for (uint32 length = 0; length < MEMORY_TEST_MAX_LENGTH; length += 7)
+        {
+            for (uint32 i = 0; i < MEMORY_TEST_BUFFER_SIZE; i++)
+                buffer[i] = expected[i] = (uint8)(i * 3);
+
+            memmove(expected + 1 + shift, expected + 1, length);
+            memory_move(buffer + 1, buffer + 1 + shift, length);
+            if (memcmp(buffer, expected, MEMORY_TEST_BUFFER_SIZE) != 0)
+                return 1;
+
+            memmove(expected + 1, expected + 1 + shift, length);
+            memory_move(buffer + 1 + shift, buffer + 1, length);
+            if (memcmp(buffer, expected, MEMORY_TEST_BUFFER_SIZE) != 0)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+
+int test_memory_move(AllocatorInterface *allocator)
+{
+    return memory_test_levels(memory_move_all_shifts);
+}
+
+
+int test_platform_memory_map(AllocatorInterface *allocator)
+{
+    uint8 *memory = platform_memory_map(3 * PLATFORM_PAGE_SIZE + 1);
+    if (memory == NULL || ((uint64)memory & (PLATFORM_PAGE_SIZE - 1)) != 0)
+        return 1;
+
+    memset(memory, 0x11, 3 * PLATFORM_PAGE_SIZE + 1);
+    // Only the whole pages inside the block are released.
+    platform_memory_release(memory + 1, 2 * PLATFORM_PAGE_SIZE);
+    if (memory[0] != 0x11 || memory[PLATFORM_PAGE_SIZE] != 0x00 || memory[2 * PLATFORM_PAGE_SIZE] != 0x11)
+        return 1;
+    platform_memory_unmap(memory, 3 * PLATFORM_PAGE_SIZE + 1);
+
+    memory = platform_memory_map(PLATFORM_HUGE_PAGE_SIZE);
+    if (memory == NULL || ((uint64)memory & (PLATFORM_HUGE_PAGE_SIZE - 1)) != 0)
+        return 1;
+    memory[PLATFORM_HUGE_PAGE_SIZE - 1] = 0x22;
+    platform_memory_unmap(memory, PLATFORM_HUGE_PAGE_SIZE);
+    return 0;
+}
@@ -0,0 +1,136 @@
+static int pipeline_is_even(uint8 *member, void *ctx)
+{
+    return *(int32*)member % 2 == 0;
+}
+
+
+static int pipeline_is_greater(uint8 *member, void *ctx)
+{
+    return *(int64*)member > *(int64*)ctx;
+}
+
+
+static void pipeline_square(uint8 *member, uint8 *output, void *ctx)
+{
+    int64 value = *(int32*)member;
+    *(int64*)output = value * value;
+}
+
+
+static void pipeline_split(uint8 *member, uint8 *output, void *ctx)
+{
+    int64 value = *(int64*)member;
+    ((int32*)output)[0] = (int32)(value / 1000);
+    ((int32*)output)[1] = (int32)(value % 1000);
+}
+
+
+static void pipeline_add_int64(uint8 *member, uint8 *result, void *ctx)
+{
+    *(int64*)result += *(int64*)member;
+}
+
+
+int test_pipeline(AllocatorInterface *allocator)
+{
+    int error = 0;
+    Array *array = array_new(allocator, 1000, sizeof(int32));
+    if (array == NULL)
+        return 1;
+
+    for (int32 i = 0; i < 1000; i++)
+        array_set(array, i, (uint8*)&i);
+
+    // Sum of the squares of the even numbers, with the member size changing.
+    Pipeline pipeline;
+    pipeline_init(&pipeline, array);
+    pipeline_filter(&pipeline, pipeline_is_even, NULL);
+    pipeline_map(&pipeline, sizeof(int64), pipeline_square, NULL);
+    error |= pipeline_member_size(&pipeline) != sizeof(int64);
+
+    int64 sum = 0;
+    int64 expected = 0;
+    for (int64 i = 0; i < 1000; i += 2)
+        expected += i * i;
+    error |= pipeline_reduce(&pipeline, pipeline_add_int64, (uint8*)&sum, NULL) != 500;
+    error |= sum != expected;
+
+    // Filters after a map see the mapped members.
+    int64 limit = 10000;
+    pipeline_filter(&pipeline, pipeline_is_greater, &limit);
+    pipeline_skip(&pipeline, 2);
+    pipeline_take(&pipeline, 5);
+
+    int64 buffer[8] = { 0 };
+    error |= pipeline_collect(&pipeline, (uint8*)buffer, 8) != 5;
+    for (int64 i = 0; i < 5; i++)
+        error |= buffer[i] != (106 + 2 * i) * (106 + 2 * i);
+    error |= buffer[5] != 0;
+
+    // Collecting stops at the end of the buffer, and the pipeline can be rerun.
+    error |= pipeline_collect(&pipeline, (uint8*)buffer, 3) != 3;
+    error |= buffer[0] != 106 * 106 || buffer[2] != 110 * 110;
+
+    pipeline_map(&pipeline, 2 * sizeof(int32), pipeline_split, NULL);
+    Array *result = pipeline_to_array(&pipeline, allocator);
+    error |= result == NULL || result->member_count != 5 || result->member_size != 2 * sizeof(int32);
+    if (result != NULL)
+    {
+        int32 pair[2];
+        array_get(result, 4, (uint8*)pair);
+        error |= pair[0] != 12 || pair[1] != 996;
+        array_destroy(result, allocator);
+    }
+
+    // Nothing passes a take of zero.
+    pipeline_init(&pipeline, array);
+    pipeline_take(&pipeline, 0);
+    error |= pipeline_to_array(&pipeline, allocator) != NULL;
+    error |= pipeline_collect(&pipeline, (uint8*)buffer, 8) != 0;
+
+    pipeline_map(NULL, sizeof(int64), pipeline_square, NULL);
+    error |= pipeline_member_size(NULL) != 0;
+
+    array_destroy(array, allocator);
+    return error;
+}
+
+
+int test_pipeline_list_and_invalid(AllocatorInterface *allocator)
+{
+    int error = 0;
+    List *list = list_new(allocator, 16, sizeof(int32));
+    if (list == NULL)
+        return 1;
+
+    for (int32 i = 0; i < 10; i++)
+        list_append(list, (uint8*)&i);
+
+    // Only the members in the list are read, not the whole capacity.
+    Pipeline pipeline;
+    pipeline_init_list(&pipeline, list);
+    pipeline_skip(&pipeline, 7);
+    Array *result = pipeline_to_array(&pipeline, allocator);
+    error |= result == NULL || result->member_count != 3;
+    if (result != NULL)
+    {
+        int32 value;
+        array_get(result, 0, (uint8*)&value);
+        error |= value != 7;
+        array_destroy(result, allocator);
+    }
+
+    int64 sum = 0;
+    pipeline_map(&pipeline, PIPELINE_MAX_MEMBER_SIZE + 1, pipeline_square, NULL);
+    error |= pipeline_reduce(&pipeline, pipeline_add_int64, (uint8*)&sum, NULL) != -1;
+    error |= pipeline_to_array(&pipeline, allocator) != NULL;
+
+    pipeline_init_list(&pipeline, list);
+    for (uint32 i = 0; i <= PIPELINE_MAX_STAGES; i++)
+        pipeline_skip(&pipeline, 0);
+    error |= pipeline.stage_count != PIPELINE_MAX_STAGES;
+    error |= pipeline_collect(&pipeline, (uint8*)&sum, 1) != -1;
+
+    list_destroy(list, allocator);
+    return error;
+}
@@ -0,0 +1,111 @@
+int test_pool_allocator_memory_allocation(AllocatorInterface *allocator)
+{
+    int error = 0;
+    uint8 *blocks[10];
+    PoolAllocator *pool = allocator->memory_allocate(sizeof(PoolAllocator));
+    pool_allocator_init(pool, allocator->memory_allocate, 12, 4);
+
+    if (pool->block_size != 16)
+        error = 1;
+
+    for (uint32 i = 0; i < 10; i++)
+    {
+        blocks[i] = pool_allocator_memory_allocate(pool);
+        if (blocks[i] == NULL || ((uint64) blocks[i]) % ALLOCATOR_DEFAULT_ALIGNMENT != 0)
+        {
+            error = 1;
+            goto cleanup;
+        }
+        memset(blocks[i], (int)i, 12);
+    }
+
+    // Blocks are handed out from three chunks without overlapping.
+    for (uint32 i = 0; i < 10; i++)
+    {
+        if (blocks[i][0] != i || blocks[i][11] != i)
+            error = 1;
+    }
+
+    // The last freed block is reused first.
+    pool_allocator_memory_free(pool, blocks[3]);
+    pool_allocator_memory_free(pool, blocks[7]);
+    if (pool_allocator_memory_allocate(pool) != blocks[7] || pool_allocator_memory_allocate(pool) != blocks[3])
+        error = 1;
+
+    pool_allocator_reset(pool);
+    if (pool->chunks != NULL || pool->free_chunks == NULL)
+        error = 1;
+
+    for (uint32 i = 0; i < 12; i++)
+    {
+        if (pool_allocator_memory_allocate(pool) == NULL)
+            error = 1;
+    }
+
+    // The three chunks are reused after the reset.
+    if (pool->free_chunks != NULL)
+        error = 1;
+
+    cleanup:
+        pool_allocator_destroy(pool, allocator->memory_free);
+    return error;
+}
+
+
+int test_pool_allocator_interface(AllocatorInterface *allocator)
+{
+    int error = 0;
+    AllocatorInterface pool_interface;
+    PoolAllocator *pool = allocator->memory_allocate(sizeof(PoolAllocator));
+    pool_allocator_init_with_fallback(pool, allocator->memory_allocate, sizeof(Dict), 16, allocator);
+    pool_allocator_interface(&pool_interface, pool);
+
+    // Dict headers come from the pool, the larger tables from the fallback.
+    Dict *dicts[8];
+    for (uint32 i = 0; i < 8; i++)
+    {
+        dicts[i] = dict_new(&pool_interface, 32, sizeof(uint32), sizeof(uint32));
+        if (dicts[i] == NULL)
+            return 1;
+        dict_set(dicts[i], (uint8*)&i, (uint8*)&i);
+    }
+
+    for (uint32 i = 0; i < 8; i++)
+    {
+        uint32 value = 0;
+        dict_get(dicts[i], (uint8*)&i, (uint8*)&value);
+        if (value != i)
+            error = 1;
+
+        dict_resize(dicts[i], &pool_interface, 64);
+        dict_destroy(dicts[i], &pool_interface);
+    }
+
+    // A list moves from a pool block into the fallback allocator when it grows.
+    List *list = list_new(&pool_interface, 1, 8);
+    list_append(list, (uint8*)"ABCDEFGH");
+    list = list_resize(list, &pool_interface, 16);
+    if (list->_allocated_space != LIST_DATA_OFFSET + 16 * 8 || memcmp(list->data, "ABCDEFGH", 8) != 0)
+        error = 1;
+    list_destroy(list, &pool_interface);
+
+    // Every interface over the pool shares the fallback given at initialization.
+    AllocatorInterface second_interface;
+    pool_allocator_interface(&second_interface, pool);
+    void *memory = allocator_memory_allocate(&second_interface, 1000);
+    if (memory == NULL)
+        error = 1;
+    allocator_memory_free(&pool_interface, memory, 1000);
+
+    pool_allocator_destroy(pool, allocator->memory_free);
+
+    // Without a fallback, requests larger than a block fail.
+    pool = allocator->memory_allocate(sizeof(PoolAllocator));
+    pool_allocator_init(pool, allocator->memory_allocate, 16, 16);
+    pool_allocator_interface(&pool_interface, pool);
+    if (allocator_memory_allocate(&pool_interface, 17) != NULL || allocator_memory_allocate(&pool_interface, 16) == NULL)
+        error = 1;
+
+    pool_allocator_destroy(pool, allocator->memory_free);
+    return error;
+}
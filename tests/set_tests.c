@@ -138,3 +138,40 @@ int test_set_resize(AllocatorInterface *allocator)
         set_destroy(set, allocator);
     return err;
 }
+
+
+int test_set_add_and_remove(AllocatorInterface *allocator)
+{
+    int error = 0;
+    uint32 item;
+    Set *set = set_new(allocator, INITIAL_SET_SIZE, sizeof(uint32));
+    if (set == NULL)
+        return 1;
+
+    for (item = 1; item <= 6; item++)
+        set_add(set, (uint8*)&item);
+
+    // Adding an item that is not the first member again does nothing.
+    item = 4;
+    set_add(set, (uint8*)&item);
+    error |= set->member_count != 6;
+
+    // The index follows the members moved by remove.
+    item = 2;
+    set_remove(set, (uint8*)&item);
+    error |= set->member_count != 5;
+    for (item = 1; item <= 6; item++)
+        error |= set_contains_item(set, (uint8*)&item) != (item != 2);
+
+    // An item probed past a removed slot is not added again.
+    uint32 first = 100;
+    uint32 second = colliding_key(first, set->_num_slots);
+    set_add(set, (uint8*)&first);
+    set_add(set, (uint8*)&second);
+    set_remove(set, (uint8*)&first);
+    set_add(set, (uint8*)&second);
+    error |= set->member_count != 6;
+
+    set_destroy(set, allocator);
+    return error;
+}
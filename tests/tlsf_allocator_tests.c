@@ -0,0 +1,157 @@
+#define TLSF_TEST_REGION_SIZE (256 * 1024)
+#define TLSF_TEST_ALLOCATIONS 256
+
+
+int test_tlsf_allocator_memory_allocation(AllocatorInterface *allocator)
+{
+    int error = 0;
+    TlsfAllocator *tlsf = allocator->memory_allocate(sizeof(TlsfAllocator));
+    uint8 *region = allocator->memory_allocate(TLSF_TEST_REGION_SIZE);
+    tlsf_allocator_init(tlsf, region, TLSF_TEST_REGION_SIZE);
+
+    uint8 *a = tlsf_allocator_memory_allocate(tlsf, 100);
+    uint8 *b = tlsf_allocator_memory_allocate(tlsf, 1000);
+    uint8 *c = tlsf_allocator_memory_allocate(tlsf, 10);
+    if (a == NULL || b == NULL || c == NULL || ((uint64)a | (uint64)b | (uint64)c) % ALLOCATOR_DEFAULT_ALIGNMENT != 0)
+    {
+        error = 1;
+        goto cleanup;
+    }
+
+    // Blocks are laid out one after the other, each behind a header.
+    error |= b != a + 112 + TLSF_BLOCK_HEADER_SIZE;
+    error |= c != b + 1008 + TLSF_BLOCK_HEADER_SIZE;
+
+    // Freed neighbours are merged into a single block.
+    tlsf_allocator_memory_free(tlsf, b);
+    tlsf_allocator_memory_free(tlsf, a);
+    error |= tlsf_allocator_memory_allocate(tlsf, 1024) != a;
+
+    error |= tlsf_allocator_memory_allocate(tlsf, 0) != NULL;
+    error |= tlsf_allocator_memory_allocate(tlsf, TLSF_TEST_REGION_SIZE) != NULL;
+
+    // After freeing everything the whole region is available again.
+    tlsf_allocator_memory_free(tlsf, a);
+    tlsf_allocator_memory_free(tlsf, c);
+    a = tlsf_allocator_memory_allocate(tlsf, TLSF_TEST_REGION_SIZE / 2);
+    error |= a == NULL;
+
+    cleanup:
+        allocator->memory_free(region, TLSF_TEST_REGION_SIZE);
+        allocator->memory_free(tlsf, sizeof(TlsfAllocator));
+    return error;
+}
+
+
+int test_tlsf_allocator_resize(AllocatorInterface *allocator)
+{
+    int error = 0;
+    TlsfAllocator *tlsf = allocator->memory_allocate(sizeof(TlsfAllocator));
+    uint8 *region = allocator->memory_allocate(TLSF_TEST_REGION_SIZE);
+    tlsf_allocator_init(tlsf, region, TLSF_TEST_REGION_SIZE);
+
+    uint8 *a = tlsf_allocator_memory_allocate(tlsf, 64);
+    uint8 *b = tlsf_allocator_memory_allocate(tlsf, 64);
+    memset(a, 0x11, 64);
+
+    // Shrinking and growing into the free space after the block happen in place.
+    error |= tlsf_allocator_memory_resize(tlsf, b, 64, 32) != b;
+    error |= tlsf_allocator_memory_resize(tlsf, b, 32, 4096) != b;
+
+    // A block followed by a used block is moved.
+    uint8 *resized = tlsf_allocator_memory_resize(tlsf, a, 64, 128);
+    error |= resized == a || resized == NULL || resized[0] != 0x11 || resized[63] != 0x11;
+
+    // The freed block is reused, and grows into its free neighbour.
+    error |= tlsf_allocator_memory_allocate(tlsf, 16) != a;
+    error |= tlsf_allocator_memory_resize(tlsf, a, 16, 64) != a;
+
+    error |= tlsf_allocator_memory_resize(tlsf, b, 4096, TLSF_TEST_REGION_SIZE) != NULL;
+
+    allocator->memory_free(region, TLSF_TEST_REGION_SIZE);
+    allocator->memory_free(tlsf, sizeof(TlsfAllocator));
+    return error;
+}
+
+
+int test_tlsf_allocator_random_allocation(AllocatorInterface *allocator)
+{
+    int error = 0;
+    uint8 *blocks[TLSF_TEST_ALLOCATIONS] = { 0 };
+    uint64 sizes[TLSF_TEST_ALLOCATIONS] = { 0 };
+    TlsfAllocator *tlsf = allocator->memory_allocate(sizeof(TlsfAllocator));
+    uint8 *region = allocator->memory_allocate(4 * TLSF_TEST_REGION_SIZE);
+    tlsf_allocator_init(tlsf, region, 4 * TLSF_TEST_REGION_SIZE);
+
+    srand(14);
+    for (uint32 round = 0; round < 20000; round++)
+    {
+        uint32 i = rand() % TLSF_TEST_ALLOCATIONS;
+        if (blocks[i] != NULL)
+        {
+            for (uint64 j = 0; j < sizes[i]; j++)
+                error |= blocks[i][j] != (uint8)i;
+
+            if (rand() % 2)
+            {
+                tlsf_allocator_memory_free(tlsf, blocks[i]);
+                blocks[i] = NULL;
+                continue;
+            }
+
+            uint64 new_size = 1 + rand() % 2000;
+            uint8 *resized = tlsf_allocator_memory_resize(tlsf, blocks[i], sizes[i], new_size);
+            if (resized == NULL)
+                continue;
+            blocks[i] = resized;
+            sizes[i] = new_size;
+        }
+        else
+        {
+            sizes[i] = 1 + rand() % 2000;
+            blocks[i] = tlsf_allocator_memory_allocate(tlsf, sizes[i]);
+            if (blocks[i] == NULL)
+                continue;
+        }
+        memset(blocks[i], (int)i, sizes[i]);
+    }
+
+    for (uint32 i = 0; i < TLSF_TEST_ALLOCATIONS; i++)
+        tlsf_allocator_memory_free(tlsf, blocks[i]);
+
+    // Everything merged back into a single free block.
+    error |= ((TlsfBlock*)region)->size != ((4 * TLSF_TEST_REGION_SIZE - 2 * TLSF_BLOCK_HEADER_SIZE) | 0x01);
+
+    allocator->memory_free(region, 4 * TLSF_TEST_REGION_SIZE);
+    allocator->memory_free(tlsf, sizeof(TlsfAllocator));
+    return error;
+}
+
+
+int test_tlsf_allocator_interface(AllocatorInterface *allocator)
+{
+    int error = 0;
+    AllocatorInterface tlsf_interface;
+    TlsfAllocator *tlsf = platform_memory_map(sizeof(TlsfAllocator));
+    uint8 *region = platform_memory_map(TLSF_TEST_REGION_SIZE);
+    tlsf_allocator_init(tlsf, region, TLSF_TEST_REGION_SIZE);
+    tlsf_allocator_interface(&tlsf_interface, tlsf);
+
+    List *list = list_new(&tlsf_interface, 4, sizeof(uint32));
+    for (uint32 i = 0; i < 1000; i++)
+    {
+        if (list->member_count == (list->_allocated_space - LIST_DATA_OFFSET) / list->member_size)
+            list = list_resize(list, &tlsf_interface, list->member_count * 2);
+        list_append(list, (uint8*)&i);
+    }
+
+    for (uint32 i = 0; i < 1000; i++)
+        error |= ((uint32*)list->data)[i] != i;
+
+    list_destroy(list, &tlsf_interface);
+    error |= ((TlsfBlock*)region)->size != ((TLSF_TEST_REGION_SIZE - 2 * TLSF_BLOCK_HEADER_SIZE) | 0x01);
+
+    platform_memory_unmap(region, TLSF_TEST_REGION_SIZE);
+    platform_memory_unmap(tlsf, sizeof(TlsfAllocator));
+    return error;
+}
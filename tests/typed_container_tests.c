@@ -0,0 +1,298 @@
+typedef struct TypedPoint {
+    int32 x, y;
+} TypedPoint;
+
+static inline int equal_uint64(uint64 a, uint64 b)
+{
+    return a == b;
+}
+
+C_UTILS_DEFINE_ARRAY(int_array, int32)
+C_UTILS_DEFINE_LIST(point_list, TypedPoint)
+C_UTILS_DEFINE_DICT(point_dict, uint64, TypedPoint, equal_uint64)
+C_UTILS_DEFINE_SET(id_set, uint64, equal_uint64)
+
+
+static void typed_double(int32 *number)
+{
+    *number *= 2;
+}
+
+
+static int32 typed_sum(int32 a, int32 b)
+{
+    return a + b;
+}
+
+
+static int typed_is_negative(int32 *number)
+{
+    return *number < 0;
+}
+
+
+static int typed_is_less(int32 a, int32 b)
+{
+    return a < b;
+}
+
+
+static int typed_point_is_less(TypedPoint a, TypedPoint b)
+{
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+
+static int typed_point_on_diagonal(TypedPoint *point)
+{
+    return point->x == point->y;
+}
+
+
+static void typed_point_mirror(TypedPoint *point)
+{
+    int32 x = point->x;
+    point->x = point->y;
+    point->y = x;
+}
+
+
+int test_typed_array(AllocatorInterface *allocator)
+{
+    int error = 0;
+    int_array *array = int_array_new(allocator, 100);
+    if (array == NULL)
+        return 1;
+
+    for (uint32 i = 0; i < array->member_count; i++)
+        int_array_set(array, i, 50 - (int32)i);
+
+    int_array_foreach(array, typed_double);
+    error |= int_array_reduce(array, 0, typed_sum) != 2 * (50 * 51 / 2 - 49 * 50 / 2);
+    error |= int_array_find_index(array, 0, typed_is_negative) != 51;
+
+    // Both APIs see the same members.
+    int32 value;
+    array_get(int_array_to_array(array), 10, (uint8*)&value);
+    error |= value != int_array_get(array, 10);
+
+    int_array *doubled = int_array_map(array, allocator, typed_double);
+    error |= doubled == NULL || int_array_reduce(doubled, 0, typed_sum) != 2 * int_array_reduce(array, 0, typed_sum);
+    if (doubled != NULL)
+        int_array_destroy(doubled, allocator);
+
+    int_array *negative = int_array_filter(array, allocator, typed_is_negative);
+    error |= negative == NULL || negative->member_count != 49 || int_array_get(negative, 0) != -2;
+    if (negative != NULL)
+        int_array_destroy(negative, allocator);
+
+    int_array_sort(array, typed_is_less);
+    for (uint32 i = 1; i < array->member_count; i++)
+        error |= int_array_get(array, i - 1) > int_array_get(array, i);
+
+    error |= int_array_from_array(int_array_to_array(array)) != array;
+
+    int_array_fill(array, 7);
+    error |= int_array_reduce(array, 0, typed_sum) != 700;
+
+    int_array_destroy(array, allocator);
+
+    Array *bytes = array_new(allocator, 4, 1);
+    error |= int_array_from_array(bytes) != NULL;
+    array_destroy(bytes, allocator);
+    return error;
+}
+
+
+int test_typed_list(AllocatorInterface *allocator)
+{
+    int error = 0;
+    point_list *list = point_list_new(allocator, 8);
+    if (list == NULL)
+        return 1;
+
+    for (int32 i = 0; i < 10; i++)
+    {
+        TypedPoint point = { i, -i };
+        point_list_append(list, point);
+    }
+    error |= list->member_count != 8;
+    error |= point_list_capacity(list) != 8;
+
+    point_list_remove_at(list, 2);
+    error |= list->member_count != 7;
+    error |= point_list_get(list, 2).x != 3;
+
+    // Members appended with the untyped API are visible to the typed one.
+    list = point_list_resize(list, allocator, 16);
+    error |= point_list_capacity(list) != 16;
+
+    TypedPoint point = { 100, 200 };
+    list_append(point_list_to_list(list), (uint8*)&point);
+    error |= list->member_count != 8;
+    error |= point_list_get(list, 7).y != 200;
+    error |= point_list_from_list(point_list_to_list(list)) != list;
+
+    point_list *mirrored = point_list_map(list, allocator, typed_point_mirror);
+    error |= mirrored == NULL || mirrored->member_count != 8 || point_list_get(mirrored, 7).x != 200;
+    if (mirrored != NULL)
+        point_list_destroy(mirrored, allocator);
+
+    point_list *diagonal = point_list_filter(list, allocator, typed_point_on_diagonal);
+    error |= diagonal == NULL || diagonal->member_count != 1 || point_list_capacity(diagonal) != 1;
+    if (diagonal != NULL)
+        point_list_destroy(diagonal, allocator);
+    point_list_destroy(list, allocator);
+
+    // Enough members for partitioning, with many equal x values.
+    const uint32 count = 1000;
+    list = point_list_new(allocator, count);
+    if (list == NULL)
+        return 1;
+
+    uint32 seed = 1;
+    for (uint32 i = 0; i < count; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        TypedPoint random = { (int32)(seed >> 16) % 50, (int32)i };
+        point_list_append(list, random);
+    }
+
+    point_list_sort(list, typed_point_is_less);
+    for (uint32 i = 1; i < list->member_count; i++)
+        error |= typed_point_is_less(point_list_get(list, i), point_list_get(list, i - 1));
+
+    int64 sum = 0;
+    for (uint32 i = 0; i < list->member_count; i++)
+        sum += point_list_get(list, i).y;
+    error |= list->member_count != count || sum != count * (count - 1) / 2;
+
+    point_list_destroy(list, allocator);
+    return error;
+}
+
+
+int test_typed_dict(AllocatorInterface *allocator)
+{
+    const uint32 count = 200;
+    int error = 0;
+    point_dict *dict = point_dict_new(allocator, 2 * count);
+    if (dict == NULL)
+        return 1;
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        TypedPoint point = { (int32)i, (int32)i * 3 };
+        point_dict_set(dict, (uint64)i * 1000, point);
+    }
+    error |= dict->member_count != count;
+
+    TypedPoint extra = { 1, 1 };
+    point_dict_set(dict, 1, extra);
+    error |= dict->member_count != count + 1;
+    error |= !point_dict_remove(dict, 1);
+
+    TypedPoint update = { -1, -1 };
+    point_dict_set(dict, 5000, update);
+    error |= dict->member_count != count;
+
+    for (uint32 i = 0; i < count; i += 2)
+        error |= !point_dict_remove(dict, (uint64)i * 1000);
+    error |= point_dict_remove(dict, 0);
+    error |= dict->member_count != count / 2;
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        TypedPoint point = { 0, 0 };
+        int found = point_dict_get(dict, (uint64)i * 1000, &point);
+        error |= found != (int)(i % 2);
+        if (found && i != 5)
+            error |= point.x != (int32)i || point.y != (int32)i * 3;
+    }
+
+    error |= point_dict_resize(dict, allocator, 10) != 1;
+    error |= point_dict_resize(dict, allocator, 4 * count) != 0;
+    for (uint32 i = 0; i < 2 * count; i += 2)
+    {
+        TypedPoint point = { (int32)i, 0 };
+        point_dict_set(dict, (uint64)i * 1000 + 1, point);
+    }
+    error |= dict->member_count != 2 * count - count / 2;
+    error |= !point_dict_contains_key(dict, 5000);
+    error |= !point_dict_contains_key(dict, 398001);
+
+    // The keys stay dense, so the untyped copies work on a typed dict.
+    Array *keys = dict_copy_keys(point_dict_to_dict(dict), allocator);
+    error |= keys == NULL || keys->member_count != dict->member_count;
+    array_destroy(keys, allocator);
+
+    // Both APIs hash and probe the same way, so they can be mixed.
+    uint64 key = 7000;
+    TypedPoint point = { 0, 0 };
+    dict_get(point_dict_to_dict(dict), (uint8*)&key, (uint8*)&point);
+    error |= point.x != 7 || point.y != 21;
+
+    key = 3;
+    point.x = 30;
+    dict_set(point_dict_to_dict(dict), (uint8*)&key, (uint8*)&point);
+    error |= !point_dict_get(dict, 3, &point) || point.x != 30;
+
+    key = 9000;
+    dict_pop(point_dict_to_dict(dict), (uint8*)&key, (uint8*)&point);
+    error |= point_dict_contains_key(dict, 9000) || point.x != 9;
+    error |= !point_dict_remove(dict, 3);
+    error |= dict_contains_key(point_dict_to_dict(dict), (uint8*)&key);
+    key = 11000;
+    error |= !dict_contains_key(point_dict_to_dict(dict), (uint8*)&key);
+
+    // Shrinking rehashes, every key stays reachable.
+    error |= point_dict_resize(dict, allocator, 3 * count) != 0;
+    error |= dict->_num_slots != 3 * count || dict->member_count != 2 * count - count / 2 - 1;
+    error |= !point_dict_contains_key(dict, 11000) || !point_dict_contains_key(dict, 398001);
+
+    point_dict_destroy(dict, allocator);
+    return error;
+}
+
+
+int test_typed_set(AllocatorInterface *allocator)
+{
+    int error = 0;
+    id_set *set = id_set_new(allocator, 64);
+    if (set == NULL)
+        return 1;
+
+    for (uint64 i = 0; i < 100; i++)
+        id_set_add(set, i % 40);
+    error |= set->member_count != 40;
+
+    for (uint64 i = 0; i < 40; i += 4)
+        error |= !id_set_remove(set, i);
+    error |= id_set_remove(set, 4);
+    error |= set->member_count != 30;
+
+    for (uint64 i = 0; i < 40; i++)
+        error |= id_set_contains_item(set, i) != (i % 4 != 0);
+
+    error |= id_set_resize(set, allocator, 128);
+    for (uint64 i = 0; i < 100; i++)
+        id_set_add(set, i);
+    error |= set->member_count != 100;
+
+    Array *items = set_copy_items(id_set_to_set(set), allocator);
+    error |= items == NULL || items->member_count != 100;
+    array_destroy(items, allocator);
+
+    uint64 item = 500;
+    set_add(id_set_to_set(set), (uint8*)&item);
+    error |= !id_set_contains_item(set, 500);
+    item = 10;
+    set_remove(id_set_to_set(set), (uint8*)&item);
+    error |= id_set_contains_item(set, 10) || !id_set_contains_item(set, 99);
+    error |= !id_set_remove(set, 500);
+    error |= set_contains_item(id_set_to_set(set), (uint8*)&item);
+    error |= set->member_count != 99;
+
+    id_set_destroy(set, allocator);
+    return error;
+}
@@ -0,0 +1,319 @@
+// Record allocation traces and replay them against the allocators of c-utils.
+//
+// Build with 'make replay', then:
+//
+//     ./bin/allocator-replay record <trace-file>
+//         Record the built-in container workload (Dict and List churn) into a trace file.
+//
+//     ./bin/allocator-replay <trace-file>
+//         Replay the trace against malloc, bump, arena and pool allocators
+//         and report throughput and peak memory.
+//
+// A trace file is the raw array of AllocatorTraceEvents of an AllocatorRecorder.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "c-utils.h"
+
+#define REPLAY_ROUNDS 5
+#define WORKLOAD_CONTAINERS 64
+#define WORKLOAD_ROUNDS 200
+
+
+typedef struct MallocCounters
+{
+    uint64 bytes_used;
+    uint64 peak_bytes_used;
+} MallocCounters;
+
+
+static void* counting_allocate(void *context, uint64 size)
+{
+    MallocCounters *counters = context;
+    counters->bytes_used += size;
+    if (counters->bytes_used > counters->peak_bytes_used)
+        counters->peak_bytes_used = counters->bytes_used;
+    return malloc(size);
+}
+
+
+static void* counting_resize(void *context, void *memory, uint64 old_size, uint64 new_size)
+{
+    MallocCounters *counters = context;
+    void *new_memory = realloc(memory, new_size);
+    if (new_memory == NULL)
+        return NULL;
+
+    counters->bytes_used += new_size - old_size;
+    if (counters->bytes_used > counters->peak_bytes_used)
+        counters->peak_bytes_used = counters->bytes_used;
+    return new_memory;
+}
+
+
+static void counting_free(void *context, void *memory, uint64 size)
+{
+    MallocCounters *counters = context;
+    if (memory != NULL)
+        counters->bytes_used -= size;
+    free(memory);
+}
+
+
+static void counting_interface(AllocatorInterface *interface, MallocCounters *counters)
+{
+    counters->bytes_used = 0;
+    counters->peak_bytes_used = 0;
+    interface->memory_allocate = NULL;
+    interface->memory_resize = NULL;
+    interface->memory_free = NULL;
+    interface->context = counters;
+    interface->context_memory_allocate = counting_allocate;
+    interface->context_memory_resize = counting_resize;
+    interface->context_memory_free = counting_free;
+}
+
+
+static void* system_allocate(uint64 size)
+{
+    return malloc(size);
+}
+
+
+static void system_free(void *memory, uint64 size)
+{
+    free(memory);
+}
+
+
+static double seconds_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+
+// Dicts and Lists created, grown and destroyed in a shuffled order.
+static void run_workload(AllocatorInterface *allocator)
+{
+    Dict *dicts[WORKLOAD_CONTAINERS] = { 0 };
+    List *lists[WORKLOAD_CONTAINERS] = { 0 };
+
+    srand(16);
+    for (uint32 round = 0; round < WORKLOAD_ROUNDS; round++)
+    {
+        uint32 i = rand() % WORKLOAD_CONTAINERS;
+        if (dicts[i] != NULL)
+        {
+            dict_destroy(dicts[i], allocator);
+            list_destroy(lists[i], allocator);
+            dicts[i] = NULL;
+            continue;
+        }
+
+        uint32 members = 8 + rand() % 120;
+        dicts[i] = dict_new(allocator, members, sizeof(uint64), sizeof(uint32));
+        lists[i] = list_new(allocator, 4, sizeof(uint64));
+        for (uint32 j = 0; j < members; j++)
+        {
+            uint64 key = j * 7919;
+            dict_set(dicts[i], (uint8*)&key, (uint8*)&j);
+            if (lists[i]->member_count == (lists[i]->_allocated_space - LIST_DATA_OFFSET) / lists[i]->member_size)
+                lists[i] = list_resize(lists[i], allocator, lists[i]->member_count * 2);
+            list_append(lists[i], (uint8*)&key);
+        }
+    }
+
+    for (uint32 i = 0; i < WORKLOAD_CONTAINERS; i++)
+    {
+        if (dicts[i] == NULL)
+            continue;
+        dict_destroy(dicts[i], allocator);
+        list_destroy(lists[i], allocator);
+    }
+}
+
+
+static int record(const char *path)
+{
+    AllocatorInterface system = { 0 };
+    AllocatorInterface recording_interface;
+    AllocatorRecorder recorder;
+    MallocCounters counters;
+    counting_interface(&system, &counters);
+
+    allocator_recorder_init(&recorder, &system, &system);
+    allocator_recorder_interface(&recording_interface, &recorder);
+    run_workload(&recording_interface);
+
+    if (recorder.failed)
+    {
+        fprintf(stderr, "Out of memory while recording\n");
+        return 1;
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL || fwrite(recorder.events, sizeof(AllocatorTraceEvent), recorder.event_count, file) != recorder.event_count)
+    {
+        fprintf(stderr, "Failed to write %s\n", path);
+        return 1;
+    }
+    fclose(file);
+
+    printf("Recorded %lu events into %s\n", recorder.event_count, path);
+    allocator_recorder_destroy(&recorder);
+    return 0;
+}
+
+
+static AllocatorTraceEvent* load_trace(const char *path, uint64 *count)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    *count = size / sizeof(AllocatorTraceEvent);
+    AllocatorTraceEvent *events = malloc(*count * sizeof(AllocatorTraceEvent));
+    if (events != NULL && fread(events, sizeof(AllocatorTraceEvent), *count, file) != *count)
+    {
+        free(events);
+        events = NULL;
+    }
+    fclose(file);
+    return events;
+}
+
+
+static void report(const char *name, uint64 count, double seconds, uint64 peak, uint64 reserved, uint64 failed)
+{
+    printf("%-8s %10.3f ms %10.2f Mops/s %12lu %12lu %8lu\n",
+        name, seconds * 1e3, count / seconds * 1e-6, peak, reserved, failed);
+}
+
+
+static int replay(const char *path)
+{
+    uint64 count;
+    AllocatorTraceEvent *events = load_trace(path, &count);
+    if (events == NULL || count == 0)
+    {
+        fprintf(stderr, "Failed to read %s\n", path);
+        return 1;
+    }
+
+    AllocatorInterface scratch = { 0 };
+    MallocCounters scratch_counters;
+    counting_interface(&scratch, &scratch_counters);
+
+    // Enough for a trace that never frees anything, including the alignment padding.
+    uint64 bump_size = 0;
+    for (uint64 i = 0; i < count; i++)
+    {
+        if (events[i].operation < ALLOCATOR_TRACE_ALLOCATE || events[i].operation > ALLOCATOR_TRACE_FREE || events[i].id >= count)
+        {
+            fprintf(stderr, "Invalid event %lu in %s\n", i, path);
+            free(events);
+            return 1;
+        }
+        if (events[i].operation != ALLOCATOR_TRACE_FREE)
+            bump_size += events[i].size + ALLOCATOR_DEFAULT_ALIGNMENT;
+    }
+
+    printf("%lu events, best of %d runs\n", count, REPLAY_ROUNDS);
+    printf("%-8s %13s %17s %12s %12s %8s\n", "", "time", "throughput", "peak", "reserved", "failed");
+
+    AllocatorInterface interface = { 0 };
+    AllocatorStats stats;
+    uint64 failed;
+    double best, start;
+
+    MallocCounters counters;
+    best = 1e9;
+    for (int round = 0; round < REPLAY_ROUNDS; round++)
+    {
+        counting_interface(&interface, &counters);
+        start = seconds_now();
+        failed = allocator_trace_replay(events, count, &interface, &scratch);
+        best = min(best, seconds_now() - start);
+    }
+    report("malloc", count, best, counters.peak_bytes_used, counters.peak_bytes_used, failed);
+
+    BumpAllocator *bump = malloc(bump_allocator_size(bump_size));
+    best = 1e9;
+    for (int round = 0; round < REPLAY_ROUNDS; round++)
+    {
+        bump_allocator_init(bump, bump_size);
+        bump_allocator_interface(&interface, bump);
+        start = seconds_now();
+        failed = allocator_trace_replay(events, count, &interface, &scratch);
+        best = min(best, seconds_now() - start);
+    }
+    bump_allocator_stats(bump, &stats);
+    report("bump", count, best, stats.peak_bytes_used, bump_size, failed);
+    free(bump);
+
+    ArenaAllocator *arena = NULL;
+    best = 1e9;
+    for (int round = 0; round < REPLAY_ROUNDS; round++)
+    {
+        if (arena != NULL)
+            arena_allocator_destroy(arena, system_free);
+        arena = malloc(arena_allocator_size(32));
+        arena_allocator_init_growing(arena, system_allocate, 64 * 1024, 32);
+        arena_allocator_interface(&interface, arena);
+        start = seconds_now();
+        failed = allocator_trace_replay(events, count, &interface, &scratch);
+        best = min(best, seconds_now() - start);
+    }
+    arena_allocator_stats(arena, &stats);
+    report("arena", count, best, stats.peak_bytes_used, stats.bytes_reserved, failed);
+    arena_allocator_destroy(arena, system_free);
+
+    // Small blocks come from the pool, the rest from malloc.
+    PoolAllocator *pool = NULL;
+    AllocatorInterface fallback = { 0 };
+    MallocCounters fallback_counters;
+    best = 1e9;
+    for (int round = 0; round < REPLAY_ROUNDS; round++)
+    {
+        if (pool != NULL)
+            pool_allocator_destroy(pool, system_free);
+        pool = malloc(sizeof(PoolAllocator));
+        counting_interface(&fallback, &fallback_counters);
+        pool_allocator_init_with_fallback(pool, system_allocate, 128, 1024, &fallback);
+        pool_allocator_interface(&interface, pool);
+        start = seconds_now();
+        failed = allocator_trace_replay(events, count, &interface, &scratch);
+        best = min(best, seconds_now() - start);
+    }
+    pool_allocator_stats(pool, &stats);
+    report("pool", count, best,
+        stats.peak_bytes_used + fallback_counters.peak_bytes_used,
+        stats.bytes_reserved + fallback_counters.peak_bytes_used,
+        failed);
+    pool_allocator_destroy(pool, system_free);
+
+    free(events);
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "record") == 0)
+        return record(argv[2]);
+    if (argc == 2)
+        return replay(argv[1]);
+
+    fprintf(stderr, "Usage: %s record <trace-file>\n       %s <trace-file>\n", argv[0], argv[0]);
+    return 1;
+}